@@ -12,6 +12,9 @@
 #ifndef DJIBROADCAST_H
 #define DJIBROADCAST_H
 
+#include "dji_atomic.hpp"
+#include "dji_rate_monitor.hpp"
+#include "dji_seqlock.hpp"
 #include "dji_telemetry.hpp"
 #include "dji_vehicle_callback.hpp"
 
@@ -89,6 +92,46 @@ public:
     A3_HAS_DEVICE  = 0x2000
   };
 
+  /*!
+   * @brief The values kept from broadcast frames
+   *
+   * @details Each one is published on its own: getters never block the
+   * decoder and always return a field as a whole.
+   */
+  enum FIELD
+  {
+    FIELD_TIME_STAMP,
+    FIELD_SYNC_STAMP,
+    FIELD_QUATERNION,
+    FIELD_ACCELERATION,
+    FIELD_VELOCITY,
+    FIELD_VELOCITY_INFO,
+    FIELD_ANGULAR_RATE,
+    FIELD_GLOBAL_POSITION,
+    FIELD_RELATIVE_POSITION,
+    FIELD_GPS_INFO,
+    FIELD_RTK,
+    FIELD_MAG,
+    FIELD_RC,
+    FIELD_GIMBAL,
+    FIELD_STATUS,
+    FIELD_BATTERY,
+    FIELD_SDK_INFO,
+    // M100 only
+    FIELD_M100_TIME_STAMP,
+    FIELD_M100_VELOCITY,
+    FIELD_M100_STATUS,
+    FIELD_M100_BATTERY,
+    FIELD_COUNT
+  };
+
+  //! When a field was last received
+  typedef struct FieldStamp
+  {
+    uint32_t sequence; //! frames that carried the field, 0 = never
+    time_us  updated;  //! getTimeStampUs() at arrival
+  } FieldStamp;
+
 public:
   DataBroadcast(Vehicle* vehicle = 0);
   ~DataBroadcast();
@@ -264,6 +307,33 @@ public:
    */
   uint16_t getPassFlag();
 
+  /*! Sequence number and arrival time of the latest value of a field
+   *
+   *  @note wait-free, like the getters
+   */
+  FieldStamp getFieldStamp(FIELD field) const;
+
+  /*! Whether a field is missing or older than maxAge
+   *
+   *  @param maxAge in us, e.g. two periods of the channel
+   */
+  bool isStale(FIELD field, time_us maxAge) const;
+
+  /*! Delivered rate and inter-arrival jitter of one broadcast channel
+   *
+   *  @param channel bit index in passFlag, same order as the frequency array
+   *  @return false for an invalid channel
+   */
+  bool getRateStats(int channel, RateStats& stats) const;
+
+  //! Close due rate windows, so that a stalled channel is reported as well
+  void pollRates(time_us now);
+
+  void writeMetrics(MetricsWriter& writer) const;
+
+public:
+  static const int CHANNEL_COUNT = 16;
+
 public:
   Vehicle* getVehicle() const;
   void setVehicle(Vehicle* vehiclePtr);
@@ -316,19 +386,44 @@ private:
   // clang-format on
 
 private:
+  //! Where a field comes from in the frame: fields appear in flag order
+  typedef struct FieldLayout
+  {
+    uint16_t flag;
+    uint8_t  field;
+  } FieldLayout;
+
+  typedef struct FieldState
+  {
+    SeqLock  lock;
+    void*    data;
+    uint8_t  size;
+    uint32_t sequence;
+    time_us  updated;
+  } FieldState;
+
+  static const FieldLayout A3_LAYOUT[];
+  static const FieldLayout M100_LAYOUT[];
+
   /*!
-   * @brief Extract broadcast data for A3/N3
-   * @param recvFrame: the raw data payload
+   * @brief Pick the A3/N3 or M100 frame layout from the FW version, and
+   * index it by flag bit
    */
-  void unpackData(RecvContainer* recvFrame);
+  void selectLayout();
 
   /*!
-   * @brief Extract broadcast data for M100
+   * @brief Publish every field present in a broadcast frame
    * @param recvFrame: the raw data payload
+   * @return false if the frame is too short for its flags
    */
-  void unpackM100Data(RecvContainer* pRecvFrame);
+  bool unpackData(RecvContainer* recvFrame, time_us now);
 
-  inline void unpackOne(FLAG flag, void* data, uint8_t*& buf, size_t size);
+  void publishField(int field, const uint8_t* src, time_us now);
+  void readField(FIELD field, void* dst, FieldStamp* stamp = 0) const;
+
+  //! Record the arrival of every channel present in flags
+  void updateRates(uint16_t flags, time_us now);
+  void setExpectedRates(const uint8_t* dataLenIs16);
 
 public:
 
@@ -364,11 +459,20 @@ private:
   Telemetry::M100Battery        m100Battery;
   // clang-format on
 private:
-  Vehicle* vehicle;
-  uint16_t passFlag;
-  uint16_t broadcastLength;
+  Vehicle*         vehicle;
+  Atomic<uint16_t> passFlag;
+  uint16_t         broadcastLength;
+
+  bool               m100;
+  const FieldLayout* layout;
+  //! layout entries of flag bit b are [bitFirst[b], bitFirst[b + 1])
+  uint8_t            bitFirst[CHANNEL_COUNT + 1];
+  uint8_t            bitSize[CHANNEL_COUNT];
+  FieldState         fields[FIELD_COUNT];
 
   VehicleCallBackHandler userCbHandler;
+
+  RateMonitor rateMonitor[CHANNEL_COUNT];
 };
 
 } // OSDK
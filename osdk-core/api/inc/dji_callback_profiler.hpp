@@ -0,0 +1,123 @@
+/** @file dji_callback_profiler.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Execution time statistics for user callbacks
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_CALLBACK_PROFILER_H
+#define DJI_CALLBACK_PROFILER_H
+
+#include "dji_atomic.hpp"
+#include "dji_histogram.hpp"
+#include "dji_metrics.hpp"
+#include "dji_vehicle_callback.hpp"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+//! Number of distinct callback functions tracked
+#ifndef OSDK_CALLBACK_PROFILE_SIZE
+#ifdef STM32
+#define OSDK_CALLBACK_PROFILE_SIZE 4
+#else
+#define OSDK_CALLBACK_PROFILE_SIZE 32
+#endif
+#endif
+
+//! Snapshot of one callback function, times in microseconds
+typedef struct CallbackProfile
+{
+  VehicleCallBack callback;
+  uint32_t        calls;
+  uint32_t        overruns; //! invocations that exceeded the budget
+  time_us         budget;
+  uint64_t        p50;
+  uint64_t        p99;
+  uint64_t        max;
+  double          mean;
+  bool            isolated; //! run on a worker lane
+  uint32_t        dropped;  //! frames replaced before an isolated run
+} CallbackProfile;
+
+//! @note called on the thread that ran the slow callback, keep it short
+typedef void (*SlowCallbackHook)(VehicleCallBack callback, time_us duration,
+                                 time_us budget, UserData userData);
+
+/*! @brief Per-function execution time histograms for user callbacks
+ *
+ * @details Callbacks run on the read thread (push data) or on the callback
+ * thread (non-blocking ACKs); a slow one delays everything queued behind
+ * it. Each invocation is timed and compared with a budget, either the
+ * default or one set per function. On an overrun the hook is called, or a
+ * warning is logged when there is no hook.
+ *
+ * With isolation enabled, a function that overruns its budget
+ * isolationLimit times in a row is flagged isolated; the Vehicle then
+ * hands its push-data invocations to a worker lane of their own instead of
+ * running them on the read thread. The lane keeps only the latest frame per
+ * handler, so an isolated callback that still cannot keep up skips frames
+ * (counted as dropped) rather than delaying anyone else.
+ */
+class CallbackProfiler
+{
+public:
+  static const int     TABLE_SIZE     = OSDK_CALLBACK_PROFILE_SIZE;
+  static const time_us DEFAULT_BUDGET = 1000;
+
+  CallbackProfiler();
+
+  //! Budget for every callback without its own
+  void setBudget(time_us budget);
+  void setBudget(VehicleCallBack callback, time_us budget);
+  void setSlowHook(SlowCallbackHook hook, UserData userData = 0);
+  //! @param overrunLimit consecutive overruns before isolating, 0 disables
+  void setIsolation(uint32_t overrunLimit);
+
+  void record(VehicleCallBack callback, time_us duration);
+  bool isIsolated(VehicleCallBack callback) const;
+  //! An isolated callback's frame was replaced before it ran
+  void countDropped(VehicleCallBack callback);
+
+  bool get(VehicleCallBack callback, CallbackProfile& out) const;
+  //! @return number of entries written to out
+  int getAll(CallbackProfile* out, int maxCount) const;
+  //! Clears the statistics and lifts isolation
+  void reset();
+
+  void writeMetrics(MetricsWriter& writer) const;
+
+private:
+  typedef struct Entry
+  {
+    Atomic<uintptr_t> key; //! 0 = free, else the function address
+    Histogram         duration;
+    Atomic<time_us>   budget; //! 0 = default
+    Atomic<uint32_t>  overruns;
+    Atomic<uint32_t>  consecutive;
+    Atomic<bool>      isolated;
+    Atomic<uint32_t>  dropped;
+  } Entry;
+
+  Entry*       find(VehicleCallBack callback, bool create);
+  const Entry* find(VehicleCallBack callback) const;
+  void fill(const Entry& entry, CallbackProfile& out) const;
+
+  Entry entries[TABLE_SIZE];
+
+  Atomic<time_us>  defaultBudget;
+  Atomic<uint32_t> isolationLimit;
+  SlowCallbackHook slowHook;
+  UserData         slowHookData;
+}; // class CallbackProfiler
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_CALLBACK_PROFILER_H
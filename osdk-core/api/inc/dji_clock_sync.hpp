@@ -0,0 +1,106 @@
+/** @file dji_clock_sync.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Host/FC clock offset and drift estimation
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_CLOCK_SYNC_H
+#define DJI_CLOCK_SYNC_H
+
+#include "dji_seqlock.hpp"
+#include "dji_type.hpp"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+/*! @brief Maps FC time stamps to host time and back
+ *
+ * @details Every frame carrying an FC time stamp gives a pair (FC time,
+ * host arrival time). The arrival is late by the serial and queueing
+ * delay, which is never negative, so within each BIN_LENGTH interval only
+ * the pair with the smallest host - FC difference is kept. A line is
+ * fitted by least squares over the last WINDOW of those minima; bins
+ * whose residual exceeds three times the median absolute residual are
+ * then dropped and the line refitted.
+ *
+ * The constant part of the delay (the shortest transfer of a frame) cannot
+ * be told apart from the offset: fcToHost() gives the earliest host time
+ * the frame could have arrived.
+ *
+ * Until MIN_BINS bins are complete the drift is taken as zero and only the
+ * offset is estimated. An FC time going backwards by more than a second
+ * (FC reboot) restarts the estimation.
+ *
+ * Samples come from the read thread only; the conversions may be called
+ * from any thread.
+ */
+class ClockSync
+{
+public:
+  static const int     WINDOW     = 32;
+  static const int     MIN_BINS   = 4;
+  static const time_us BIN_LENGTH = 250000;
+
+  ClockSync();
+
+  /*!
+   * @param fcTime FC time stamp in microseconds
+   * @param hostTime host arrival time in microseconds
+   */
+  void addSample(uint64_t fcTime, time_us hostTime);
+  void reset();
+
+  //! @return true once at least one sample was received
+  bool isSynced() const;
+
+  //! @note both return 0 until isSynced()
+  time_us fcToHost(uint64_t fcTime) const;
+  uint64_t hostToFc(time_us hostTime) const;
+
+  //! @return drift of the FC clock against the host clock in ppm
+  double getDriftPpm() const;
+  //! @return RMS residual of the fit in microseconds
+  double getJitter() const;
+
+private:
+  typedef struct Model
+  {
+    uint64_t fcRef;
+    double   hostAtRef; //! host time of fcRef
+    double   slope;     //! host microseconds per FC microsecond
+    double   jitter;
+    bool     valid;
+  } Model;
+
+  void closeBin();
+  void fit();
+  bool solve(const bool* use, double& intercept, double& slope) const;
+  void publish(const Model& next);
+  Model read() const;
+
+  //! Writer state, read thread only
+  uint64_t binFc;
+  time_us  binHost;
+  time_us  binStart;
+  bool     binOpen;
+  uint64_t lastFc;
+  uint64_t fcSample[WINDOW];
+  time_us  hostSample[WINDOW];
+  int      head;
+  int      count;
+
+  SeqLock lock;
+  Model   model;
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_CLOCK_SYNC_H
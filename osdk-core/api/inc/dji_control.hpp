@@ -412,6 +412,10 @@ public:
   /*! @brief Stop the vehicle in horiz velocity, vert velocity, yaw rate mode
    * (body frame)
    *
+   * @note Sent at once, never through the setpoint mailbox: a setpoint
+   * pending in the SETPOINT_CONTROL slot is dropped, and one being sent is
+   * waited for. The slot stays enabled, so flight commands posted afterwards
+   * go out as usual.
    */
   void emergencyBrake();
   /*! @brief A callback function for action non-blocking calls
@@ -440,6 +444,10 @@ private:
    * Task CMD data to send to the flight controller (supported in Matrice 100)
    */
   M100CMDData m100CMDData;
+
+  //! Frame skeletons of the two flightCtrl() payload sizes
+  FrameTemplate ctrlFrame;
+  FrameTemplate advancedCtrlFrame;
 }; // class Control
 
 } // OSDK
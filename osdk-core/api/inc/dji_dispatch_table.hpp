@@ -0,0 +1,212 @@
+/** @file dji_dispatch_table.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  (cmd_set, cmd_id) keyed push data subscribers and ACK slots
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_DISPATCH_TABLE_H
+#define DJI_DISPATCH_TABLE_H
+
+#include "dji_atomic.hpp"
+#include "dji_seqlock.hpp"
+#include "dji_vehicle_callback.hpp"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+//! Number of push data subscribers, built-in ones included
+#ifndef OSDK_DISPATCH_SUBSCRIBERS
+#ifdef STM32
+#define OSDK_DISPATCH_SUBSCRIBERS 8
+#else
+#define OSDK_DISPATCH_SUBSCRIBERS 32
+#endif
+#endif
+
+//! Most frames a DISPATCH_QUEUE subscriber can have waiting
+#ifndef OSDK_DISPATCH_QUEUE_DEPTH
+#ifdef STM32
+#define OSDK_DISPATCH_QUEUE_DEPTH 4
+#else
+#define OSDK_DISPATCH_QUEUE_DEPTH 16
+#endif
+#endif
+
+/*! @brief Dispatch table from (cmd_set, cmd_id) to push data subscribers
+ *
+ * @details One 256 entry row per cmd_set, allocated the first time that
+ * set is used, so a lookup is two array reads. Each cell holds the head of
+ * a subscriber chain, a tag the Vehicle uses to route the push data its
+ * own modules decode, and for commands answered by a blocking call the ACK
+ * slot waitForACK() returns.
+ *
+ * Subscribers are registered from any thread. Lookups on the read thread
+ * take no lock: a subscriber's settings are read under its own SeqLock. A
+ * removed subscriber is unlinked from its chain but keeps its link, so a
+ * lookup standing on it carries on, and goes to a free list for any
+ * command. A lookup that finds its node reused for another command starts
+ * over; one racing a subscribe may miss that subscriber for one frame.
+ * Subscriber ids carry a generation, so the id of a removed subscriber
+ * never reaches its node's next owner.
+ *
+ * Queued frames wait in the subscriber's own queue (DISPATCH_QUEUE) or
+ * mailbox (DISPATCH_LATEST): enqueue() on the read thread, dequeue() on
+ * the one worker lane the Vehicle runs for that node. Each frame carries
+ * the subscriber id it was queued for, so frames left behind by a removed
+ * subscriber are discarded instead of reaching the node's next owner.
+ */
+class DispatchTable
+{
+public:
+  static const int MAX_SUBSCRIBERS = OSDK_DISPATCH_SUBSCRIBERS;
+  static const int MAX_QUEUE_DEPTH = OSDK_DISPATCH_QUEUE_DEPTH;
+  static const int MAX_ACK_SLOTS   = 15;
+
+  static_assert(MAX_SUBSCRIBERS < 256, "Chains link nodes by uint8_t index");
+
+  typedef enum DropPolicy
+  {
+    //! Run on the read thread; blocks everything queued behind it
+    DISPATCH_INLINE,
+    //! Queue to a worker, drop new frames once queueDepth wait
+    DISPATCH_QUEUE,
+    //! Queue to a worker, a new frame replaces a waiting one
+    DISPATCH_LATEST
+  } DropPolicy;
+
+  typedef struct Subscriber
+  {
+    int                    id;
+    VehicleCallBackHandler handler;
+    DropPolicy             policy;
+  } Subscriber;
+
+  typedef struct SubscriberStats
+  {
+    uint32_t delivered;
+    uint32_t dropped;
+    uint32_t pending;
+  } SubscriberStats;
+
+  DispatchTable();
+  ~DispatchTable();
+
+  /*!
+   * @brief Add a subscriber for one push command
+   * @param queueDepth frames waiting for the worker with DISPATCH_QUEUE, at
+   * most MAX_QUEUE_DEPTH; ignored otherwise
+   * @return subscriber id, -1 if the table is full
+   */
+  int subscribe(uint8_t cmdSet, uint8_t cmdId, VehicleCallBackHandler handler,
+                DropPolicy policy = DISPATCH_INLINE, int queueDepth = 8);
+  bool unsubscribe(int id);
+
+  /*!
+   * @brief Copy out the subscribers of a command, in registration order
+   * @return number of subscribers copied
+   */
+  int lookup(uint8_t cmdSet, uint8_t cmdId, Subscriber* out, int max) const;
+  //! @return false if the subscriber was removed meanwhile
+  bool getSubscriber(int id, Subscriber& out) const;
+  //! Node a subscriber id refers to, 0 to MAX_SUBSCRIBERS - 1
+  static int getIndex(int id);
+
+  //! Tags and ACK slots are set up once, before the read thread starts
+  bool setTag(uint8_t cmdSet, uint8_t cmdId, uint8_t tag);
+  //! @return 0 if the command has no tag
+  uint8_t getTag(uint8_t cmdSet, uint8_t cmdId) const;
+  bool setAckSlot(uint8_t cmdSet, uint8_t cmdId, void* slot);
+  void* getAckSlot(uint8_t cmdSet, uint8_t cmdId) const;
+
+  /*! @brief Queue a frame for a DISPATCH_QUEUE or DISPATCH_LATEST
+   *  subscriber
+   *  @note read thread only
+   *  @return false if a frame was dropped: the new one with a full queue,
+   *  or the one it replaced in the mailbox
+   */
+  bool enqueue(int id, const RecvContainer& frame);
+  /*!
+   * @brief Take the next frame waiting at a node
+   * @note one consumer per node
+   * @return false if none is left for its current subscriber
+   */
+  bool dequeue(int index, Subscriber& out, RecvContainer& frame);
+
+  void countDelivered(int id);
+  void countDropped(int id);
+  SubscriberStats getStats(int id) const;
+
+private:
+  DispatchTable(const DispatchTable&);
+  DispatchTable& operator=(const DispatchTable&);
+
+  //! 0 terminates a chain, otherwise node index + 1
+  typedef struct Cell
+  {
+    Atomic<uint8_t> head;
+    uint8_t         tag;
+    uint8_t         ackSlot;
+  } Cell;
+
+  typedef struct QueuedFrame
+  {
+    int           id;
+    RecvContainer frame;
+  } QueuedFrame;
+
+  typedef struct Node
+  {
+    SeqLock                lock;
+    uint8_t                cmdSet;
+    uint8_t                cmdId;
+    bool                   active;
+    Atomic<uint32_t>       generation; //! bumped on unsubscribe
+    uint8_t                freeNext;   //! free list link, under the writer lock
+    VehicleCallBackHandler handler;
+    DropPolicy             policy;
+    uint32_t               queueDepth;
+    Atomic<uint8_t>        next;
+    Atomic<uint32_t>       delivered;
+    Atomic<uint32_t>       dropped;
+    //! DISPATCH_QUEUE ring, allocated on first use and kept for the node
+    Atomic<QueuedFrame*>   queue;
+    Atomic<uint32_t>       queueHead; //! written by enqueue()
+    Atomic<uint32_t>       queueTail; //! written by dequeue()
+    //! DISPATCH_LATEST mailbox
+    SeqBuffer<sizeof(QueuedFrame)> latest;
+    Atomic<uint32_t>               latestTaken; //! written by dequeue()
+  } Node;
+
+  Cell* getRow(uint8_t cmdSet, bool create);
+  const Cell* findCell(uint8_t cmdSet, uint8_t cmdId) const;
+  Node* getNode(int id) const;
+  int makeId(const Node* node, uint32_t generation) const;
+  void lockWriters();
+  void unlockWriters();
+
+  //! Subscriber id: generation << ID_INDEX_BITS | node index
+  static const int      ID_INDEX_BITS  = 8;
+  static const uint32_t GENERATION_MAX = 0x7FFFFF;
+  //! Writer lock attempts before yielding the CPU
+  static const int      WRITER_SPINS   = 64;
+
+  Atomic<Cell*>    rows[256];
+  Node*            nodes;
+  Atomic<uint32_t> used; //! nodes ever handed out, never shrinks
+  uint8_t          freeHead; //! removed nodes, index + 1, 0 if none
+  Atomic<uint32_t> writer;
+  void*            ackSlots[MAX_ACK_SLOTS];
+  int              ackSlotCount;
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_DISPATCH_TABLE_H
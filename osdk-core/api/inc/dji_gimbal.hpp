@@ -12,6 +12,7 @@
 #define GIMBAL_H
 
 #include "dji_command.hpp"
+#include "dji_open_protocol.hpp"
 #include "dji_type.hpp"
 
 namespace DJI
@@ -109,7 +110,9 @@ public:
   void setSpeed(Gimbal::SpeedData* data);
 
 private:
-  Vehicle* vehicle;
+  Vehicle*      vehicle;
+  FrameTemplate angleFrame;
+  FrameTemplate speedFrame;
 };
 
 } // OSDK
@@ -0,0 +1,161 @@
+/** @file dji_link_quality.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Link-quality score and telemetry rate adaptation under congestion
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_LINK_QUALITY_H
+#define DJI_LINK_QUALITY_H
+
+#include "dji_atomic.hpp"
+#include "dji_metrics.hpp"
+#include "dji_open_protocol.hpp"
+#include "dji_seqlock.hpp"
+#include "dji_subscription.hpp"
+#include "dji_telemetry.hpp"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+class Vehicle;
+
+/*! @brief Rolling link-quality score, optionally driving telemetry rates
+ *
+ * @details Every period the link counters of the Protocol are compared
+ * with the previous period's. The worst of the CRC error ratio, resync
+ * byte ratio, retransmission ratio and serial TX queue fill gives the
+ * period's quality, 1 for a clean link down to 0; the score is its
+ * exponential moving average. Periods in which nothing was received do
+ * not move the score.
+ *
+ * With adaptive rates on, a score below degradeBelow moves every running
+ * subscription package one step down PackagePlanner::FREQ_LIST, but not
+ * below the highest minimum set for its topics with setTopicMinimum().
+ * Once the score has been above restoreAbove for restoreHold periods the
+ * rates move back up the list, one step per period, to the rates they
+ * had. Rate changes use the non-blocking
+ * DataSubscription::changePackageFrequency(), sent after the policy state
+ * is unlocked since they can wait for the link; a package raised above its
+ * original rate from elsewhere is no longer managed.
+ *
+ * Runs as a job on Vehicle::getScheduler(), like the SetpointMailbox. The
+ * rate changes are bulk frames that wait for the link in a congestion, so
+ * the job only requests them and the callback thread sends them; a request
+ * not served by the next period is replaced by that period's.
+ */
+class LinkQuality
+{
+public:
+  typedef struct Sample
+  {
+    float crcErrorRatio;  //! CRC failures / frames
+    float resyncRatio;    //! discarded bytes / received bytes
+    float retransmitRatio; //! retransmissions / frames sent
+    float txQueueFill;    //! serial TX queue bytes / capacity
+    float quality;        //! this period, 0..1
+    float score;          //! moving average, 0..1
+  } Sample;
+
+  LinkQuality(Vehicle* vehicle);
+
+  //! Start scoring the link every periodMs
+  bool enable(uint16_t periodMs = 1000);
+  //! @note restores package rates lowered by the adaptive policy
+  void disable();
+  bool isEnabled() const;
+
+  //! 0..1, 1 until the first period with traffic
+  float getScore() const;
+  Sample getLastSample() const;
+
+  //! Let the score lower and restore subscription package rates
+  void setAdaptiveRates(bool enable);
+  //! @param restoreHold good periods before rates go back up
+  void setThresholds(float degradeBelow, float restoreAbove,
+                     uint8_t restoreHold = 3);
+  //! Packages carrying topic are never lowered below freq Hz
+  void setTopicMinimum(Telemetry::TopicName topic, uint16_t freq);
+
+  //! Evaluate one period, normally called by the scheduler job
+  void update();
+
+  void writeMetrics(MetricsWriter& writer) const;
+
+public:
+  static const float SCORE_WEIGHT; //! of the newest period
+  static const float CRC_WEIGHT;
+  static const float RESYNC_WEIGHT;
+  static const float RETRANSMIT_WEIGHT;
+
+private:
+  LinkQuality(const LinkQuality&);
+  LinkQuality& operator=(const LinkQuality&);
+
+  typedef enum RateAction
+  {
+    RATES_KEEP,
+    RATES_DEGRADE,
+    RATES_RESTORE
+  } RateAction;
+
+  typedef struct ManagedPackage
+  {
+    uint16_t original; //! rate before the policy touched it, 0 = unmanaged
+    uint16_t target;   //! rate last requested
+  } ManagedPackage;
+
+  typedef struct RateChange
+  {
+    int            packageID;
+    uint16_t       freq;
+    ManagedPackage before; //! managed[packageID] to put back on failure
+  } RateChange;
+
+  static void evaluate(time_us deadline, UserData userData);
+  static void adapt(Vehicle* vehicle, RecvContainer recvFrame,
+                    UserData userData);
+  void requestRates(RateAction action);
+  void lockRates();
+  void unlockRates();
+  //! Plan the changes into managed[] and changes, under lockRates()
+  int degrade(DataSubscription* subscribe, RateChange* changes);
+  int restore(DataSubscription* subscribe, bool all, RateChange* changes);
+  //! Send the planned changes, without lockRates()
+  void apply(DataSubscription* subscribe, const RateChange* changes,
+             int count, bool up);
+  void restoreAll();
+  uint16_t minimumFor(int packageID, DataSubscription* subscribe) const;
+
+  Vehicle*    vehicle;
+  Atomic<int> job;
+  LinkStats   previous;
+  bool        havePrevious;
+
+  bool     adaptive;
+  float    degradeBelow;
+  float    restoreAbove;
+  uint8_t  restoreHold;
+  uint8_t  goodPeriods;
+  uint16_t topicMinimum[Telemetry::TOTAL_TOPIC_NUMBER];
+
+  Atomic<uint8_t>  action;    //! RateAction for adapt() to take
+  Atomic<uint32_t> ratesLock; //! managed[] and the rate changes
+  ManagedPackage   managed[DataSubscription::MAX_NUMBER_OF_PACKAGE];
+
+  Atomic<uint32_t> scorePermille;
+  Atomic<uint32_t> degradations;
+  Atomic<uint32_t> restorations;
+  SeqBuffer<sizeof(Sample)> last;
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_LINK_QUALITY_H
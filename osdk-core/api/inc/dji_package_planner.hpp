@@ -0,0 +1,144 @@
+/** @file dji_package_planner.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Telemetry package planner for a given link bandwidth
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_PACKAGE_PLANNER_H
+#define DJI_PACKAGE_PLANNER_H
+
+#include "dji_telemetry.hpp"
+#include "dji_type.hpp"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+/*! @brief Chooses subscription packages and broadcast frequencies
+ *
+ * @details Given the minimum rate wanted for each topic, the planner picks
+ * the lowest frequency the FC offers at or above it, then groups topics
+ * into at most MAX_PACKAGES packages so the total bytes on the wire,
+ * frame overhead included, is as low as possible. The result can be
+ * checked against the link with getUtilization() before anything is sent
+ * to the FC.
+ *
+ * @note Rates are in Hz, bandwidth in bytes per second on the wire
+ */
+class PackagePlanner
+{
+public:
+  static const int MAX_PACKAGES  = 5;
+  static const int CHANNEL_COUNT = 16;
+  static const int FREQ_COUNT    = 6;
+
+  //! Frequencies accepted by the FC, for packages and broadcast channels
+  static const uint16_t FREQ_LIST[FREQ_COUNT];
+
+  //! Above this share of the link, ACKs start queuing behind telemetry
+  static const float DEFAULT_LINK_BUDGET;
+
+  typedef struct TopicRequest
+  {
+    Telemetry::TopicName topic;
+    uint16_t             minFreq; //! 0 = not wanted
+  } TopicRequest;
+
+  typedef struct PlannedPackage
+  {
+    uint16_t             freq;
+    int                  numberOfTopics;
+    Telemetry::TopicName topics[Telemetry::TOTAL_TOPIC_NUMBER];
+    uint16_t             dataSize;       //! time stamp included
+    uint32_t             bytesPerSecond; //! frames included
+  } PlannedPackage;
+
+  typedef struct SubscriptionPlan
+  {
+    bool           timeStamp;
+    int            numberOfPackages;
+    PlannedPackage package[MAX_PACKAGES];
+    uint32_t       bytesPerSecond;
+  } SubscriptionPlan;
+
+  typedef struct BroadcastPlan
+  {
+    //! Ready for DataBroadcast::setBroadcastFreq()
+    uint8_t  freq[CHANNEL_COUNT];
+    uint16_t hz[CHANNEL_COUNT];
+    uint32_t bytesPerSecond;
+  } BroadcastPlan;
+
+public:
+  /*!
+   * @param baudRate UART rate, 8N1 framing is assumed
+   * @param encrypted whether frames are AES padded
+   */
+  PackagePlanner(uint32_t baudRate, bool encrypted = false);
+
+  void  setLinkBudget(float share);
+  float getLinkBudget() const;
+
+  /*!
+   * @brief Pack the requested topics into subscription packages
+   * @return false if a topic is requested above its maxFreq or the topics
+   * do not fit in MAX_PACKAGES packages
+   */
+  bool planSubscription(const TopicRequest* requests, int count,
+                        bool timeStamp, SubscriptionPlan& plan) const;
+
+  /*!
+   * @brief Pick the broadcast frequency of each channel
+   * @param minHz minimum rate per channel, in setBroadcastFreq() order
+   * @param m100 use the Matrice 100 broadcast layout
+   */
+  bool planBroadcast(const uint16_t* minHz, bool m100,
+                     BroadcastPlan& plan) const;
+
+  //! Share of the link used by the plans, either may be NULL
+  float getUtilization(const SubscriptionPlan* subscription,
+                       const BroadcastPlan*    broadcast) const;
+
+  //! Log the plans and warn if they exceed the link budget
+  bool report(const SubscriptionPlan* subscription,
+              const BroadcastPlan*    broadcast) const;
+
+  //! Bytes on the wire for a frame carrying payload bytes after cmd set/id
+  uint32_t frameBytes(uint32_t payload) const;
+
+  //! Lowest FREQ_LIST rate >= hz, 0 if above them all
+  static uint16_t roundUpFreq(uint16_t hz);
+  //! FREQ_LIST neighbours of hz, 0 if there is none
+  static uint16_t lowerFreq(uint16_t hz);
+  static uint16_t higherFreq(uint16_t hz);
+
+private:
+  typedef struct Candidate
+  {
+    uint16_t freq;
+    uint16_t capFreq; //! lowest maxFreq among its topics
+    uint16_t size;
+    int      numberOfTopics;
+    uint8_t  topics[Telemetry::TOTAL_TOPIC_NUMBER];
+  } Candidate;
+
+  uint32_t packageCost(uint16_t freq, uint16_t size) const;
+  static uint8_t  toBroadcastFreq(uint16_t hz);
+  static int broadcastChannelSize(int channel, bool m100);
+
+private:
+  uint32_t baudRate;
+  bool     encrypted;
+  float    linkBudget;
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_PACKAGE_PLANNER_H
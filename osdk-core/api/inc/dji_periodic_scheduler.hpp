@@ -0,0 +1,159 @@
+/** @file dji_periodic_scheduler.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Fixed-rate jobs for streaming setpoints (control, virtual RC, gimbal)
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_PERIODIC_SCHEDULER_H
+#define DJI_PERIODIC_SCHEDULER_H
+
+#include "dji_atomic.hpp"
+#include "dji_hard_driver.hpp"
+#include "dji_histogram.hpp"
+#include "dji_metrics.hpp"
+#include "dji_type.hpp"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+//! Number of periodic jobs
+#ifndef OSDK_PERIODIC_JOBS
+#ifdef STM32
+#define OSDK_PERIODIC_JOBS 4
+#else
+#define OSDK_PERIODIC_JOBS 8
+#endif
+#endif
+
+/*! @brief Periodic job
+ *  @param deadline the time the run was due, on the driver's clock
+ */
+typedef void (*PeriodicCallBack)(time_us deadline, UserData userData);
+
+//! Snapshot of one job, times in microseconds
+typedef struct PeriodicStats
+{
+  time_us  period;
+  uint32_t runs;
+  uint32_t overruns; //! runs that ended after the next deadline
+  uint32_t skipped;  //! deadlines dropped to catch up after an overrun
+  uint64_t jitterP50; //! start time - deadline
+  uint64_t jitterP99;
+  uint64_t jitterMax;
+  uint64_t durationMax;
+} PeriodicStats;
+
+/*! @brief Runs jobs on a fixed time grid
+ *
+ * @details Each job is due at phase + k * period. runDue() runs every job
+ * whose deadline has passed and moves it to its next deadline; after an
+ * overrun the deadlines already missed are skipped, never run in a burst,
+ * so the grid and the rate stay fixed.
+ *
+ * This class only does the bookkeeping: on Linux PosixPeriodicScheduler
+ * drives it from a thread sleeping on absolute deadlines. Elsewhere call
+ * runDue() from a timer interrupt or the main loop.
+ *
+ * Jobs may be added and removed from any thread. A job removed while it
+ * runs completes that run; removeJob() waits for it unless it is called
+ * from the job itself or the platform has no scheduler thread, and the slot
+ * is not reused before the run ends either way.
+ */
+class PeriodicScheduler
+{
+public:
+  static const int MAX_JOBS = OSDK_PERIODIC_JOBS;
+
+  //! Thread settings, applied by start() where the platform supports them
+  typedef struct RealTimeConfig
+  {
+    int  priority;   //! SCHED_FIFO priority, 0 keeps the default policy
+    int  cpu;        //! CPU to pin the thread to, -1 for any
+    bool lockMemory; //! mlockall() to avoid page faults in the jobs
+  } RealTimeConfig;
+
+  //! @param driver supplies the clock deadlines are measured on
+  PeriodicScheduler(HardDriver* driver);
+  virtual ~PeriodicScheduler();
+
+  /*!
+   * @param phase offset of the first deadline from now
+   * @return job id, -1 if there is no free slot or period is 0
+   */
+  int addJob(time_us period, PeriodicCallBack callback, UserData userData = 0,
+             time_us phase = 0);
+  /*!
+   * @details Once it returns the callback is not running and will not run
+   * again, except when called from the thread that runs the jobs
+   */
+  bool removeJob(int id);
+  //! Takes effect from the job's next deadline
+  bool setPeriod(int id, time_us period);
+  bool getStats(int id, PeriodicStats& stats) const;
+
+  /*!
+   * @brief Run the jobs that are due
+   * @return the next deadline of any job, 0 if there is none
+   */
+  time_us runDue(time_us now);
+
+  //! @return false if the platform has no scheduler thread
+  virtual bool start(const RealTimeConfig& config);
+  virtual void stop();
+
+  //! Jitter, overruns and skipped deadlines per job
+  void writeMetrics(MetricsWriter& writer) const;
+
+protected:
+  /*!
+   * @brief Called by removeJob() while the job being removed runs
+   * @return false if the caller cannot wait for the run to end, true after
+   * giving way to the scheduler thread for a moment
+   */
+  virtual bool waitForRun();
+
+  HardDriver* driver;
+
+private:
+  PeriodicScheduler(const PeriodicScheduler&);
+  PeriodicScheduler& operator=(const PeriodicScheduler&);
+
+  enum JobState
+  {
+    JOB_FREE,
+    JOB_CLAIMED,
+    JOB_ACTIVE,
+    JOB_REMOVING //! removed, the slot is freed once it is not running
+  };
+
+  typedef struct Job
+  {
+    Atomic<uint8_t>  state;
+    PeriodicCallBack callback;
+    UserData         userData;
+    Atomic<uint64_t> period;
+    time_us          deadline; //! set by addJob(), then scheduler side only
+    Atomic<uint32_t> runs;
+    Atomic<uint32_t> overruns;
+    Atomic<uint32_t> skipped;
+    Atomic<uint64_t> durationMax;
+    Histogram        jitter;
+  } Job;
+
+  void release(int id);
+
+  Job         jobs[MAX_JOBS];
+  Atomic<int> current; //! job runDue() is looking at, -1 for none
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_PERIODIC_SCHEDULER_H
@@ -0,0 +1,122 @@
+/** @file dji_setpoint_mailbox.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Latest-value-wins mailboxes for control, gimbal and virtual RC setpoints
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_SETPOINT_MAILBOX_H
+#define DJI_SETPOINT_MAILBOX_H
+
+#include "dji_atomic.hpp"
+#include "dji_metrics.hpp"
+#include "dji_open_protocol.hpp"
+#include "dji_seqlock.hpp"
+#include "dji_type.hpp"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+class Vehicle;
+
+/*! @brief Coalesces setpoints sent faster than the link or the FC use them
+ *
+ * @details Setpoints are fire-and-forget (session 0) frames; sent one per
+ * call, a producer faster than the link fills the serial queue with stale
+ * values. With a slot enabled, Control::flightCtrl(), Gimbal::setAngle(),
+ * Gimbal::setSpeed() and VirtualRC::sendData() only overwrite the slot's
+ * pending setpoint. A job on the Vehicle's PeriodicScheduler sends the
+ * newest one at most once per period, so a setpoint waits at most one
+ * period and older pending ones are dropped (counted as coalesced).
+ *
+ * Slots are disabled by default: every call is then sent right away, as
+ * before.
+ */
+class SetpointMailbox
+{
+public:
+  typedef enum Slot
+  {
+    SETPOINT_CONTROL,
+    SETPOINT_GIMBAL_ANGLE,
+    SETPOINT_GIMBAL_SPEED,
+    SETPOINT_VIRTUAL_RC,
+    SETPOINT_COUNT
+  } Slot;
+
+  //! Largest setpoint payload, VirtualRCData
+  static const int MAX_PAYLOAD = 64;
+
+  typedef struct Stats
+  {
+    uint32_t posted;
+    uint32_t sent;
+    uint32_t coalesced; //! overwritten before they were sent
+  } Stats;
+
+  SetpointMailbox(Vehicle* vehicle);
+  ~SetpointMailbox();
+
+  /*! @brief Send the slot's setpoints through the mailbox
+   *
+   * @details Adds a job to Vehicle::getScheduler() and starts the scheduler
+   * if it is not running; where the platform has no scheduler thread, call
+   * its runDue() from a timer.
+   *
+   * @param maxRate setpoints per second, e.g. 50 for control
+   */
+  bool enable(Slot slot, uint16_t maxRate);
+  //! @note a setpoint still pending is dropped
+  void disable(Slot slot);
+  bool isEnabled(Slot slot) const;
+
+  /*!
+   * @brief Replace the slot's pending setpoint
+   * @return false if the slot is disabled, the caller then sends directly
+   */
+  bool post(Slot slot, const void* data, int len);
+  /*!
+   * @brief Drop the slot's pending setpoint and wait for one being sent
+   * @details For a frame sent around the mailbox that no older setpoint
+   * may follow, e.g. Control::emergencyBrake(); the slot stays enabled
+   */
+  void discard(Slot slot);
+
+  Stats getStats(Slot slot) const;
+  void writeMetrics(MetricsWriter& writer) const;
+
+private:
+  SetpointMailbox(const SetpointMailbox&);
+  SetpointMailbox& operator=(const SetpointMailbox&);
+
+  typedef struct Mailbox
+  {
+    SetpointMailbox*           owner;
+    const uint8_t*             cmd;
+    Atomic<int>                job;    //! scheduler job id, -1 if disabled
+    Atomic<uint32_t>           writer; //! serializes producers
+    Atomic<uint8_t>            pending;
+    Atomic<uint8_t>            sending; //! transmit() in progress
+    SeqBuffer<MAX_PAYLOAD + 1> latest; //! length byte, then the payload
+    Atomic<uint32_t>           posted;
+    Atomic<uint32_t>           sent;
+    Atomic<uint32_t>           coalesced;
+    FrameTemplate              frame; //! only touched by transmit()
+  } Mailbox;
+
+  static void transmit(time_us deadline, UserData userData);
+
+  Vehicle* vehicle;
+  Mailbox  mailboxes[SETPOINT_COUNT];
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_SETPOINT_MAILBOX_H
@@ -13,8 +13,15 @@
 #define DJI_DATASUBSCRIPTION_H
 
 #include "dji_open_protocol.hpp"
+#include "dji_package_planner.hpp"
+#include "dji_rate_monitor.hpp"
+#include "dji_seqlock.hpp"
 #include "dji_telemetry.hpp"
+#include "dji_topic_history.hpp"
 #include "dji_vehicle_callback.hpp"
+#ifndef STM32
+#include "dji_topic_snapshot.hpp"
+#endif
 
 namespace DJI
 {
@@ -24,6 +31,9 @@ namespace OSDK
 // Forward Declarations
 class Vehicle;
 
+//! Upper bound of the ADD_PACKAGE payload and of the package data
+const uint8_t ADD_PACKAEG_DATA_LENGTH = 200;
+
 /*! @brief Package class to support Subscribe-style telemetry
  *
  *  @details Use the DJI_DataSubscription class to access telemetry.
@@ -60,7 +70,6 @@ public:
    */
   bool setTopicList(Telemetry::TopicName* topics, int numberOfTopics,
                     uint16_t freq);
-  void allocateDataBuffer();
   void clearDataBuffer();
 
   void cleanUpPackage();
@@ -78,14 +87,36 @@ public:
 
   void setOccupied(bool status);
 
+  bool isPaused();
+  //! Record the FC's confirmation of a pause or resume
+  void setPaused(bool status);
+
+  //! Whether every topic of the package may be sent at freq
+  bool isFrequencyValid(uint16_t freq);
+  //! Record a rate change confirmed by the FC
+  void setFrequency(uint16_t freq);
+
+  //! Request awaiting its ACK, for the non-blocking calls
+  uint16_t getPendingFrequency();
+  void setPendingFrequency(uint16_t freq);
+
   // Accessors to private variables:
   PackageInfo            getInfo();
   uint32_t*              getUidList(); // explicitly show it's a pointer
   Telemetry::TopicName*  getTopicList();
   uint32_t*              getOffsetList();
-  uint8_t*               getDataBuffer();
   uint32_t               getBufferSize();
   VehicleCallBackHandler getUnpackHandler();
+  RateMonitor*           getRateMonitor();
+
+  //! Publish a received package, called by the decoder only
+  void updateData(const uint8_t* data, time_us arrival);
+  /*!
+   * @brief Wait-free copy of len bytes at offset from the latest package
+   * @return number of packages received when the copy was made, 0 if none
+   */
+  uint32_t readData(void* dst, uint32_t offset, size_t len) const;
+  const SeqBuffer<ADD_PACKAEG_DATA_LENGTH>& getData() const;
 
   /*!
   * @brief Helper function to do post processing when adding package is
@@ -101,8 +132,21 @@ public:
   */
   void packageRemoveSuccessHandler();
 
+  /*!
+   * @brief Point the topics of this package at it, once it has data
+   *
+   * @details A topic already carried by another running package is only
+   * taken over when this package delivers its first sample, so getValue()
+   * never reads an empty package during a make-before-break rebuild.
+   */
+  void claimTopics();
+  bool isClaimPending();
+
 private: // Private variables
   bool        occupied;
+  bool        paused;
+  bool        claimPending;
+  uint16_t    pendingFreq;
   PackageInfo info;
 
   // We have only 30 topics and 5 packages.
@@ -121,9 +165,9 @@ private: // Private variables
   uint32_t packageDataSize;
 
   /*!
-   * @brief The buffer to hold data from FC
+   * @brief The latest data from FC, read by getValue() without locking
    */
-  uint8_t* incomingDataBuffer;
+  SeqBuffer<ADD_PACKAEG_DATA_LENGTH> incomingData;
 
   /*!
    * @brief Advanced users can optionally register a callback function
@@ -131,6 +175,11 @@ private: // Private variables
    *        This function is called in the end of decodeCallback function.
    */
   VehicleCallBackHandler userUnpackHandler;
+
+  /*!
+   * @brief Measured arrival rate and jitter, checked against info.freq
+   */
+  RateMonitor rateMonitor;
 }; // class SubscriptionPackage
 
 /*! @brief Telemetry API through asynchronous "Subscribe"-style messages
@@ -202,10 +251,48 @@ public: // public methods
     int packageID, VehicleCallBack userFunctionAfterPackageExtraction,
     UserData userData = NULL);
 
-  // Not implemented yet
+  /*!
+   * @brief Stop the FC from sending package[packageID] while keeping it
+   * subscribed; getValue() keeps returning the last values received
+   * @return false if the package is not running, the request is not sent
+   */
   bool pausePackage(int packageID);
+  ACK::ErrorCode pausePackage(int packageID, int timeout); // blocking call
   bool resumePackage(int packageID);
-  // bool changePackageFrequency(int packageID, uint16_t newFreq);
+  ACK::ErrorCode resumePackage(int packageID, int timeout); // blocking call
+
+  /*!
+   * @brief Change the rate of a running package in place
+   *
+   * @details The blocking call falls back to make-before-break when the FC
+   * rejects the in-place update: a spare package carries the same topics
+   * at the new rate while package[packageID] is re-added, so the topics
+   * never stop arriving and the package keeps its ID. Without a spare
+   * package it is removed and re-added, leaving a gap.
+   * The non-blocking call only tries the in-place update.
+   */
+  bool changePackageFrequency(int packageID, uint16_t newFreq);
+  ACK::ErrorCode changePackageFrequency(int packageID, uint16_t newFreq,
+                                        int timeout); // blocking call
+
+  /*!
+   * @brief Rate and topics of a started package, paused or not
+   * @param topics if given, receives info.numberOfTopics topics
+   * @return false if package[packageID] is not running
+   */
+  bool getPackageInfo(int packageID, SubscriptionPackage::PackageInfo& info,
+                      Telemetry::TopicName* topics = 0);
+
+  /*!
+   * @brief Delivered rate and inter-arrival jitter of package[packageID]
+   * @return false for an invalid packageID
+   */
+  bool getRateStats(int packageID, RateStats& stats);
+
+  //! Close due rate windows, so that a stalled package is reported as well
+  void pollRates(time_us now);
+
+  void writeMetrics(MetricsWriter& writer);
 
   /*!
    * @brief Callback function for non-blocking verify()
@@ -225,6 +312,14 @@ public: // public methods
                                     RecvContainer rcvContainer,
                                     UserData      pkgHandle);
 
+  static void pauseResumeCallback(Vehicle* vehiclePtr,
+                                  RecvContainer rcvContainer,
+                                  UserData pkgHandle);
+
+  static void changeFrequencyCallback(Vehicle*      vehiclePtr,
+                                      RecvContainer rcvContainer,
+                                      UserData      pkgHandle);
+
   /*!
    * @brief This callback function is called by recvReqData, case
    * CMD_ID_SUBSCRIBE.
@@ -240,37 +335,193 @@ public: // public methods
   {
     typename Telemetry::TypeMap<topic>::type ans;
 
-    void* p = Telemetry::TopicDataBase[topic].latest;
+    const Telemetry::TopicInfo& info = Telemetry::TopicDataBase[topic];
 
-    protocol->getThreadHandle()->lockMSG();
-    if (p)
+    //! Never blocks the decoder, see SeqBuffer
+    if (info.pkgID < MAX_NUMBER_OF_PACKAGE)
     {
-      ans = *reinterpret_cast<typename Telemetry::TypeMap<topic>::type*>(p);
-      protocol->getThreadHandle()->freeMSG();
+      if (!package[info.pkgID].readData(&ans, info.offset, sizeof(ans)))
+      {
+        //! Subscribed, but nothing received yet
+        memset(&ans, 0, sizeof(ans));
+      }
       return ans;
     }
     else
     {
       DERROR("Topic 0x%X value memory not initialized, return default", topic);
     }
-    protocol->getThreadHandle()->freeMSG();
 
     memset(&ans, 0xFF, sizeof(ans));
     return ans;
   }
 
+#ifndef STM32
+  /*!
+   * @brief Lock-free capture of several topics at one instant
+   *
+   * @details The members may come from different packages; the capture is
+   * retried until no package involved was updated while it was being
+   * copied. Unsubscribed members read as 0xFF like getValue().
+   */
+  template <Telemetry::TopicName... topics>
+  TopicSnapshot<topics...> getValues()
+  {
+    static const Telemetry::TopicName ids[] = { topics... };
+    static const size_t               sizes[] = {
+      sizeof(typename Telemetry::TypeMap<topics>::type)...
+    };
+
+    TopicSnapshot<topics...> snapshot;
+    void*                    dst[sizeof...(topics)];
+
+    snapshot.memberPointers(dst);
+    snapshot.consistent = readTopics(ids, dst, sizes, sizeof...(topics),
+                                     snapshot.sequence, snapshot.arrival);
+    return snapshot;
+  }
+#endif
+
+  /*!
+   * @brief Set up packages 0 to plan.numberOfPackages - 1 as planned by
+   * PackagePlanner::planSubscription(), then start them as usual
+   */
+  bool initPackagesFromPlan(const PackagePlanner::SubscriptionPlan& plan);
+
+  /*!
+   * @brief Set up package packageID from a TypedPackage, then start it with
+   * startPackage() as usual
+   */
+  template <class Package>
+  bool initPackage(int packageID)
+  {
+    Telemetry::TopicName list[Package::numberOfTopics];
+    memcpy(list, Package::getTopicList(), sizeof(list));
+    return initPackageFromTopicList(packageID, Package::numberOfTopics, list,
+                                    Package::timeStamp, Package::freq);
+  }
+
+  /*!
+   * @brief Wait-free copy of the latest package in one piece
+   * @return false if package packageID does not have the Package layout or
+   * nothing was received yet
+   */
+  template <class Package>
+  bool readPackage(int packageID, typename Package::Frame& frame)
+  {
+    if (!hasLayout(packageID, Package::getUidList(), Package::numberOfTopics,
+                   Package::timeStamp))
+    {
+      return false;
+    }
+    return package[packageID].readData(&frame, 0, sizeof(frame)) != 0;
+  }
+
+  //! Whether package packageID is occupied by exactly these topics
+  bool hasLayout(int packageID, const uint32_t* uids, int numberOfTopics,
+                 bool timeStamp);
+
+  /*!
+   * @brief Keep the last capacity samples of a topic with their arrival
+   * and FC time stamps, for getValueAt(), getRange() and getLast()
+   *
+   * @note Opt-in and allocated here; call while the topic is not subscribed
+   */
+  bool enableHistory(Telemetry::TopicName topic, int capacity);
+  bool disableHistory(Telemetry::TopicName topic);
+
+  /*!
+   * @brief Value of a topic at time t, interpolated between the two
+   * samples around it (see TopicInterpolation)
+   *
+   * @param t host time (getTimeStampUs) or FC time in us
+   * @return false if the history is off or t is outside the stored span
+   */
+  template <Telemetry::TopicName topic>
+  bool getValueAt(uint64_t t, typename Telemetry::TypeMap<topic>::type& value,
+                  TopicHistory::Clock clock = TopicHistory::HOST_TIME)
+  {
+    typedef typename Telemetry::TypeMap<topic>::type T;
+
+    T      before, after;
+    double alpha;
+    if (!history[topic].bracket(t, clock, &before, &after, alpha))
+    {
+      return false;
+    }
+    value = TopicInterpolation<T>::apply(before, after, alpha);
+    return true;
+  }
+
+  //! @return number of samples stored in out with time in [t0, t1]
+  template <Telemetry::TopicName topic>
+  int getRange(uint64_t t0, uint64_t t1,
+               TopicSample<typename Telemetry::TypeMap<topic>::type>* out,
+               int maxCount,
+               TopicHistory::Clock clock = TopicHistory::HOST_TIME)
+  {
+    typedef TopicSample<typename Telemetry::TypeMap<topic>::type> S;
+
+    return history[topic].range(t0, t1, clock, &out->value, sizeof(S),
+                                &out->hostTime, &out->fcTime, sizeof(S),
+                                maxCount);
+  }
+
+  //! @return number of samples stored in out, oldest first
+  template <Telemetry::TopicName topic>
+  int getLast(int n,
+              TopicSample<typename Telemetry::TypeMap<topic>::type>* out)
+  {
+    typedef TopicSample<typename Telemetry::TypeMap<topic>::type> S;
+
+    return history[topic].last(n, &out->value, sizeof(S), &out->hostTime,
+                               &out->fcTime, sizeof(S));
+  }
+
+  /*!
+   * @brief Copy count topics, consistent across packages
+   * @param sequence,arrival per-topic package count and arrival time
+   * @return false if concurrent updates kept invalidating the capture
+   */
+  bool readTopics(const Telemetry::TopicName* topics, void* const* dst,
+                  const size_t* sizes, int count, uint32_t* sequence,
+                  time_us* arrival);
+
 public: // public variables
   const static uint8_t   MAX_NUMBER_OF_PACKAGE = 5;
+  const static int       MAX_SNAPSHOT_RETRIES  = 16;
   VehicleCallBackHandler subscriptionDataDecodeHandler;
 
 private: // private variables
   Vehicle*            vehicle;
   Protocol*           protocol;
   SubscriptionPackage package[MAX_NUMBER_OF_PACKAGE];
+  TopicHistory        history[Telemetry::TOTAL_TOPIC_NUMBER];
 
 private: // private methods
+#pragma pack(1)
+  typedef struct PauseResumeData
+  {
+    uint8_t packageID;
+    uint8_t pause; //! 1 to pause, 0 to resume
+  } PauseResumeData;
+
+  typedef struct PackageFreqData
+  {
+    uint8_t  packageID;
+    uint16_t freq;
+  } PackageFreqData;
+#pragma pack()
+
+  //! @return false if package[packageID] is not running
+  bool checkRunning(int packageID, ACK::ErrorCode* ack);
+  void sendPauseResume(int packageID, bool pause);
+  ACK::ErrorCode sendPauseResume(int packageID, bool pause, int timeout);
+  ACK::ErrorCode rebuildPackage(int packageID, uint16_t newFreq,
+                                int timeout);
+
   void extractOnePackage(RecvContainer*       pRcvContainer,
-                         SubscriptionPackage* pkg);
+                         SubscriptionPackage* pkg, time_us arrival);
 };
 }
 }
@@ -130,8 +130,8 @@ typedef struct
   const uint16_t  maxFreq; /* max freq in Hz for the topic provided by FC */
   uint16_t        freq;    /* Frequency at which the topic is subscribed */
   uint8_t         pkgID;   /* Package ID in which the topic is subscribed */
-  /* Point to topic's address in the data buffer which stores the latest data */
-  uint8_t* latest;
+  /* Offset of the topic in its package data, time stamp included */
+  uint16_t offset;
 } TopicInfo; // pack(1)
 
 /*! @brief struct for TOPIC_QUATERNION
@@ -587,6 +587,52 @@ template <> struct TypeMap<TOPIC_HARD_SYNC                > { typedef HardSyncDa
 template <> struct TypeMap<TOPIC_GPS_SIGNAL_LEVEL         > { typedef uint8_t         type;};
 template <> struct TypeMap<TOPIC_GPS_CONTROL_LEVEL        > { typedef uint8_t         type;};
 // clang-format on
+
+/*! @brief Compile-time UID and FC rate limit of each topic
+ *
+ * @details The single source of TopicDataBase's uid and maxFreq columns,
+ * also used by TypedPackage to check packages when they are compiled.
+ */
+template <TopicName T>
+struct TopicTraits;
+
+// clang-format off
+template <> struct TopicTraits<TOPIC_QUATERNION              > { static const uint32_t uid = UID_QUATERNION;               static const uint16_t maxFreq = 200; };
+template <> struct TopicTraits<TOPIC_ACCELERATION_GROUND     > { static const uint32_t uid = UID_ACCELERATION_GROUND;      static const uint16_t maxFreq = 200; };
+template <> struct TopicTraits<TOPIC_ACCELERATION_BODY       > { static const uint32_t uid = UID_ACCELERATION_BODY;        static const uint16_t maxFreq = 200; };
+template <> struct TopicTraits<TOPIC_ACCELERATION_RAW        > { static const uint32_t uid = UID_ACCELERATION_RAW;         static const uint16_t maxFreq = 400; };
+template <> struct TopicTraits<TOPIC_VELOCITY                > { static const uint32_t uid = UID_VELOCITY;                 static const uint16_t maxFreq = 200; };
+template <> struct TopicTraits<TOPIC_ANGULAR_RATE_FUSIONED   > { static const uint32_t uid = UID_ANGULAR_RATE_FUSIONED;    static const uint16_t maxFreq = 200; };
+template <> struct TopicTraits<TOPIC_ANGULAR_RATE_RAW        > { static const uint32_t uid = UID_ANGULAR_RATE_RAW;         static const uint16_t maxFreq = 400; };
+template <> struct TopicTraits<TOPIC_ALTITUDE_FUSIONED       > { static const uint32_t uid = UID_ALTITUDE_FUSIONED;        static const uint16_t maxFreq = 200; };
+template <> struct TopicTraits<TOPIC_ALTITUDE_BAROMETER      > { static const uint32_t uid = UID_ALTITUDE_BAROMETER;       static const uint16_t maxFreq = 200; };
+template <> struct TopicTraits<TOPIC_HEIGHT_HOMEPOINT        > { static const uint32_t uid = UID_HEIGHT_HOMEPOINT;         static const uint16_t maxFreq =   1; };
+template <> struct TopicTraits<TOPIC_HEIGHT_FUSION           > { static const uint32_t uid = UID_HEIGHT_FUSION;            static const uint16_t maxFreq = 100; };
+template <> struct TopicTraits<TOPIC_GPS_FUSED               > { static const uint32_t uid = UID_GPS_FUSED;                static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_GPS_DATE                > { static const uint32_t uid = UID_GPS_DATE;                 static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_GPS_TIME                > { static const uint32_t uid = UID_GPS_TIME;                 static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_GPS_POSITION            > { static const uint32_t uid = UID_GPS_POSITION;             static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_GPS_VELOCITY            > { static const uint32_t uid = UID_GPS_VELOCITY;             static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_GPS_DETAILS             > { static const uint32_t uid = UID_GPS_DETAILS;              static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_RTK_POSITION            > { static const uint32_t uid = UID_RTK_POSITION;             static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_RTK_VELOCITY            > { static const uint32_t uid = UID_RTK_VELOCITY;             static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_RTK_YAW                 > { static const uint32_t uid = UID_RTK_YAW;                  static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_RTK_POSITION_INFO       > { static const uint32_t uid = UID_RTK_POSITION_INFO;        static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_RTK_YAW_INFO            > { static const uint32_t uid = UID_RTK_YAW_INFO;             static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_COMPASS                 > { static const uint32_t uid = UID_COMPASS;                  static const uint16_t maxFreq = 100; };
+template <> struct TopicTraits<TOPIC_RC                      > { static const uint32_t uid = UID_RC;                       static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_GIMBAL_ANGLES           > { static const uint32_t uid = UID_GIMBAL_ANGLES;            static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_GIMBAL_STATUS           > { static const uint32_t uid = UID_GIMBAL_STATUS;            static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_STATUS_FLIGHT           > { static const uint32_t uid = UID_STATUS_FLIGHT;            static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_STATUS_DISPLAYMODE      > { static const uint32_t uid = UID_STATUS_DISPLAYMODE;       static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_STATUS_LANDINGGEAR      > { static const uint32_t uid = UID_STATUS_LANDINGGEAR;       static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_STATUS_MOTOR_START_ERROR> { static const uint32_t uid = UID_STATUS_MOTOR_START_ERROR; static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_BATTERY_INFO            > { static const uint32_t uid = UID_BATTERY_INFO;             static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_CONTROL_DEVICE          > { static const uint32_t uid = UID_CONTROL_DEVICE;           static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_HARD_SYNC               > { static const uint32_t uid = UID_HARD_SYNC;                static const uint16_t maxFreq = 400; };
+template <> struct TopicTraits<TOPIC_GPS_SIGNAL_LEVEL        > { static const uint32_t uid = UID_GPS_SIGNAL_LEVEL;         static const uint16_t maxFreq =  50; };
+template <> struct TopicTraits<TOPIC_GPS_CONTROL_LEVEL       > { static const uint32_t uid = UID_GPS_CONTROL_LEVEL;        static const uint16_t maxFreq =  50; };
+// clang-format on
 }
 }
 }
@@ -0,0 +1,258 @@
+/** @file dji_topic_history.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Time-indexed history of Subscribe-style telemetry topics
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_TOPIC_HISTORY_H
+#define DJI_TOPIC_HISTORY_H
+
+#include "dji_atomic.hpp"
+#include "dji_telemetry.hpp"
+#include "dji_type.hpp"
+
+#include <math.h>
+
+namespace DJI
+{
+namespace OSDK
+{
+
+//! One history entry, as returned by range and last-N queries
+template <typename T>
+struct TopicSample
+{
+  T        value;
+  time_us  hostTime; //! arrival time on this computer
+  uint64_t fcTime;   //! FC time stamp in us, 0 if the package has none
+};
+
+/*! @brief Fixed-capacity ring of one topic, single writer, many readers
+ *
+ * @details Stored as structure of arrays: the time stamps are searched
+ * without touching the values. Each slot carries the index of the sample
+ * it holds; readers check it before and after copying and retry if the
+ * writer reused the slot meanwhile, so neither side ever blocks.
+ *
+ * Queries count themselves in and out; release() waits for those in
+ * progress before freeing the arrays, so disableHistory() is safe while
+ * other threads still query the topic.
+ *
+ * Values are kept as raw bytes, the typed queries live in DataSubscription.
+ */
+class TopicHistory
+{
+public:
+  enum Clock
+  {
+    HOST_TIME = 0,
+    FC_TIME   = 1
+  };
+
+  static const int MAX_RETRIES = 8;
+
+  TopicHistory();
+  ~TopicHistory();
+
+  //! @note call before the topic's package is started
+  bool init(int capacity, int valueSize);
+  //! Waits for queries in progress, new ones find the history disabled
+  void release();
+  bool isEnabled() const;
+  int  getCapacity() const;
+
+  //! Writer side, called by the subscription decoder
+  void push(const void* value, time_us hostTime, uint64_t fcTime);
+
+  /*! @brief The samples around t
+   *
+   * @param alpha position of t between before (0) and after (1)
+   * @return false if t is outside the stored span
+   */
+  bool bracket(uint64_t t, Clock clock, void* before, void* after,
+               double& alpha) const;
+
+  //! @return number of samples with time in [t0, t1], oldest first
+  int range(uint64_t t0, uint64_t t1, Clock clock, void* values,
+            int valueStride, time_us* hostTimes, uint64_t* fcTimes,
+            int timeStride, int maxCount) const;
+
+  //! @return number of samples copied, oldest first
+  int last(int n, void* values, int valueStride, time_us* hostTimes,
+           uint64_t* fcTimes, int timeStride) const;
+
+private:
+  TopicHistory(const TopicHistory&);
+  TopicHistory& operator=(const TopicHistory&);
+
+  //! @return false if disabled, otherwise call leaveRead() when done
+  bool enterRead() const;
+  void leaveRead() const;
+  bool findBracket(uint64_t t, Clock clock, void* before, void* after,
+                   double& alpha) const;
+
+  uint64_t timeOf(uint32_t index, Clock clock) const;
+  bool copySlot(uint32_t index, void* value, time_us* hostTime,
+                uint64_t* fcTime) const;
+  //! Index of the first sample with time >= t in [first, end)
+  uint32_t lowerBound(uint32_t first, uint32_t end, uint64_t t,
+                      Clock clock) const;
+
+private:
+  int               capacity;
+  int               valueSize;
+  time_us*          hostTime;
+  uint64_t*         fcTime;
+  uint8_t*          values;
+  Atomic<uint32_t>* slotIndex; //! 1 + index of the sample held, 0 = empty
+  Atomic<uint32_t>  count;     //! samples pushed so far
+  Atomic<bool>      enabled;
+  mutable Atomic<uint32_t> readers; //! queries in progress
+};
+
+/*! @brief How to blend two samples of a topic type
+ *
+ * @details Linear interpolation for float vectors and positions, slerp for
+ * quaternions; everything else (flags, counters, status) takes the nearest
+ * sample.
+ */
+template <typename T>
+struct TopicInterpolation
+{
+  static T apply(const T& a, const T& b, double alpha)
+  {
+    return alpha < 0.5 ? a : b;
+  }
+};
+
+template <>
+struct TopicInterpolation<float32_t>
+{
+  static float32_t apply(float32_t a, float32_t b, double alpha)
+  {
+    return (float32_t)(a + (b - a) * alpha);
+  }
+};
+
+template <>
+struct TopicInterpolation<Telemetry::Vector3f>
+{
+  static Telemetry::Vector3f apply(const Telemetry::Vector3f& a,
+                                   const Telemetry::Vector3f& b, double alpha)
+  {
+    Telemetry::Vector3f v;
+    v.x = (float32_t)(a.x + (b.x - a.x) * alpha);
+    v.y = (float32_t)(a.y + (b.y - a.y) * alpha);
+    v.z = (float32_t)(a.z + (b.z - a.z) * alpha);
+    return v;
+  }
+};
+
+template <>
+struct TopicInterpolation<Telemetry::Vector3d>
+{
+  static Telemetry::Vector3d apply(const Telemetry::Vector3d& a,
+                                   const Telemetry::Vector3d& b, double alpha)
+  {
+    Telemetry::Vector3d v;
+    v.x = (int32_t)floor(a.x + ((double)b.x - a.x) * alpha + 0.5);
+    v.y = (int32_t)floor(a.y + ((double)b.y - a.y) * alpha + 0.5);
+    v.z = (int32_t)floor(a.z + ((double)b.z - a.z) * alpha + 0.5);
+    return v;
+  }
+};
+
+template <>
+struct TopicInterpolation<Telemetry::Velocity>
+{
+  static Telemetry::Velocity apply(const Telemetry::Velocity& a,
+                                   const Telemetry::Velocity& b, double alpha)
+  {
+    Telemetry::Velocity v = alpha < 0.5 ? a : b;
+    v.data = TopicInterpolation<Telemetry::Vector3f>::apply(a.data, b.data,
+                                                            alpha);
+    return v;
+  }
+};
+
+template <>
+struct TopicInterpolation<Telemetry::GPSFused>
+{
+  static Telemetry::GPSFused apply(const Telemetry::GPSFused& a,
+                                   const Telemetry::GPSFused& b, double alpha)
+  {
+    Telemetry::GPSFused v = alpha < 0.5 ? a : b;
+    v.longitude = a.longitude + (b.longitude - a.longitude) * alpha;
+    v.latitude  = a.latitude + (b.latitude - a.latitude) * alpha;
+    v.altitude  = (float32_t)(a.altitude + (b.altitude - a.altitude) * alpha);
+    return v;
+  }
+};
+
+template <>
+struct TopicInterpolation<Telemetry::PositionData>
+{
+  static Telemetry::PositionData apply(const Telemetry::PositionData& a,
+                                       const Telemetry::PositionData& b,
+                                       double                         alpha)
+  {
+    Telemetry::PositionData v;
+    v.longitude = a.longitude + (b.longitude - a.longitude) * alpha;
+    v.latitude  = a.latitude + (b.latitude - a.latitude) * alpha;
+    v.HFSL      = (float32_t)(a.HFSL + (b.HFSL - a.HFSL) * alpha);
+    return v;
+  }
+};
+
+template <>
+struct TopicInterpolation<Telemetry::Quaternion>
+{
+  static Telemetry::Quaternion apply(const Telemetry::Quaternion& a,
+                                     const Telemetry::Quaternion& b,
+                                     double                       alpha)
+  {
+    double dot = (double)a.q0 * b.q0 + (double)a.q1 * b.q1 +
+                 (double)a.q2 * b.q2 + (double)a.q3 * b.q3;
+    //! q and -q are the same rotation: take the short way round
+    double sign = dot < 0 ? -1.0 : 1.0;
+    dot *= sign;
+
+    double wa, wb;
+    if (dot > 0.9995)
+    {
+      //! Nearly parallel, slerp degenerates to lerp
+      wa = 1.0 - alpha;
+      wb = alpha * sign;
+    }
+    else
+    {
+      double theta = acos(dot);
+      double s     = sin(theta);
+      wa           = sin((1.0 - alpha) * theta) / s;
+      wb           = sin(alpha * theta) / s * sign;
+    }
+
+    double q0 = wa * a.q0 + wb * b.q0;
+    double q1 = wa * a.q1 + wb * b.q1;
+    double q2 = wa * a.q2 + wb * b.q2;
+    double q3 = wa * a.q3 + wb * b.q3;
+    double n  = sqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+
+    Telemetry::Quaternion q;
+    q.q0 = (float32_t)(q0 / n);
+    q.q1 = (float32_t)(q1 / n);
+    q.q2 = (float32_t)(q2 / n);
+    q.q3 = (float32_t)(q3 / n);
+    return q;
+  }
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_TOPIC_HISTORY_H
@@ -0,0 +1,98 @@
+/** @file dji_topic_snapshot.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Consistent multi-topic snapshot of Subscribe-style telemetry
+ *
+ *  @note Needs the C++11 standard library, not available on STM32 (ARMCC 5)
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_TOPIC_SNAPSHOT_H
+#define DJI_TOPIC_SNAPSHOT_H
+
+#include "dji_telemetry.hpp"
+#include "dji_type.hpp"
+
+#include <stddef.h>
+#include <tuple>
+
+namespace DJI
+{
+namespace OSDK
+{
+
+//! Compile-time index list, to walk a tuple alongside a topic pack
+template <int... I>
+struct TopicIndices
+{
+};
+
+template <int N, int... I>
+struct MakeTopicIndices : MakeTopicIndices<N - 1, N - 1, I...>
+{
+};
+
+template <int... I>
+struct MakeTopicIndices<0, I...>
+{
+  typedef TopicIndices<I...> type;
+};
+
+/*! @brief Values of several topics captured at one instant
+ *
+ * @details Returned by DataSubscription::getValues<topics...>(). For every
+ * member, sequence[i] is the number of packages received in the member's
+ * package when it was copied (0: not subscribed or nothing received yet)
+ * and arrival[i] the host time of that package in microseconds.
+ *
+ * Example:
+ *   auto s = subscribe->getValues<TOPIC_QUATERNION, TOPIC_VELOCITY>();
+ *   Telemetry::Quaternion q = s.get<0>();
+ */
+template <Telemetry::TopicName... topics>
+class TopicSnapshot
+{
+public:
+  static const int SIZE = sizeof...(topics);
+  static_assert(SIZE > 0, "A snapshot needs at least one topic");
+
+  typedef std::tuple<typename Telemetry::TypeMap<topics>::type...> Values;
+
+  Values   values;
+  uint32_t sequence[SIZE];
+  time_us  arrival[SIZE];
+  //! False if concurrent updates kept invalidating the capture
+  bool consistent;
+
+  template <int I>
+  const typename std::tuple_element<I, Values>::type& get() const
+  {
+    return std::get<I>(values);
+  }
+
+  //! Destination of each member, in topic order
+  void memberPointers(void** dst)
+  {
+    memberPointers(dst, typename MakeTopicIndices<SIZE>::type());
+  }
+
+private:
+  template <int... I>
+  void memberPointers(void** dst, TopicIndices<I...>)
+  {
+    void* members[] = { &std::get<I>(values)... };
+    for (int i = 0; i < SIZE; i++)
+    {
+      dst[i] = members[i];
+    }
+  }
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_TOPIC_SNAPSHOT_H
@@ -134,6 +134,8 @@ typedef struct CMDSession
   int      callbackID;
   uint32_t preSeqNum;
   time_ms  preTimestamp;
+  time_us  sendTimestamp; //! first write, for latency statistics
+  uint8_t  txClass;       //! TxScheduler::TxClass, charged on retries
 } CMDSession;
 
 typedef struct ACKSession
@@ -154,6 +156,7 @@ typedef struct DispatchInfo
   bool    isAck;
   bool    isCallback;
   uint8_t callbackID;
+  uint8_t sessionID; //! session of the received frame, for tracing
 } DispatchInfo;
 
 /*!
@@ -0,0 +1,272 @@
+/** @file dji_typed_command.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  OpenProtocol commands bound at compile time to their payload, ACK and
+ *  session policy
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_TYPED_COMMAND_H
+#define DJI_TYPED_COMMAND_H
+
+#include "dji_ack.hpp"
+#include "dji_control.hpp"
+#include "dji_gimbal.hpp"
+#include "dji_hardware_sync.hpp"
+#include "dji_memory.hpp"
+#include "dji_open_protocol.hpp"
+
+#include <string.h>
+
+namespace DJI
+{
+namespace OSDK
+{
+
+/*! @brief ACK decoders of the typed commands
+ *
+ * @details Each one reads its result straight out of the received frame,
+ * so a typed blocking call does not go through Vehicle::ACKHandler()'s
+ * cmd comparisons. If no ACK for the command arrived before the timeout,
+ * data is NO_RESPONSE_ERROR.
+ */
+struct NoACK
+{
+  static const bool none = true;
+  typedef void      Type;
+};
+
+//! One result byte: the control, mission, subscribe and MFIO init sets
+struct ByteACK
+{
+  static const bool      none = false;
+  typedef ACK::ErrorCode Type;
+
+  static Type decode(const RecvContainer& frame, bool received)
+  {
+    Type ack;
+    ack.info = frame.recvInfo;
+    ack.data = received
+                 ? frame.recvData.commandACK
+                 : OpenProtocol::ErrorCode::CommonACK::NO_RESPONSE_ERROR;
+    return ack;
+  }
+};
+
+//! Two result bytes, the activation and MFIO set commands
+struct WordACK
+{
+  static const bool      none = false;
+  typedef ACK::ErrorCode Type;
+
+  static Type decode(const RecvContainer& frame, bool received)
+  {
+    Type ack;
+    ack.info = frame.recvInfo;
+    ack.data = received
+                 ? frame.recvData.ack
+                 : OpenProtocol::ErrorCode::CommonACK::NO_RESPONSE_ERROR;
+    return ack;
+  }
+};
+
+struct MFIOGetACK
+{
+  static const bool   none = false;
+  typedef ACK::MFIOGet Type;
+
+  static Type decode(const RecvContainer& frame, bool received)
+  {
+    Type ack;
+    ack.ack.info = frame.recvInfo;
+    if (received)
+    {
+      ack.ack.data = frame.recvData.mfioGetACK.result;
+      ack.value    = frame.recvData.mfioGetACK.value;
+    }
+    else
+    {
+      ack.ack.data = OpenProtocol::ErrorCode::CommonACK::NO_RESPONSE_ERROR;
+      ack.value    = 0;
+    }
+    return ack;
+  }
+};
+
+/*! @brief An OpenProtocol command with its payload, ACK and send policy
+ *
+ * @details Vehicle::send<Cmd>() takes the payload by type, so a payload of
+ * the wrong size does not compile, and session, timeout and retries come
+ * from the descriptor instead of each call site.
+ *
+ * @code
+ * ACK::ErrorCode ack = vehicle->send<Cmd::SetArm>(1, 10);
+ * vehicle->send<Cmd::GimbalSpeed>(speed);
+ * @endcode
+ *
+ * @param CMD one of the OpenProtocol::CMDSet arrays, so the ids are
+ * defined in dji_command.cpp only
+ * @param SESSION 0: no ACK, 1: ACK with retries in session 1,
+ * 2: ACK with retries in sessions 2-31
+ * @param TIMEOUT retransmission timeout in ms, at least POLL_TICK
+ */
+template <const uint8_t* CMD, typename PayloadType, typename ACKDecoder,
+          uint8_t SESSION, uint16_t TIMEOUT = 0, uint8_t RETRY = 1,
+          bool ENCRYPT = false>
+struct CommandDescriptor
+{
+  typedef PayloadType Payload;
+  typedef ACKDecoder  Decoder;
+
+  //! { cmd_set, cmd_id }
+  static const uint8_t* cmd()
+  {
+    return CMD;
+  }
+
+  static const uint8_t  session   = SESSION;
+  static const uint16_t timeout   = TIMEOUT;
+  static const uint8_t  retry     = RETRY;
+  static const bool     encrypted = ENCRYPT;
+
+  static_assert(SESSION <= 2, "Session mode is 0, 1 or 2");
+  static_assert((SESSION == 0) == ACKDecoder::none,
+                "Session 0 commands are the only ones without an ACK");
+  static_assert(sizeof(Payload) + SET_CMD_SIZE <= PRO_PURE_DATA_MAX_SIZE,
+                "Payload exceeds PRO_PURE_DATA_MAX_SIZE");
+};
+
+//! Descriptors of the commands the SDK sends
+namespace Cmd
+{
+typedef CommandDescriptor<OpenProtocol::CMDSet::Control::setControl, uint8_t,
+                          ByteACK, 2, 500, 2>
+  SetControl;
+typedef CommandDescriptor<OpenProtocol::CMDSet::Control::task, uint8_t,
+                          ByteACK, 2, 500, 2>
+  FlightTask;
+typedef CommandDescriptor<OpenProtocol::CMDSet::Control::control,
+                          Control::CtrlData, NoACK, 0>
+  FlightControl;
+typedef CommandDescriptor<OpenProtocol::CMDSet::Control::control,
+                          Control::AdvancedCtrlData, NoACK, 0>
+  AdvancedFlightControl;
+typedef CommandDescriptor<OpenProtocol::CMDSet::Control::setArm, uint8_t,
+                          ByteACK, 2, 10, 10>
+  SetArm;
+typedef CommandDescriptor<OpenProtocol::CMDSet::Control::gimbalSpeed,
+                          Gimbal::SpeedData, NoACK, 0>
+  GimbalSpeed;
+typedef CommandDescriptor<OpenProtocol::CMDSet::Control::gimbalAngle,
+                          Gimbal::AngleData, NoACK, 0>
+  GimbalAngle;
+typedef CommandDescriptor<OpenProtocol::CMDSet::Control::cameraShot, uint8_t,
+                          NoACK, 0>
+  CameraShot;
+typedef CommandDescriptor<OpenProtocol::CMDSet::Control::cameraVideoStart,
+                          uint8_t, NoACK, 0>
+  CameraVideoStart;
+typedef CommandDescriptor<OpenProtocol::CMDSet::Control::cameraVideoStop,
+                          uint8_t, NoACK, 0>
+  CameraVideoStop;
+typedef CommandDescriptor<OpenProtocol::CMDSet::MFIO::get, uint32_t,
+                          MFIOGetACK, 2, 500, 3>
+  MFIOGet;
+typedef CommandDescriptor<OpenProtocol::CMDSet::HardwareSync::broadcast,
+                          HardwareSync::SyncSettings, NoACK, 0>
+  SyncPulse;
+} // namespace Cmd
+
+/*! @brief Commands to send back to back with Vehicle::sendBurst()
+ *
+ * @details Payloads are copied in, so the burst can be built from
+ * temporaries. ACKs of the commands go through the usual blocking ACK
+ * handling; the burst must outlive them only for commands whose ACK
+ * handler reads the sent data, i.e. obtain/release control.
+ *
+ * @code
+ * CommandBurst burst;
+ * burst.add<Cmd::GimbalAngle>(angle);
+ * burst.add<Cmd::CameraShot>(1);
+ * BurstResult result;
+ * vehicle->sendBurst(burst, &result);
+ * @endcode
+ */
+class CommandBurst
+{
+public:
+  CommandBurst()
+    : count(0)
+    , used(0)
+  {
+  }
+
+  template <typename Cmd>
+  bool add(const typename Cmd::Payload& payload)
+  {
+    return add(Cmd::session, Cmd::encrypted, Cmd::cmd(), &payload,
+               sizeof(payload), Cmd::timeout, Cmd::retry);
+  }
+
+  //! Same arguments as Protocol::send()
+  //! @return false if the burst is full
+  bool add(uint8_t session_mode, bool is_enc, const uint8_t cmd[],
+           const void* pdata, size_t len, int timeout = 0,
+           int retry_time = 1)
+  {
+    if (count == Protocol::MAX_BURST_FRAMES ||
+        used + SET_CMD_SIZE + len > sizeof(data))
+    {
+      return false;
+    }
+    uint8_t* buf = data + used;
+    buf[0]       = cmd[0];
+    buf[1]       = cmd[1];
+    memcpy(buf + SET_CMD_SIZE, pdata, len);
+
+    Command& command    = commands[count++];
+    command.sessionMode = session_mode;
+    command.encrypt     = is_enc ? 1 : 0;
+    command.retry       = retry_time;
+    command.timeout     = timeout;
+    command.length      = len + SET_CMD_SIZE;
+    command.buf         = buf;
+    command.cmd_set     = cmd[0];
+    command.cmd_id      = cmd[1];
+    command.isCallback  = false;
+    command.callbackID  = 0;
+    used += SET_CMD_SIZE + len;
+    return true;
+  }
+
+  void clear()
+  {
+    count = 0;
+    used  = 0;
+  }
+
+  int size() const
+  {
+    return count;
+  }
+
+  const Command* getCommands() const
+  {
+    return commands;
+  }
+
+private:
+  Command commands[Protocol::MAX_BURST_FRAMES];
+  uint8_t data[Protocol::BURST_BUFFER_SIZE];
+  int     count;
+  size_t  used;
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_TYPED_COMMAND_H
@@ -0,0 +1,234 @@
+/** @file dji_typed_package.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Subscription packages with a layout fixed at compile time
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_TYPED_PACKAGE_H
+#define DJI_TYPED_PACKAGE_H
+
+#include "dji_open_protocol.hpp"
+#include "dji_subscription.hpp"
+#include "dji_telemetry.hpp"
+
+#include <string.h>
+
+namespace DJI
+{
+namespace OSDK
+{
+
+#pragma pack(1)
+//! The topics of a package back to back, exactly as the FC sends them
+template <Telemetry::TopicName... topics>
+struct PackedTopics;
+
+template <Telemetry::TopicName T>
+struct PackedTopics<T>
+{
+  typename Telemetry::TypeMap<T>::type value;
+};
+
+template <Telemetry::TopicName T, Telemetry::TopicName N,
+          Telemetry::TopicName... R>
+struct PackedTopics<T, N, R...>
+{
+  typename Telemetry::TypeMap<T>::type value;
+  PackedTopics<N, R...>                rest;
+};
+
+//! A received package: optional FC time stamp, then the topics
+template <bool TIME_STAMP, typename Data>
+struct TypedFrame
+{
+  Telemetry::TimeStamp stamp;
+  Data                 data;
+};
+
+template <typename Data>
+struct TypedFrame<false, Data>
+{
+  Data data;
+};
+#pragma pack()
+
+//! Compile-time folds over a topic list
+template <Telemetry::TopicName... topics>
+struct TopicListInfo;
+
+template <>
+struct TopicListInfo<>
+{
+  static const size_t   size    = 0;
+  static const uint16_t maxFreq = 0xFFFF;
+  static const bool     unique  = true;
+
+  template <Telemetry::TopicName X>
+  struct Contains
+  {
+    static const bool value = false;
+  };
+
+  template <Telemetry::TopicName X>
+  struct IndexOf
+  {
+    static const int value = -1;
+  };
+};
+
+template <Telemetry::TopicName T, Telemetry::TopicName... R>
+struct TopicListInfo<T, R...>
+{
+  typedef TopicListInfo<R...> Rest;
+
+  static const size_t size =
+    sizeof(typename Telemetry::TypeMap<T>::type) + Rest::size;
+  static const uint16_t maxFreq =
+    Telemetry::TopicTraits<T>::maxFreq < Rest::maxFreq
+      ? Telemetry::TopicTraits<T>::maxFreq
+      : Rest::maxFreq;
+  static const bool unique =
+    !Rest::template Contains<T>::value && Rest::unique;
+
+  template <Telemetry::TopicName X>
+  struct Contains
+  {
+    static const bool value =
+      X == T || Rest::template Contains<X>::value;
+  };
+
+  template <Telemetry::TopicName X>
+  struct IndexOf
+  {
+    static const int value =
+      X == T ? 0 : (Rest::template IndexOf<X>::value < 0
+                      ? -1
+                      : Rest::template IndexOf<X>::value + 1);
+  };
+};
+
+//! Member I of a PackedTopics, by value since packed members can not be
+//! bound to references
+template <int I, Telemetry::TopicName... topics>
+struct PackedTopicAt;
+
+template <Telemetry::TopicName T, Telemetry::TopicName... R>
+struct PackedTopicAt<0, T, R...>
+{
+  typedef typename Telemetry::TypeMap<T>::type type;
+
+  static type get(const PackedTopics<T, R...>& p)
+  {
+    return p.value;
+  }
+  static void set(PackedTopics<T, R...>& p, const type& v)
+  {
+    p.value = v;
+  }
+};
+
+template <int I, Telemetry::TopicName T, Telemetry::TopicName... R>
+struct PackedTopicAt<I, T, R...>
+{
+  typedef PackedTopicAt<I - 1, R...> Next;
+  typedef typename Next::type        type;
+
+  static type get(const PackedTopics<T, R...>& p)
+  {
+    return Next::get(p.rest);
+  }
+  static void set(PackedTopics<T, R...>& p, const type& v)
+  {
+    Next::set(p.rest, v);
+  }
+};
+
+/*! @brief Subscription package whose layout is checked by the compiler
+ *
+ * @details Packed layout, size, UID list and the frequency limit all come
+ * from TypeMap<> and TopicTraits<>; an oversized package, a frequency
+ * above a topic's maxFreq or a repeated topic does not compile.
+ *
+ * @code
+ * typedef TypedPackage<50, false, TOPIC_QUATERNION, TOPIC_VELOCITY> Pkg;
+ * vehicle->subscribe->initPackage<Pkg>(0);
+ * ...
+ * Pkg::Frame f;
+ * if (vehicle->subscribe->readPackage<Pkg>(0, f))
+ *   Telemetry::Quaternion q = Pkg::get<TOPIC_QUATERNION>(f.data);
+ * @endcode
+ *
+ * @param FREQ package frequency in Hz
+ * @param TIME_STAMP whether the FC prefixes each package with its time
+ */
+template <uint16_t FREQ, bool TIME_STAMP, Telemetry::TopicName... topics>
+class TypedPackage
+{
+public:
+  typedef TopicListInfo<topics...>     Info;
+  typedef PackedTopics<topics...>      Data;
+  typedef TypedFrame<TIME_STAMP, Data> Frame;
+
+  static const uint16_t freq           = FREQ;
+  static const bool     timeStamp      = TIME_STAMP;
+  static const int      numberOfTopics = sizeof...(topics);
+  static const size_t   dataSize       = Info::size;
+
+  static_assert(sizeof...(topics) > 0, "A package needs at least one topic");
+  static_assert(Info::unique, "A topic appears twice in the package");
+  static_assert(FREQ > 0 && FREQ <= Info::maxFreq,
+                "Package frequency is above the maxFreq of one of its topics");
+  static_assert(sizeof(Data) == Info::size, "Topic layout is not packed");
+  static_assert(sizeof(Frame) <= ADD_PACKAEG_DATA_LENGTH,
+                "Package payload exceeds ADD_PACKAEG_DATA_LENGTH");
+
+  static const Telemetry::TopicName* getTopicList()
+  {
+    static const Telemetry::TopicName list[] = { topics... };
+    return list;
+  }
+
+  static const uint32_t* getUidList()
+  {
+    static const uint32_t list[] = { Telemetry::TopicTraits<topics>::uid... };
+    return list;
+  }
+
+  //! Value of one topic of the package
+  template <Telemetry::TopicName topic>
+  static typename Telemetry::TypeMap<topic>::type get(const Data& data)
+  {
+    static_assert(Info::template Contains<topic>::value,
+                  "Topic is not part of this package");
+    return PackedTopicAt<Info::template IndexOf<topic>::value,
+                         topics...>::get(data);
+  }
+
+  /*!
+   * @brief Copy a received package, e.g. in the package unpack callback
+   * @return false if the frame is shorter than this layout
+   */
+  static bool decode(const RecvContainer& rcv, Frame& frame)
+  {
+    //! The package ID byte precedes the data
+    int available = (int)rcv.recvInfo.len - (Protocol::PackageMin + 2) - 1;
+    if (available < (int)sizeof(Frame))
+    {
+      DERROR("Package %d is %d bytes, expected %d",
+             rcv.recvData.subscribeACK, available, (int)sizeof(Frame));
+      return false;
+    }
+    memcpy(&frame, rcv.recvData.raw_ack_array + 1, sizeof(Frame));
+    return true;
+  }
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_TYPED_PACKAGE_H
@@ -15,24 +15,33 @@
 #include <cstdint>
 
 #include "dji_broadcast.hpp"
+#include "dji_callback_profiler.hpp"
 #include "dji_camera.hpp"
 #include "dji_circular_buffer.hpp"
+#include "dji_clock_sync.hpp"
 #include "dji_command.hpp"
 #include "dji_control.hpp"
+#include "dji_dispatch_table.hpp"
 #include "dji_gimbal.hpp"
 #include "dji_hard_driver.hpp"
 #include "dji_hardware_sync.hpp"
+#include "dji_link_quality.hpp"
 #include "dji_mfio.hpp"
 #include "dji_mission_manager.hpp"
 #include "dji_mobile_communication.hpp"
 #include "dji_open_protocol.hpp"
+#include "dji_periodic_scheduler.hpp"
+#include "dji_setpoint_mailbox.hpp"
 #include "dji_status.hpp"
 #include "dji_subscription.hpp"
 #include "dji_thread_manager.hpp"
 #include "dji_type.hpp"
+#include "dji_typed_command.hpp"
+#include "dji_typed_package.hpp"
 #include "dji_vehicle_callback.hpp"
 #include "dji_version.hpp"
 #include "dji_virtual_rc.hpp"
+#include "dji_worker_pool.hpp"
 
 /*! Platform includes:
  *  This set of macros figures out which files to include based on your
@@ -44,7 +53,9 @@
 #elif STM32
 #include <STM32F4DataGuard.h>
 #elif defined(__linux__)
+#include "posix_periodic_scheduler.hpp"
 #include "posix_thread.hpp"
+#include "posix_worker_pool.hpp"
 #endif
 
 namespace DJI
@@ -218,6 +229,51 @@ public:
   void* waitForACK(const uint8_t (&cmd)[OpenProtocol::MAX_CMD_ARRAY_SIZE],
                    int timeout);
 
+  /*! @brief Send a command described by a CommandDescriptor, non-blocking
+   * @details The callback gets the ACK frame; ignored for session 0
+   */
+  template <typename Cmd>
+  void send(const typename Cmd::Payload& payload, VehicleCallBack callback = 0,
+            UserData userData = 0)
+  {
+    int cbIndex = 0;
+    if (callback && Cmd::session != 0)
+    {
+      cbIndex                      = callbackIdIndex();
+      nbCallbackFunctions[cbIndex] = (void*)callback;
+      nbUserData[cbIndex]          = userData;
+    }
+    protocolLayer->send(Cmd::session, Cmd::encrypted, Cmd::cmd(),
+                        (void*)&payload,
+                        sizeof(payload), Cmd::timeout, Cmd::retry,
+                        callback != 0 && Cmd::session != 0, cbIndex);
+  }
+
+  /*! @brief Send a command described by a CommandDescriptor and wait for
+   *  its ACK, decoded by the descriptor's ACK decoder
+   */
+  template <typename Cmd>
+  typename Cmd::Decoder::Type send(const typename Cmd::Payload& payload,
+                                   int timeout)
+  {
+    static_assert(!Cmd::Decoder::none, "Session 0 commands have no ACK");
+    RecvContainer frame;
+    expectACKFrame(Cmd::cmd()[0], Cmd::cmd()[1]);
+    protocolLayer->send(Cmd::session, Cmd::encrypted, Cmd::cmd(),
+                        (void*)&payload, sizeof(payload), Cmd::timeout,
+                        Cmd::retry, false, 0);
+    bool received =
+      waitForACKFrame(Cmd::cmd()[0], Cmd::cmd()[1], timeout, frame);
+    return Cmd::Decoder::decode(frame, received);
+  }
+
+  /*! @brief Send the commands of a burst back to back, in one write
+   *  @details e.g. a gimbal angle and the photo it was framed for, or an
+   *  MFIO trigger and its hardware sync tag. See Protocol::sendBurst().
+   *  @return 0 on success, -1 if nothing was sent
+   */
+  int sendBurst(const CommandBurst& burst, BurstResult* result = 0);
+
   ///////////// Interact with Protocol ///////////
 
   /*! @brief This function takes a frame and calls the right handlers/functions
@@ -235,6 +291,73 @@ public:
   void*    nbCallbackFunctions[200]; //! @todo magic number
   UserData nbUserData[200];          //! @todo magic number
 
+  /*! @brief Run a user callback, timed by the callback profiler
+   *
+   * @param deferrable true for push data handlers on the read thread; if the
+   * profiler isolated the handler, its latest frame is handed to a worker
+   * lane of its own and older frames not yet run are dropped.
+   */
+  void invokeUserCallback(VehicleCallBackHandler handler,
+                          RecvContainer& recvFrame, bool deferrable = true);
+  CallbackProfiler* getCallbackProfiler();
+
+  /*! @brief FC/host clock mapping, fed by every frame with an FC time stamp
+   *  (subscription packages with time stamps, broadcast)
+   *  @note TOPIC_HARD_SYNC is not a source: it holds the FC time of the last
+   *  sync pulse, not of the package
+   */
+  ClockSync* getClockSync();
+
+  ///////////// Push data dispatch ///////////
+
+  /*! @brief Receive a push command, whether or not the SDK decodes it
+   *
+   * @details Any number of subscribers per (cmd_set, cmd_id); they run
+   * after the SDK's own handler, in registration order. With the queued
+   * policies the callback runs on a worker lane of its own, so a slow
+   * subscriber holds up neither the others nor the non-blocking ACK
+   * callbacks, and the policy decides which frames are dropped when it
+   * falls behind; without thread support every policy runs inline.
+   *
+   * @return subscriber id for unsubscribePushData(), -1 if the table is full
+   */
+  int subscribePushData(
+    uint8_t cmdSet, uint8_t cmdId, VehicleCallBack callback,
+    UserData                  userData   = 0,
+    DispatchTable::DropPolicy policy     = DispatchTable::DISPATCH_INLINE,
+    int                       queueDepth = 8);
+  bool unsubscribePushData(int id);
+  DispatchTable* getDispatchTable();
+
+  //! Queue a callback to the callback thread, or run it with no thread
+  void deferCallback(VehicleCallBackHandler handler, RecvContainer& recvFrame);
+
+  ///////////// Periodic jobs ///////////
+
+  /*! @brief Fixed-rate jobs, e.g. streaming control, virtual RC or gimbal
+   *  setpoints
+   *
+   * @details Created on first use. Add the jobs, then call start(); on
+   * platforms without a scheduler thread call runDue() from a timer
+   * instead. Stopped when the Vehicle is destroyed.
+   */
+  PeriodicScheduler* getScheduler();
+
+  //! Latest-value-wins sending of control, gimbal and virtual RC setpoints
+  SetpointMailbox* getSetpoints();
+
+  //! Link-quality score, optionally lowering telemetry rates when it drops
+  LinkQuality* getLinkQuality();
+
+  ///////////// Metrics ///////////
+
+  /*! @brief Link, command latency, subscription and broadcast rate metrics
+   *  in the Prometheus text format
+   */
+  void writeMetrics(MetricsWriter& writer);
+  //! @note atomically replaces the file at path, e.g. for a textfile collector
+  bool exportMetrics(const char* path);
+
 private:
   Version::VersionData versionData;
   ActivateData         accountData;
@@ -251,6 +374,22 @@ private:
 
   //! ACK management
 
+  /*!
+   * @brief Forget the last ACK before sending a command waited on with
+   * waitForACKFrame()
+   * @details Until then its ACK skips ACKHandler(): the typed decoder reads
+   * it straight from the frame. With two typed calls in flight only the
+   * later one skips it.
+   */
+  void expectACKFrame(uint8_t cmdSet, uint8_t cmdId);
+  /*!
+   * @brief Wait for an ACK and copy its frame, for the typed send<Cmd>()
+   * @details ACKs for other commands are skipped
+   * @return false if no ACK for the command came within timeout seconds
+   */
+  bool waitForACKFrame(uint8_t cmdSet, uint8_t cmdId, int timeout,
+                       RecvContainer& frame);
+
   // Internal space
   uint8_t rawVersionACK[MAX_ACK_SIZE];
 
@@ -280,6 +419,65 @@ private:
 
   //! Added for connecting protocolLayer to Vehicle
   RecvContainer lastReceivedFrame;
+  //! cmd_set << 8 | cmd_id of the typed call waiting, NO_TYPED_ACK if none
+  Atomic<uint16_t> typedACK;
+  static const uint16_t NO_TYPED_ACK = 0xFFFF;
+
+  CallbackProfiler callbackProfiler;
+  ClockSync        clockSync;
+  DispatchTable    dispatchTable;
+
+  PeriodicScheduler* scheduler;
+  SetpointMailbox    setpoints;
+  LinkQuality        linkQuality;
+
+  //! Threads for consumers that must not hold up the read or callback
+  //! thread; without them the callback thread runs the lanes
+  WorkerPool* workers;
+  bool        workerThreads;
+
+  //! Latest frame of an isolated push data handler, run on its own lane
+  typedef struct IsolatedSlot
+  {
+    Vehicle*                         vehicle;
+    VehicleCallBackHandler           handler;
+    int                              lane;
+    SeqBuffer<sizeof(RecvContainer)> latest;
+    Atomic<uint32_t>                 taken; //! write count last run
+  } IsolatedSlot;
+
+  IsolatedSlot isolatedSlots[CallbackProfiler::TABLE_SIZE];
+  int          isolatedCount; //! read thread only
+
+  bool        deferIsolated(VehicleCallBackHandler handler,
+                            RecvContainer&         recvFrame);
+  static bool runIsolated(UserData userData);
+
+  //! Push data routed to the SDK's own modules, see DispatchTable::setTag()
+  enum PushTag
+  {
+    PUSH_NONE,
+    PUSH_BROADCAST,
+    PUSH_SUBSCRIBE,
+    PUSH_MOBILE,
+    PUSH_MISSION,
+    PUSH_WAYPOINT
+  };
+
+  void initDispatch();
+  void missionPushData(RecvContainer* pushDataEntry);
+
+  //! Worker lane of a dispatch table node, for its queued subscribers
+  typedef struct SubscriberLane
+  {
+    Vehicle* vehicle;
+    int      index;
+    int      lane; //! -1 until the first queued frame
+  } SubscriberLane;
+
+  SubscriberLane subscriberLanes[DispatchTable::MAX_SUBSCRIBERS];
+
+  static bool runSubscriber(UserData userData);
 
   /*
    * @brief Vehicle initialization components
@@ -123,6 +123,7 @@ public:
 private:
   Vehicle*      vehicle;
   VirtualRCData vrcData;
+  FrameTemplate dataFrame;
 };
 
 } //! namespace OSDK
@@ -0,0 +1,102 @@
+/** @file dji_worker_pool.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Worker lanes for consumers that must not hold up each other
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_WORKER_POOL_H
+#define DJI_WORKER_POOL_H
+
+#include "dji_atomic.hpp"
+#include "dji_type.hpp"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+//! Number of worker lanes
+#ifndef OSDK_WORKER_LANES
+#ifdef STM32
+#define OSDK_WORKER_LANES 8
+#else
+#define OSDK_WORKER_LANES 64
+#endif
+#endif
+
+//! Number of worker threads, where the platform has them
+#ifndef OSDK_WORKER_THREADS
+#define OSDK_WORKER_THREADS 4
+#endif
+
+/*! @brief Runs one step of a lane's work
+ *  @return true if the lane has more work pending
+ */
+typedef bool (*LaneCallBack)(UserData userData);
+
+/*! @brief Lanes of work shared out over a few threads
+ *
+ * @details A lane is one consumer, e.g. a queued push data subscriber. The
+ * producer post()s it after queueing its work; a worker runs one step of
+ * the lane, then moves on to the next ready lane. A lane never runs on two
+ * workers at once, so a slow one holds up a single worker and the other
+ * lanes carry on on the rest.
+ *
+ * This class only does the bookkeeping: on Linux PosixWorkerPool runs the
+ * workers. Elsewhere call runOne() from a thread or the main loop.
+ *
+ * Lanes are added from any thread and stay for the pool's lifetime.
+ */
+class WorkerPool
+{
+public:
+  static const int MAX_LANES = OSDK_WORKER_LANES;
+
+  WorkerPool();
+  virtual ~WorkerPool();
+
+  //! @return lane id, -1 if there is no free lane
+  int addLane(LaneCallBack callback, UserData userData);
+  //! Mark the lane ready after queueing its work
+  void post(int lane);
+
+  /*!
+   * @brief Run one step of one ready lane on the calling thread
+   * @return false if no lane was ready
+   */
+  bool runOne();
+
+  //! @return false if the platform has no worker threads
+  virtual bool start(int threads);
+  virtual void stop();
+
+protected:
+  //! Called by post(), for workers sleeping while no lane is ready
+  virtual void wake();
+
+private:
+  WorkerPool(const WorkerPool&);
+  WorkerPool& operator=(const WorkerPool&);
+
+  typedef struct Lane
+  {
+    LaneCallBack    callback;
+    UserData        userData;
+    Atomic<uint8_t> ready;
+    Atomic<uint8_t> running;
+  } Lane;
+
+  Lane             lanes[MAX_LANES];
+  Atomic<int>      count;  //! lanes handed out
+  Atomic<uint32_t> cursor; //! where the next scan starts
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_WORKER_POOL_H
@@ -20,34 +20,114 @@ DataBroadcast::unpackCallback(Vehicle* vehicle, RecvContainer recvFrame,
                               UserData data)
 {
   DataBroadcast* broadcastPtr = (DataBroadcast*)data;
+  time_us now = recvFrame.recvTime;
 
-  if (broadcastPtr->getVehicle()->getFwVersion() != Version::M100_31)
+  if (broadcastPtr->unpackData(&recvFrame, now))
   {
-    broadcastPtr->unpackData(&recvFrame);
-  }
-  else
-  {
-    broadcastPtr->unpackM100Data(&recvFrame);
+    uint16_t flags = broadcastPtr->passFlag.loadRelaxed();
+    broadcastPtr->updateRates(flags, now);
+    if (flags & FLAG_TIME)
+    {
+      Telemetry::TimeStamp stamp = broadcastPtr->getTimeStamp();
+      vehicle->getClockSync()->addSample(
+        (uint64_t)stamp.time_ms * 1000 + stamp.time_ns / 1000, now);
+    }
   }
 
   if (broadcastPtr->userCbHandler.callback)
   {
-    broadcastPtr->userCbHandler.callback(vehicle, recvFrame,
-                                         broadcastPtr->userCbHandler.userData);
+    vehicle->invokeUserCallback(broadcastPtr->userCbHandler, recvFrame);
   }
 }
 
+// clang-format off
+const DataBroadcast::FieldLayout DataBroadcast::A3_LAYOUT[] = {
+  { FLAG_TIME         , FIELD_TIME_STAMP        },
+  { FLAG_TIME         , FIELD_SYNC_STAMP        },
+  { FLAG_QUATERNION   , FIELD_QUATERNION        },
+  { FLAG_ACCELERATION , FIELD_ACCELERATION      },
+  { FLAG_VELOCITY     , FIELD_VELOCITY          },
+  { FLAG_VELOCITY     , FIELD_VELOCITY_INFO     },
+  { FLAG_ANGULAR_RATE , FIELD_ANGULAR_RATE      },
+  { FLAG_POSITION     , FIELD_GLOBAL_POSITION   },
+  { FLAG_POSITION     , FIELD_RELATIVE_POSITION },
+  { FLAG_GPSINFO      , FIELD_GPS_INFO          },
+  { FLAG_RTKINFO      , FIELD_RTK               },
+  { FLAG_MAG          , FIELD_MAG               },
+  { FLAG_RC           , FIELD_RC                },
+  { FLAG_GIMBAL       , FIELD_GIMBAL            },
+  { FLAG_STATUS       , FIELD_STATUS            },
+  { FLAG_BATTERY      , FIELD_BATTERY           },
+  { FLAG_DEVICE       , FIELD_SDK_INFO          },
+  { 0                 , FIELD_COUNT             }
+};
+
+const DataBroadcast::FieldLayout DataBroadcast::M100_LAYOUT[] = {
+  { FLAG_TIME         , FIELD_M100_TIME_STAMP   },
+  { FLAG_QUATERNION   , FIELD_QUATERNION        },
+  { FLAG_ACCELERATION , FIELD_ACCELERATION      },
+  { FLAG_VELOCITY     , FIELD_M100_VELOCITY     },
+  { FLAG_ANGULAR_RATE , FIELD_ANGULAR_RATE      },
+  { FLAG_POSITION     , FIELD_GLOBAL_POSITION   },
+  { FLAG_M100_MAG     , FIELD_MAG               },
+  { FLAG_M100_RC      , FIELD_RC                },
+  { FLAG_M100_GIMBAL  , FIELD_GIMBAL            },
+  { FLAG_M100_STATUS  , FIELD_M100_STATUS       },
+  { FLAG_M100_BATTERY , FIELD_M100_BATTERY      },
+  { FLAG_M100_DEVICE  , FIELD_SDK_INFO          },
+  { 0                 , FIELD_COUNT             }
+};
+// clang-format on
+
 DataBroadcast::DataBroadcast(Vehicle* vehiclePtr)
+  : vehicle(0)
+  , passFlag(0)
+  , broadcastLength(0)
+  , m100(false)
+  , layout(A3_LAYOUT)
 {
+  // clang-format off
+  void*  data[FIELD_COUNT] = {
+    &timeStamp, &syncStamp, &q, &a, &v, &vi, &w, &gp, &rp, &gps, &rtk, &mag,
+    &rc, &gimbal, &status, &battery, &info,
+    &m100TimeStamp, &m100Velocity, &m100FlightStatus, &m100Battery
+  };
+  size_t size[FIELD_COUNT] = {
+    sizeof(timeStamp), sizeof(syncStamp), sizeof(q), sizeof(a), sizeof(v),
+    sizeof(vi), sizeof(w), sizeof(gp), sizeof(rp), sizeof(gps), sizeof(rtk),
+    sizeof(mag), sizeof(rc), sizeof(gimbal), sizeof(status), sizeof(battery),
+    sizeof(info),
+    sizeof(m100TimeStamp), sizeof(m100Velocity), sizeof(m100FlightStatus),
+    sizeof(m100Battery)
+  };
+  // clang-format on
+  for (int i = 0; i < FIELD_COUNT; ++i)
+  {
+    fields[i].data     = data[i];
+    fields[i].size     = size[i];
+    fields[i].sequence = 0;
+    fields[i].updated  = 0;
+    memset(data[i], 0, size[i]);
+  }
+
   if (vehiclePtr)
   {
     setVehicle(vehiclePtr);
   }
+  else
+  {
+    selectLayout();
+  }
   unpackHandler.callback = unpackCallback;
   unpackHandler.userData = this;
 
   userCbHandler.callback = 0;
   userCbHandler.userData = 0;
+
+  for (int i = 0; i < CHANNEL_COUNT; ++i)
+  {
+    rateMonitor[i].setName("Broadcast channel", i);
+  }
 }
 
 DataBroadcast::~DataBroadcast()
@@ -57,23 +137,22 @@ DataBroadcast::~DataBroadcast()
   unpackHandler.userData = 0;
 }
 
-// clang-format off
 Telemetry::TimeStamp
 DataBroadcast::getTimeStamp()
 {
-  Telemetry::TimeStamp  data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  if(vehicle->getFwVersion() != Version::M100_31)
+  Telemetry::TimeStamp data;
+  if (!m100)
   {
-    data = timeStamp;
+    readField(FIELD_TIME_STAMP, &data);
   }
   else
   {
     // Supported Broadcast data in Matrice 100
-    data.time_ms = m100TimeStamp.time;
-    data.time_ns = m100TimeStamp.nanoTime;
+    Telemetry::M100TimeStamp stamp;
+    readField(FIELD_M100_TIME_STAMP, &stamp);
+    data.time_ms = stamp.time;
+    data.time_ns = stamp.nanoTime;
   }
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
   return data;
 }
 
@@ -81,17 +160,17 @@ Telemetry::SyncStamp
 DataBroadcast::getSyncStamp()
 {
   Telemetry::SyncStamp data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  if(vehicle->getFwVersion() != Version::M100_31)
+  if (!m100)
   {
-    data = syncStamp;
+    readField(FIELD_SYNC_STAMP, &data);
   }
   else
   {
     // Supported Broadcast data in Matrice 100
-    data.flag = m100TimeStamp.syncFlag;
+    Telemetry::M100TimeStamp stamp;
+    readField(FIELD_M100_TIME_STAMP, &stamp);
+    data.flag = stamp.syncFlag;
   }
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
   return data;
 }
 
@@ -99,9 +178,7 @@ Telemetry::Quaternion
 DataBroadcast::getQuaternion()
 {
   Telemetry::Quaternion data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  data = q;
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
+  readField(FIELD_QUATERNION, &data);
   return data;
 }
 
@@ -109,9 +186,7 @@ Telemetry::Vector3f
 DataBroadcast::getAcceleration()
 {
   Telemetry::Vector3f data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  data = a;
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
+  readField(FIELD_ACCELERATION, &data);
   return data;
 }
 
@@ -119,19 +194,19 @@ Telemetry::Vector3f
 DataBroadcast::getVelocity()
 {
   Telemetry::Vector3f data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  if(vehicle->getFwVersion() != Version::M100_31)
+  if (!m100)
   {
-    data = v;
+    readField(FIELD_VELOCITY, &data);
   }
   else
   {
     // Supported Broadcast data in Matrice 100
-    data.x = m100Velocity.x;
-    data.y = m100Velocity.y;
-    data.z = m100Velocity.z;
+    Telemetry::M100Velocity velocity;
+    readField(FIELD_M100_VELOCITY, &velocity);
+    data.x = velocity.x;
+    data.y = velocity.y;
+    data.z = velocity.z;
   }
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
   return data;
 }
 
@@ -139,19 +214,19 @@ Telemetry::VelocityInfo
 DataBroadcast::getVelocityInfo()
 {
   Telemetry::VelocityInfo data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  if(vehicle->getFwVersion() != Version::M100_31)
+  if (!m100)
   {
-    data = vi;
+    readField(FIELD_VELOCITY_INFO, &data);
   }
   else
   {
     // Supported Broadcast data in Matrice 100
-    data.health = m100Velocity.health;
-    data.reserve = m100Velocity.reserve;
+    Telemetry::M100Velocity velocity;
+    readField(FIELD_M100_VELOCITY, &velocity);
+    data.health  = velocity.health;
+    data.reserve = velocity.reserve;
     // TODO add sensorID (only M100)
   }
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
   return data;
 }
 
@@ -159,9 +234,7 @@ Telemetry::Vector3f
 DataBroadcast::getAngularRate()
 {
   Telemetry::Vector3f data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  data = w;
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
+  readField(FIELD_ANGULAR_RATE, &data);
   return data;
 }
 
@@ -169,9 +242,7 @@ Telemetry::GlobalPosition
 DataBroadcast::getGlobalPosition()
 {
   Telemetry::GlobalPosition data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  data = gp;
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
+  readField(FIELD_GLOBAL_POSITION, &data);
   return data;
 }
 
@@ -180,9 +251,7 @@ Telemetry::RelativePosition
 DataBroadcast::getRelativePosition()
 {
   Telemetry::RelativePosition data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  data = rp;
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
+  readField(FIELD_RELATIVE_POSITION, &data);
   return data;
 }
 
@@ -191,9 +260,7 @@ Telemetry::GPSInfo
 DataBroadcast::getGPSInfo()
 {
   Telemetry::GPSInfo data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  data = gps;
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
+  readField(FIELD_GPS_INFO, &data);
   return data;
 }
 
@@ -202,9 +269,7 @@ Telemetry::RTK
 DataBroadcast::getRTKInfo()
 {
   Telemetry::RTK data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  data = rtk;
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
+  readField(FIELD_RTK, &data);
   return data;
 }
 
@@ -212,9 +277,7 @@ Telemetry::Mag
 DataBroadcast::getMag()
 {
   Telemetry::Mag data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  data = mag;
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
+  readField(FIELD_MAG, &data);
   return data;
 }
 
@@ -222,9 +285,7 @@ Telemetry::RC
 DataBroadcast::getRC()
 {
   Telemetry::RC data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  data = rc;
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
+  readField(FIELD_RC, &data);
   return data;
 }
 
@@ -232,9 +293,7 @@ Telemetry::Gimbal
 DataBroadcast::getGimbal()
 {
   Telemetry::Gimbal data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  data = gimbal;
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
+  readField(FIELD_GIMBAL, &data);
   return data;
 }
 
@@ -242,17 +301,16 @@ Telemetry::Status
 DataBroadcast::getStatus()
 {
   Telemetry::Status data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  if(vehicle->getFwVersion() != Version::M100_31)
+  if (!m100)
   {
-    data = status;
+    readField(FIELD_STATUS, &data);
   }
   else
   {
     // Supported Broadcast data in Matrice 100
-    data.flight = m100FlightStatus;
+    memset(&data, 0, sizeof(data));
+    readField(FIELD_M100_STATUS, &data.flight);
   }
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
   return data;
 }
 
@@ -260,17 +318,18 @@ Telemetry::Battery
 DataBroadcast::getBatteryInfo()
 {
   Telemetry::Battery data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  if(vehicle->getFwVersion() != Version::M100_31)
+  if (!m100)
   {
-    data = battery;
+    readField(FIELD_BATTERY, &data);
   }
   else
   {
     // Supported Broadcast data in Matrice 100
-    data.capacity = m100Battery;
+    memset(&data, 0, sizeof(data));
+    Telemetry::M100Battery capacity;
+    readField(FIELD_M100_BATTERY, &capacity);
+    data.capacity = capacity;
   }
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
   return data;
 }
 
@@ -278,12 +337,60 @@ Telemetry::SDKInfo
 DataBroadcast::getSDKInfo()
 {
   Telemetry::SDKInfo data;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  data = info;
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
+  readField(FIELD_SDK_INFO, &data);
   return data;
 }
-// clang-format on
+
+DataBroadcast::FieldStamp
+DataBroadcast::getFieldStamp(FIELD field) const
+{
+  FieldStamp stamp;
+  readField(field, 0, &stamp);
+  return stamp;
+}
+
+bool
+DataBroadcast::isStale(FIELD field, time_us maxAge) const
+{
+  FieldStamp stamp = getFieldStamp(field);
+  if (stamp.sequence == 0)
+  {
+    return true;
+  }
+  time_us now = vehicle->protocolLayer->getDriver()->getTimeStampUs();
+  return now > stamp.updated && now - stamp.updated > maxAge;
+}
+
+void
+DataBroadcast::readField(FIELD field, void* dst, FieldStamp* stamp) const
+{
+  const FieldState& f = fields[field];
+  uint32_t          token;
+  do
+  {
+    token = f.lock.readBegin();
+    if (dst)
+    {
+      memcpy(dst, f.data, f.size);
+    }
+    if (stamp)
+    {
+      stamp->sequence = f.sequence;
+      stamp->updated  = f.updated;
+    }
+  } while (f.lock.readRetry(token));
+}
+
+void
+DataBroadcast::publishField(int field, const uint8_t* src, time_us now)
+{
+  FieldState& f = fields[field];
+  f.lock.writeBegin();
+  memcpy(f.data, src, f.size);
+  f.sequence++;
+  f.updated = now;
+  f.lock.writeEnd();
+}
 
 Vehicle*
 DataBroadcast::getVehicle() const
@@ -295,6 +402,27 @@ void
 DataBroadcast::setVehicle(Vehicle* vehiclePtr)
 {
   vehicle = vehiclePtr;
+  selectLayout();
+}
+
+void
+DataBroadcast::selectLayout()
+{
+  m100   = vehicle && vehicle->getFwVersion() == Version::M100_31;
+  layout = m100 ? M100_LAYOUT : A3_LAYOUT;
+
+  int entry = 0;
+  for (int bit = 0; bit < CHANNEL_COUNT; ++bit)
+  {
+    bitFirst[bit] = entry;
+    bitSize[bit]  = 0;
+    while (layout[entry].flag == (1 << bit))
+    {
+      bitSize[bit] += fields[layout[entry].field].size;
+      ++entry;
+    }
+  }
+  bitFirst[CHANNEL_COUNT] = entry;
 }
 
 void
@@ -305,6 +433,7 @@ DataBroadcast::setBroadcastFreq(uint8_t* dataLenIs16, VehicleCallBack callback,
   {
     dataLenIs16[i] = (dataLenIs16[i] > 7 ? 5 : dataLenIs16[i]);
   }
+  setExpectedRates(dataLenIs16);
 
   uint32_t cmd_timeout = 100; // unit is ms
   uint32_t retry_time  = 1;
@@ -335,6 +464,7 @@ DataBroadcast::setBroadcastFreq(uint8_t* dataLenIs16, int timeout)
   {
     dataLenIs16[i] = (dataLenIs16[i] > 7 ? 5 : dataLenIs16[i]);
   }
+  setExpectedRates(dataLenIs16);
 
   vehicle->protocolLayer->send(2, 0,
                                OpenProtocol::CMDSet::Activation::frequency,
@@ -346,68 +476,45 @@ DataBroadcast::setBroadcastFreq(uint8_t* dataLenIs16, int timeout)
   return ack;
 }
 
-void
-DataBroadcast::unpackData(RecvContainer* pRecvFrame)
+bool
+DataBroadcast::unpackData(RecvContainer* pRecvFrame, time_us now)
 {
-  uint8_t* pdata = pRecvFrame->recvData.raw_ack_array;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  passFlag = *(uint16_t*)pdata;
-  pdata += sizeof(uint16_t);
-  // clang-format off
-  unpackOne(FLAG_TIME        ,&timeStamp ,pdata,sizeof(timeStamp ));
-  unpackOne(FLAG_TIME        ,&syncStamp ,pdata,sizeof(syncStamp ));
-  unpackOne(FLAG_QUATERNION  ,&q         ,pdata,sizeof(q         ));
-  unpackOne(FLAG_ACCELERATION,&a         ,pdata,sizeof(a         ));
-  unpackOne(FLAG_VELOCITY    ,&v         ,pdata,sizeof(v         ));
-  unpackOne(FLAG_VELOCITY    ,&vi        ,pdata,sizeof(vi        ));
-  unpackOne(FLAG_ANGULAR_RATE,&w         ,pdata,sizeof(w         ));
-  unpackOne(FLAG_POSITION    ,&gp        ,pdata,sizeof(gp        ));
-  unpackOne(FLAG_POSITION    ,&rp        ,pdata,sizeof(rp        ));
-  unpackOne(FLAG_GPSINFO     ,&gps       ,pdata,sizeof(gps       ));
-  unpackOne(FLAG_RTKINFO     ,&rtk       ,pdata,sizeof(rtk       ));
-  unpackOne(FLAG_MAG         ,&mag       ,pdata,sizeof(mag       ));
-  unpackOne(FLAG_RC          ,&rc        ,pdata,sizeof(rc        ));
-  unpackOne(FLAG_GIMBAL      ,&gimbal    ,pdata,sizeof(gimbal    ));
-  unpackOne(FLAG_STATUS      ,&status    ,pdata,sizeof(status    ));
-  unpackOne(FLAG_BATTERY     ,&battery   ,pdata,sizeof(battery   ));
-  unpackOne(FLAG_DEVICE      ,&info      ,pdata,sizeof(info      ));
-  // clang-format on
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
-}
+  const uint8_t* pdata = pRecvFrame->recvData.raw_ack_array;
+  //! Payload after the cmd set/id: the flags, then the fields present
+  int      length = (int)pRecvFrame->recvInfo.len - (Protocol::PackageMin + 2);
+  uint16_t flags;
+  memcpy(&flags, pdata, sizeof(flags));
 
-void
-DataBroadcast::unpackM100Data(RecvContainer* pRecvFrame)
-{
-  uint8_t* pdata = pRecvFrame->recvData.raw_ack_array;
-  vehicle->protocolLayer->getThreadHandle()->lockMSG();
-  passFlag = *(uint16_t*)pdata;
-  pdata += sizeof(uint16_t);
-  // clang-format off
-  unpackOne(FLAG_TIME        ,&m100TimeStamp   ,pdata,sizeof(m100TimeStamp   ));
-  unpackOne(FLAG_QUATERNION  ,&q               ,pdata,sizeof(q               ));
-  unpackOne(FLAG_ACCELERATION,&a               ,pdata,sizeof(a               ));
-  unpackOne(FLAG_VELOCITY    ,&m100Velocity    ,pdata,sizeof(m100Velocity    ));
-  unpackOne(FLAG_ANGULAR_RATE,&w               ,pdata,sizeof(w               ));
-  unpackOne(FLAG_POSITION    ,&gp              ,pdata,sizeof(gp              ));
-  unpackOne(FLAG_M100_MAG    ,&mag             ,pdata,sizeof(mag             ));
-  unpackOne(FLAG_M100_RC     ,&rc              ,pdata,sizeof(rc              ));
-  unpackOne(FLAG_M100_GIMBAL ,&gimbal          ,pdata,sizeof(gimbal          ));
-  unpackOne(FLAG_M100_STATUS ,&m100FlightStatus,pdata,sizeof(m100FlightStatus));
-  unpackOne(FLAG_M100_BATTERY,&m100Battery     ,pdata,sizeof(m100Battery     ));
-  unpackOne(FLAG_M100_DEVICE ,&info            ,pdata,sizeof(info            ));
-  // clang-format on
-  vehicle->protocolLayer->getThreadHandle()->freeMSG();
-}
+  int expected = sizeof(uint16_t);
+  for (int bit = 0; bit < CHANNEL_COUNT; ++bit)
+  {
+    if (flags & (1 << bit))
+    {
+      expected += bitSize[bit];
+    }
+  }
+  if (expected > length)
+  {
+    DERROR("Broadcast frame of %d bytes too short for flags 0x%X", length,
+           flags);
+    return false;
+  }
+  passFlag.storeRelaxed(flags);
 
-void
-DataBroadcast::unpackOne(DataBroadcast::FLAG flag, void* data, uint8_t*& buf,
-                         size_t size)
-{
-  if (flag & passFlag)
+  int offset = sizeof(uint16_t);
+  for (int bit = 0; bit < CHANNEL_COUNT; ++bit)
   {
-    memcpy((uint8_t*)data, (uint8_t*)buf, size);
-    buf += size;
+    if (!(flags & (1 << bit)))
+    {
+      continue;
+    }
+    for (int i = bitFirst[bit]; i < bitFirst[bit + 1]; ++i)
+    {
+      publishField(layout[i].field, pdata + offset, now);
+      offset += fields[layout[i].field].size;
+    }
   }
+  return true;
 }
 
 void
@@ -559,7 +666,7 @@ DataBroadcast::setUserBroadcastCallback(VehicleCallBack callback,
 uint16_t
 DataBroadcast::getPassFlag()
 {
-  return passFlag;
+  return passFlag.loadRelaxed();
 }
 
 uint16_t
@@ -573,3 +680,71 @@ DataBroadcast::setBroadcastLength(uint16_t length)
 {
   this->broadcastLength = length;
 }
+
+bool
+DataBroadcast::getRateStats(int channel, RateStats& stats) const
+{
+  if (channel < 0 || channel >= CHANNEL_COUNT)
+  {
+    DERROR("Invalid broadcast channel %d", channel);
+    return false;
+  }
+  rateMonitor[channel].getStats(stats);
+  return true;
+}
+
+void
+DataBroadcast::pollRates(time_us now)
+{
+  for (int i = 0; i < CHANNEL_COUNT; ++i)
+  {
+    rateMonitor[i].poll(now);
+  }
+}
+
+void
+DataBroadcast::writeMetrics(MetricsWriter& writer) const
+{
+  RateStats stats[CHANNEL_COUNT];
+  int       ids[CHANNEL_COUNT];
+  int       count = 0;
+
+  for (int i = 0; i < CHANNEL_COUNT; ++i)
+  {
+    rateMonitor[i].getStats(stats[count]);
+    if (stats[count].count || stats[count].expectedHz > 0)
+    {
+      ids[count++] = i;
+    }
+  }
+  RateMonitor::writeMetrics(writer, "osdk_broadcast", "channel", stats, ids,
+                            count);
+}
+
+void
+DataBroadcast::updateRates(uint16_t flags, time_us now)
+{
+  for (int i = 0; flags; ++i, flags >>= 1)
+  {
+    if (flags & 1)
+    {
+      rateMonitor[i].update(now);
+    }
+  }
+}
+
+void
+DataBroadcast::setExpectedRates(const uint8_t* dataLenIs16)
+{
+  //! Indexed by FREQ; FREQ_HOLD (5) keeps the current expectation
+  static const float hz[] = { 0, 1, 10, 50, 100, -1, 200, 400 };
+
+  for (int i = 0; i < CHANNEL_COUNT; ++i)
+  {
+    float expected = hz[dataLenIs16[i] & 0x07];
+    if (expected >= 0)
+    {
+      rateMonitor[i].setExpectedRate(expected);
+    }
+  }
+}
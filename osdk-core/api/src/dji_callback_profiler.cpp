@@ -0,0 +1,285 @@
+/** @file dji_callback_profiler.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Execution time statistics for user callbacks
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_callback_profiler.hpp"
+#include "dji_log.hpp"
+
+#include <stdio.h>
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+CallbackProfiler::CallbackProfiler()
+  : defaultBudget(DEFAULT_BUDGET)
+  , isolationLimit(0)
+  , slowHook(0)
+  , slowHookData(0)
+{
+}
+
+CallbackProfiler::Entry*
+CallbackProfiler::find(VehicleCallBack callback, bool create)
+{
+  uintptr_t key   = (uintptr_t)callback;
+  int       start = (int)((key >> 2) % TABLE_SIZE);
+
+  if (key == 0)
+  {
+    return NULL;
+  }
+  for (int n = 0; n < TABLE_SIZE; n++)
+  {
+    Entry&    entry = entries[(start + n) % TABLE_SIZE];
+    uintptr_t cur   = entry.key.load();
+    if (cur == key)
+    {
+      return &entry;
+    }
+    if (cur == 0)
+    {
+      if (!create)
+      {
+        return NULL;
+      }
+      uintptr_t expected = 0;
+      if (entry.key.compareExchange(expected, key) || expected == key)
+      {
+        return &entry;
+      }
+    }
+  }
+  return NULL;
+}
+
+const CallbackProfiler::Entry*
+CallbackProfiler::find(VehicleCallBack callback) const
+{
+  return const_cast<CallbackProfiler*>(this)->find(callback, false);
+}
+
+void
+CallbackProfiler::setBudget(time_us budget)
+{
+  defaultBudget.store(budget);
+}
+
+void
+CallbackProfiler::setBudget(VehicleCallBack callback, time_us budget)
+{
+  Entry* entry = find(callback, true);
+  if (entry)
+  {
+    entry->budget.store(budget);
+  }
+}
+
+void
+CallbackProfiler::setSlowHook(SlowCallbackHook hook, UserData userData)
+{
+  slowHookData = userData;
+  slowHook     = hook;
+}
+
+void
+CallbackProfiler::setIsolation(uint32_t overrunLimit)
+{
+  isolationLimit.store(overrunLimit);
+}
+
+void
+CallbackProfiler::record(VehicleCallBack callback, time_us duration)
+{
+  Entry* entry = find(callback, true);
+  if (entry == NULL)
+  {
+    return;
+  }
+
+  entry->duration.record(duration);
+
+  time_us budget = entry->budget.loadRelaxed();
+  if (budget == 0)
+  {
+    budget = defaultBudget.loadRelaxed();
+  }
+  if (duration <= budget)
+  {
+    entry->consecutive.storeRelaxed(0);
+    return;
+  }
+
+  uint32_t overruns    = entry->overruns.add(1) + 1;
+  uint32_t consecutive = entry->consecutive.add(1) + 1;
+  if (slowHook)
+  {
+    slowHook(callback, duration, budget, slowHookData);
+  }
+  else if (overruns == 1 || overruns % 100 == 0)
+  {
+    DSTATUS("Warning: callback %p took %llu us, budget %llu us (%u overruns)",
+            (void*)(uintptr_t)callback, (unsigned long long)duration,
+            (unsigned long long)budget, overruns);
+  }
+
+  uint32_t limit = isolationLimit.loadRelaxed();
+  if (limit && consecutive >= limit && !entry->isolated.load())
+  {
+    entry->isolated.store(true);
+    DSTATUS("Callback %p isolated after %u consecutive overruns",
+            (void*)(uintptr_t)callback, consecutive);
+  }
+}
+
+bool
+CallbackProfiler::isIsolated(VehicleCallBack callback) const
+{
+  const Entry* entry = find(callback);
+  return entry && entry->isolated.load();
+}
+
+void
+CallbackProfiler::countDropped(VehicleCallBack callback)
+{
+  Entry* entry = find(callback, false);
+  if (entry)
+  {
+    entry->dropped.add(1);
+  }
+}
+
+void
+CallbackProfiler::fill(const Entry& entry, CallbackProfile& out) const
+{
+  out.callback = (VehicleCallBack)entry.key.load();
+  out.calls    = entry.duration.getCount();
+  out.overruns = entry.overruns.loadRelaxed();
+  out.budget   = entry.budget.loadRelaxed();
+  if (out.budget == 0)
+  {
+    out.budget = defaultBudget.loadRelaxed();
+  }
+  out.p50      = entry.duration.getPercentile(50);
+  out.p99      = entry.duration.getPercentile(99);
+  out.max      = entry.duration.getMax();
+  out.mean     = entry.duration.getMean();
+  out.isolated = entry.isolated.load();
+  out.dropped  = entry.dropped.loadRelaxed();
+}
+
+bool
+CallbackProfiler::get(VehicleCallBack callback, CallbackProfile& out) const
+{
+  const Entry* entry = find(callback);
+  if (entry == NULL)
+  {
+    return false;
+  }
+  fill(*entry, out);
+  return true;
+}
+
+int
+CallbackProfiler::getAll(CallbackProfile* out, int maxCount) const
+{
+  int n = 0;
+  for (int i = 0; i < TABLE_SIZE && n < maxCount; i++)
+  {
+    if (entries[i].key.load() != 0)
+    {
+      fill(entries[i], out[n++]);
+    }
+  }
+  return n;
+}
+
+void
+CallbackProfiler::reset()
+{
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    entries[i].duration.reset();
+    entries[i].overruns.storeRelaxed(0);
+    entries[i].consecutive.storeRelaxed(0);
+    entries[i].isolated.store(false);
+    entries[i].dropped.storeRelaxed(0);
+  }
+}
+
+void
+CallbackProfiler::writeMetrics(MetricsWriter& writer) const
+{
+  static const double quantiles[] = { 0.5, 0.9, 0.99 };
+  char                labels[64];
+
+  writer.family("osdk_callback_duration_seconds", "summary",
+                "Execution time of user callbacks.");
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    const Entry& entry = entries[i];
+    uintptr_t    key   = entry.key.load();
+    if (key == 0 || entry.duration.getCount() == 0)
+    {
+      continue;
+    }
+    for (int q = 0; q < 3; q++)
+    {
+      snprintf(labels, sizeof(labels), "callback=\"%p\",quantile=\"%g\"",
+               (void*)key, quantiles[q]);
+      writer.sample("osdk_callback_duration_seconds",
+                    entry.duration.getPercentile(quantiles[q] * 100) / 1e6,
+                    labels);
+    }
+    snprintf(labels, sizeof(labels), "callback=\"%p\"", (void*)key);
+    writer.sample("osdk_callback_duration_seconds_sum",
+                  entry.duration.getSum() / 1e6, labels);
+    writer.sample("osdk_callback_duration_seconds_count",
+                  (uint64_t)entry.duration.getCount(), labels);
+  }
+
+  writer.family("osdk_callback_overruns_total", "counter",
+                "Callback invocations that exceeded their budget.");
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    uintptr_t key = entries[i].key.load();
+    if (key != 0)
+    {
+      snprintf(labels, sizeof(labels), "callback=\"%p\"", (void*)key);
+      writer.sample("osdk_callback_overruns_total",
+                    (uint64_t)entries[i].overruns.loadRelaxed(), labels);
+    }
+  }
+
+  writer.family("osdk_callback_isolated", "gauge",
+                "1 if the callback was moved to a worker lane.");
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    uintptr_t key = entries[i].key.load();
+    if (key != 0)
+    {
+      snprintf(labels, sizeof(labels), "callback=\"%p\"", (void*)key);
+      writer.sample("osdk_callback_isolated",
+                    (uint64_t)(entries[i].isolated.load() ? 1 : 0), labels);
+    }
+  }
+
+  writer.family("osdk_callback_dropped_total", "counter",
+                "Frames an isolated callback skipped because it fell behind.");
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    uintptr_t key = entries[i].key.load();
+    if (key != 0)
+    {
+      snprintf(labels, sizeof(labels), "callback=\"%p\"", (void*)key);
+      writer.sample("osdk_callback_dropped_total",
+                    (uint64_t)entries[i].dropped.loadRelaxed(), labels);
+    }
+  }
+}
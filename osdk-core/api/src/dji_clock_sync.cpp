@@ -0,0 +1,290 @@
+/** @file dji_clock_sync.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Host/FC clock offset and drift estimation
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_clock_sync.hpp"
+
+#include <math.h>
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+//! An FC time stamp this far behind the last one means the FC restarted
+static const uint64_t FC_RESTART_GAP = 1000000;
+
+ClockSync::ClockSync()
+{
+  reset();
+}
+
+void
+ClockSync::reset()
+{
+  binFc    = 0;
+  binHost  = 0;
+  binStart = 0;
+  binOpen  = false;
+  lastFc   = 0;
+  head     = 0;
+  count    = 0;
+
+  Model empty;
+  empty.fcRef     = 0;
+  empty.hostAtRef = 0;
+  empty.slope     = 1;
+  empty.jitter    = 0;
+  empty.valid     = false;
+  publish(empty);
+}
+
+void
+ClockSync::addSample(uint64_t fcTime, time_us hostTime)
+{
+  if (fcTime + FC_RESTART_GAP < lastFc)
+  {
+    reset();
+  }
+  lastFc = fcTime;
+
+  if (binOpen && hostTime - binStart >= BIN_LENGTH)
+  {
+    closeBin();
+  }
+  if (!binOpen)
+  {
+    binOpen  = true;
+    binStart = hostTime;
+    binFc    = fcTime;
+    binHost  = hostTime;
+  }
+  else if ((double)hostTime - (double)fcTime <
+           (double)binHost - (double)binFc)
+  {
+    //! Least delayed sample of the bin so far
+    binFc   = fcTime;
+    binHost = hostTime;
+  }
+
+  if (count < MIN_BINS)
+  {
+    //! Offset only: the least delayed sample seen, drift taken as zero
+    Model next;
+    next.fcRef     = binFc;
+    next.hostAtRef = (double)binHost;
+    next.slope     = 1;
+    next.jitter    = 0;
+    next.valid     = true;
+    for (int i = 0; i < count; ++i)
+    {
+      double offset = (double)hostSample[i] - (double)fcSample[i];
+      if (offset < next.hostAtRef - (double)next.fcRef)
+      {
+        next.fcRef     = fcSample[i];
+        next.hostAtRef = (double)hostSample[i];
+      }
+    }
+    publish(next);
+  }
+}
+
+void
+ClockSync::closeBin()
+{
+  fcSample[head]   = binFc;
+  hostSample[head] = binHost;
+  head             = (head + 1) % WINDOW;
+  if (count < WINDOW)
+  {
+    count++;
+  }
+  binOpen = false;
+
+  if (count >= MIN_BINS)
+  {
+    fit();
+  }
+}
+
+bool
+ClockSync::solve(const bool* use, double& intercept, double& slope) const
+{
+  //! x and y relative to the oldest bin keep the sums well conditioned
+  int      oldest = (head - count + WINDOW) % WINDOW;
+  uint64_t fc0    = fcSample[oldest];
+  time_us  host0  = hostSample[oldest];
+
+  double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (int i = 0; i < count; ++i)
+  {
+    if (!use[i])
+    {
+      continue;
+    }
+    double x = (double)fcSample[i] - (double)fc0;
+    double y = (double)hostSample[i] - (double)host0;
+    n += 1;
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+  }
+  double det = n * sxx - sx * sx;
+  if (n < MIN_BINS || det <= 0)
+  {
+    return false;
+  }
+  slope     = (n * sxy - sx * sy) / det;
+  intercept = (sy - slope * sx) / n;
+  return true;
+}
+
+void
+ClockSync::fit()
+{
+  int      oldest = (head - count + WINDOW) % WINDOW;
+  uint64_t fc0    = fcSample[oldest];
+  time_us  host0  = hostSample[oldest];
+
+  bool   use[WINDOW];
+  double residual[WINDOW];
+  double sorted[WINDOW];
+  double intercept, slope;
+
+  for (int i = 0; i < count; ++i)
+  {
+    use[i] = true;
+  }
+  if (!solve(use, intercept, slope))
+  {
+    return;
+  }
+
+  //! Median absolute residual, insertion sort is enough for WINDOW bins
+  for (int i = 0; i < count; ++i)
+  {
+    double x    = (double)fcSample[i] - (double)fc0;
+    double y    = (double)hostSample[i] - (double)host0;
+    residual[i] = y - (intercept + slope * x);
+    double r    = fabs(residual[i]);
+    int    j    = i;
+    for (; j > 0 && sorted[j - 1] > r; --j)
+    {
+      sorted[j] = sorted[j - 1];
+    }
+    sorted[j] = r;
+  }
+  double mad = sorted[count / 2];
+
+  if (mad > 0)
+  {
+    for (int i = 0; i < count; ++i)
+    {
+      use[i] = fabs(residual[i]) <= 3 * mad;
+    }
+    double robustIntercept, robustSlope;
+    if (solve(use, robustIntercept, robustSlope))
+    {
+      intercept = robustIntercept;
+      slope     = robustSlope;
+    }
+    else
+    {
+      for (int i = 0; i < count; ++i)
+      {
+        use[i] = true;
+      }
+    }
+  }
+
+  double sum = 0, n = 0;
+  for (int i = 0; i < count; ++i)
+  {
+    if (use[i])
+    {
+      double x = (double)fcSample[i] - (double)fc0;
+      double y = (double)hostSample[i] - (double)host0;
+      double r = y - (intercept + slope * x);
+      sum += r * r;
+      n += 1;
+    }
+  }
+
+  Model next;
+  next.fcRef     = fc0;
+  next.hostAtRef = (double)host0 + intercept;
+  next.slope     = slope;
+  next.jitter    = sqrt(sum / n);
+  next.valid     = true;
+  publish(next);
+}
+
+void
+ClockSync::publish(const Model& next)
+{
+  lock.writeBegin();
+  model = next;
+  lock.writeEnd();
+}
+
+ClockSync::Model
+ClockSync::read() const
+{
+  Model    copy;
+  uint32_t token;
+  do
+  {
+    token = lock.readBegin();
+    copy  = model;
+  } while (lock.readRetry(token));
+  return copy;
+}
+
+bool
+ClockSync::isSynced() const
+{
+  return read().valid;
+}
+
+time_us
+ClockSync::fcToHost(uint64_t fcTime) const
+{
+  Model m = read();
+  if (!m.valid)
+  {
+    return 0;
+  }
+  double host = m.hostAtRef + m.slope * ((double)fcTime - (double)m.fcRef);
+  return host > 0 ? (time_us)(host + 0.5) : 0;
+}
+
+uint64_t
+ClockSync::hostToFc(time_us hostTime) const
+{
+  Model m = read();
+  if (!m.valid || m.slope <= 0)
+  {
+    return 0;
+  }
+  double fc = (double)m.fcRef + ((double)hostTime - m.hostAtRef) / m.slope;
+  return fc > 0 ? (uint64_t)(fc + 0.5) : 0;
+}
+
+double
+ClockSync::getDriftPpm() const
+{
+  Model m = read();
+  return m.valid ? (m.slope - 1) * 1e6 : 0;
+}
+
+double
+ClockSync::getJitter() const
+{
+  return read().jitter;
+}
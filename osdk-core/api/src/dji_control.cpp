@@ -19,6 +19,8 @@ Control::Control(Vehicle* vehicle)
   : vehicle(vehicle)
   , wait_timeout(10)
 {
+  ctrlFrame.length         = 0;
+  advancedCtrlFrame.length = 0;
 }
 
 Control::~Control()
@@ -65,20 +67,15 @@ Control::action(const int cmd, int timeout)
 
   if (vehicle->getFwVersion() != Version::M100_31)
   {
-    uint8_t data = cmd;
-    vehicle->protocolLayer->send(2, DJI::OSDK::encrypt,
-                                 OpenProtocol::CMDSet::Control::task, &data,
-                                 sizeof(data), 500, 2, false, 2);
-  }
-  else
-  {
-    m100CMDData.cmd = cmd;
-    m100CMDData.sequence++;
-    vehicle->protocolLayer->send(
-      2, DJI::OSDK::encrypt, OpenProtocol::CMDSet::Control::task,
-      (uint8_t*)&m100CMDData, sizeof(m100CMDData), 100, 3, false, 2);
+    return vehicle->send<Cmd::FlightTask>(static_cast<uint8_t>(cmd), timeout);
   }
 
+  m100CMDData.cmd = cmd;
+  m100CMDData.sequence++;
+  vehicle->protocolLayer->send(
+    2, DJI::OSDK::encrypt, OpenProtocol::CMDSet::Control::task,
+    (uint8_t*)&m100CMDData, sizeof(m100CMDData), 100, 3, false, 2);
+
   ack = *((ACK::ErrorCode*)vehicle->waitForACK(
     OpenProtocol::CMDSet::Control::task, timeout));
 
@@ -88,39 +85,23 @@ Control::action(const int cmd, int timeout)
 void
 Control::setArm(bool armSetting, VehicleCallBack callback, UserData userData)
 {
-  uint8_t data    = armSetting ? 1 : 0;
-  int     cbIndex = vehicle->callbackIdIndex();
+  uint8_t data = armSetting ? 1 : 0;
   if (callback)
   {
-    vehicle->nbCallbackFunctions[cbIndex] = (void*)callback;
-    vehicle->nbUserData[cbIndex]          = userData;
+    vehicle->send<Cmd::SetArm>(data, callback, userData);
   }
   else
   {
     // Support for default callbacks
-    vehicle->nbCallbackFunctions[cbIndex] = (void*)actionCallback;
-    vehicle->nbUserData[cbIndex]          = NULL;
+    vehicle->send<Cmd::SetArm>(data, actionCallback, NULL);
   }
-
-  vehicle->protocolLayer->send(2, DJI::OSDK::encrypt,
-                               OpenProtocol::CMDSet::Control::setArm, &data,
-                               sizeof(data), 10, 10, true, cbIndex);
 }
 
 ACK::ErrorCode
 Control::setArm(bool armSetting, int timeout)
 {
-  ACK::ErrorCode ack;
-  uint8_t        data = armSetting ? 1 : 0;
-
-  vehicle->protocolLayer->send(2, DJI::OSDK::encrypt,
-                               OpenProtocol::CMDSet::Control::setArm, &data,
-                               sizeof(data), 10, 10, false, 2);
-
-  ack = *((ACK::ErrorCode*)vehicle->waitForACK(
-    OpenProtocol::CMDSet::Control::setArm, timeout));
-
-  return ack;
+  uint8_t data = armSetting ? 1 : 0;
+  return vehicle->send<Cmd::SetArm>(data, timeout);
 }
 
 ACK::ErrorCode
@@ -256,9 +237,14 @@ Control::land(VehicleCallBack callback, UserData userData)
 void
 Control::flightCtrl(CtrlData data)
 {
-  vehicle->protocolLayer->send(
-    0, DJI::OSDK::encrypt, OpenProtocol::CMDSet::Control::control,
-    static_cast<void*>(&data), sizeof(CtrlData), 500, 2, false, 1);
+  if (vehicle->getSetpoints()->post(SetpointMailbox::SETPOINT_CONTROL, &data,
+                                    sizeof(CtrlData)))
+  {
+    return;
+  }
+  vehicle->protocolLayer->sendPrepared(&ctrlFrame, DJI::OSDK::encrypt,
+                                       OpenProtocol::CMDSet::Control::control,
+                                       &data, sizeof(CtrlData));
 }
 
 void
@@ -266,9 +252,14 @@ Control::flightCtrl(AdvancedCtrlData data)
 {
   if (vehicle->getFwVersion() != Version::M100_31)
   {
-    vehicle->protocolLayer->send(
-      0, DJI::OSDK::encrypt, OpenProtocol::CMDSet::Control::control,
-      static_cast<void*>(&data), sizeof(AdvancedCtrlData), 500, 2, false, 1);
+    if (vehicle->getSetpoints()->post(SetpointMailbox::SETPOINT_CONTROL,
+                                      &data, sizeof(AdvancedCtrlData)))
+    {
+      return;
+    }
+    vehicle->protocolLayer->sendPrepared(
+      &advancedCtrlFrame, DJI::OSDK::encrypt,
+      OpenProtocol::CMDSet::Control::control, &data, sizeof(AdvancedCtrlData));
   }
   else
   {
@@ -355,7 +346,13 @@ Control::emergencyBrake()
     //! @note 75 is the flag value of this mode
     AdvancedCtrlData data(72, 0, 0, 0, 0, 0, 0);
 
-    return this->flightCtrl(data);
+    //! Posted to the mailbox the brake could be coalesced away or followed
+    //! by an older setpoint, so drop those and send it right away
+    vehicle->getSetpoints()->discard(SetpointMailbox::SETPOINT_CONTROL);
+    vehicle->protocolLayer->sendPrepared(
+      &advancedCtrlFrame, DJI::OSDK::encrypt,
+      OpenProtocol::CMDSet::Control::control, &data, sizeof(AdvancedCtrlData),
+      TxScheduler::TX_EMERGENCY);
   }
   else
   {
@@ -0,0 +1,515 @@
+/** @file dji_dispatch_table.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  (cmd_set, cmd_id) keyed push data subscribers and ACK slots
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_dispatch_table.hpp"
+#include "dji_log.hpp"
+
+#include <new>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+DispatchTable::DispatchTable()
+  : used(0)
+  , freeHead(0)
+  , writer(0)
+  , ackSlotCount(0)
+{
+  for (int i = 0; i < 256; ++i)
+  {
+    rows[i].storeRelaxed(0);
+  }
+  nodes = new (std::nothrow) Node[MAX_SUBSCRIBERS];
+  if (nodes == 0)
+  {
+    DERROR("Failed to allocate the dispatch table\n");
+  }
+}
+
+DispatchTable::~DispatchTable()
+{
+  for (int i = 0; i < 256; ++i)
+  {
+    delete[] rows[i].loadRelaxed();
+  }
+  for (uint32_t i = 0; nodes && i < used.loadRelaxed(); ++i)
+  {
+    delete[] nodes[i].queue.loadRelaxed();
+  }
+  delete[] nodes;
+}
+
+void
+DispatchTable::lockWriters()
+{
+  uint32_t expected = 0;
+  for (int spins = 0; !writer.compareExchange(expected, 1); ++spins)
+  {
+    expected = 0;
+#if defined(__linux__)
+    //! Writers hold the lock briefly, but may be preempted while they do
+    if (spins >= WRITER_SPINS)
+    {
+      sched_yield();
+    }
+#endif
+  }
+}
+
+void
+DispatchTable::unlockWriters()
+{
+  writer.store(0);
+}
+
+DispatchTable::Cell*
+DispatchTable::getRow(uint8_t cmdSet, bool create)
+{
+  Cell* row = rows[cmdSet].load();
+  if (row == 0 && create)
+  {
+    row = new (std::nothrow) Cell[256];
+    if (row == 0)
+    {
+      return 0;
+    }
+    for (int i = 0; i < 256; ++i)
+    {
+      row[i].head.storeRelaxed(0);
+      row[i].tag     = 0;
+      row[i].ackSlot = 0;
+    }
+    rows[cmdSet].store(row);
+  }
+  return row;
+}
+
+const DispatchTable::Cell*
+DispatchTable::findCell(uint8_t cmdSet, uint8_t cmdId) const
+{
+  const Cell* row = rows[cmdSet].load();
+  return row ? &row[cmdId] : 0;
+}
+
+DispatchTable::Node*
+DispatchTable::getNode(int id) const
+{
+  uint32_t index = (uint32_t)id & ((1 << ID_INDEX_BITS) - 1);
+  if (nodes == 0 || id < 0 || index >= used.load() ||
+      nodes[index].generation.load() != ((uint32_t)id >> ID_INDEX_BITS))
+  {
+    return 0;
+  }
+  return &nodes[index];
+}
+
+int
+DispatchTable::getIndex(int id)
+{
+  return (int)((uint32_t)id & ((1 << ID_INDEX_BITS) - 1));
+}
+
+int
+DispatchTable::makeId(const Node* node, uint32_t generation) const
+{
+  return (int)((generation << ID_INDEX_BITS) | (uint32_t)(node - nodes));
+}
+
+int
+DispatchTable::subscribe(uint8_t cmdSet, uint8_t cmdId,
+                         VehicleCallBackHandler handler, DropPolicy policy,
+                         int queueDepth)
+{
+  if (nodes == 0 || handler.callback == 0)
+  {
+    return -1;
+  }
+
+  lockWriters();
+  Cell* row = getRow(cmdSet, true);
+  if (row == 0)
+  {
+    unlockWriters();
+    return -1;
+  }
+  Cell& cell = row[cmdId];
+
+  uint8_t last = 0;
+  for (uint8_t n = cell.head.loadRelaxed(); n; n = nodes[n - 1].next.load())
+  {
+    last = n;
+  }
+
+  uint32_t index;
+  if (freeHead)
+  {
+    index    = freeHead - 1;
+    freeHead = nodes[index].freeNext;
+  }
+  else
+  {
+    index = used.loadRelaxed();
+    if (index >= (uint32_t)MAX_SUBSCRIBERS)
+    {
+      unlockWriters();
+      DERROR("No room for another subscriber of 0x%X 0x%X\n", cmdSet, cmdId);
+      return -1;
+    }
+    nodes[index].generation.storeRelaxed(0);
+    used.store(index + 1);
+  }
+  Node* node = &nodes[index];
+
+  //! Frames still queued for the previous owner carry its id and are
+  //! discarded by dequeue(), so the queue is left as it is
+  if (policy == DISPATCH_QUEUE && node->queue.loadRelaxed() == 0)
+  {
+    node->queue.store(new (std::nothrow) QueuedFrame[MAX_QUEUE_DEPTH]);
+    if (node->queue.loadRelaxed() == 0)
+    {
+      node->freeNext = freeHead;
+      freeHead       = index + 1;
+      unlockWriters();
+      DERROR("Failed to allocate a subscriber queue\n");
+      return -1;
+    }
+  }
+  if (queueDepth < 1)
+  {
+    queueDepth = 1;
+  }
+  else if (queueDepth > MAX_QUEUE_DEPTH)
+  {
+    queueDepth = MAX_QUEUE_DEPTH;
+  }
+
+  node->delivered.storeRelaxed(0);
+  node->dropped.storeRelaxed(0);
+
+  node->lock.writeBegin();
+  node->cmdSet     = cmdSet;
+  node->cmdId      = cmdId;
+  node->handler    = handler;
+  node->policy     = policy;
+  node->queueDepth = policy == DISPATCH_LATEST ? 1 : (uint32_t)queueDepth;
+  node->active     = true;
+  node->lock.writeEnd();
+
+  //! Linked last, once a lookup reaching it sees it complete
+  node->next.store(0);
+  if (last)
+  {
+    nodes[last - 1].next.store(index + 1);
+  }
+  else
+  {
+    cell.head.store(index + 1);
+  }
+
+  int id = makeId(node, node->generation.loadRelaxed());
+  unlockWriters();
+  return id;
+}
+
+bool
+DispatchTable::unsubscribe(int id)
+{
+  lockWriters();
+  Node* node = getNode(id);
+  if (node == 0 || !node->active)
+  {
+    unlockWriters();
+    return false;
+  }
+
+  uint32_t generation = node->generation.loadRelaxed();
+  node->lock.writeBegin();
+  node->active = false;
+  node->generation.store(generation < GENERATION_MAX ? generation + 1 : 0);
+  node->lock.writeEnd();
+
+  //! Unlink; the node keeps its own link for lookups standing on it
+  uint8_t self = (uint8_t)(node - nodes) + 1;
+  Cell&   cell = getRow(node->cmdSet, false)[node->cmdId];
+  if (cell.head.loadRelaxed() == self)
+  {
+    cell.head.store(node->next.load());
+  }
+  else
+  {
+    for (uint8_t n = cell.head.loadRelaxed(); n; n = nodes[n - 1].next.load())
+    {
+      if (nodes[n - 1].next.load() == self)
+      {
+        nodes[n - 1].next.store(node->next.load());
+        break;
+      }
+    }
+  }
+
+  node->freeNext = freeHead;
+  freeHead       = self;
+  unlockWriters();
+  return true;
+}
+
+int
+DispatchTable::lookup(uint8_t cmdSet, uint8_t cmdId, Subscriber* out,
+                      int max) const
+{
+  const Cell* cell = findCell(cmdSet, cmdId);
+  if (cell == 0)
+  {
+    return 0;
+  }
+
+  int count = 0;
+  for (int attempt = 0; attempt < MAX_SUBSCRIBERS; ++attempt)
+  {
+    bool    moved = false;
+    uint8_t n     = cell->head.load();
+    count         = 0;
+    while (n && count < max)
+    {
+      const Node& node = nodes[n - 1];
+      bool        active;
+      uint8_t     set;
+      uint8_t     id;
+      uint32_t    token;
+      do
+      {
+        token              = node.lock.readBegin();
+        active             = node.active;
+        set                = node.cmdSet;
+        id                 = node.cmdId;
+        out[count].id      = makeId(&node, node.generation.load());
+        out[count].handler = node.handler;
+        out[count].policy  = node.policy;
+      } while (node.lock.readRetry(token));
+
+      if (set != cmdSet || id != cmdId)
+      {
+        //! Removed and reused for another command while we stood on it
+        moved = true;
+        break;
+      }
+      if (active)
+      {
+        count++;
+      }
+      n = node.next.load();
+    }
+    if (!moved)
+    {
+      break;
+    }
+  }
+  return count;
+}
+
+bool
+DispatchTable::getSubscriber(int id, Subscriber& out) const
+{
+  Node* node = getNode(id);
+  if (node == 0)
+  {
+    return false;
+  }
+
+  bool     active;
+  uint32_t generation;
+  uint32_t token;
+  do
+  {
+    token       = node->lock.readBegin();
+    active      = node->active;
+    generation  = node->generation.load();
+    out.id      = id;
+    out.handler = node->handler;
+    out.policy  = node->policy;
+  } while (node->lock.readRetry(token));
+  return active && generation == ((uint32_t)id >> ID_INDEX_BITS);
+}
+
+bool
+DispatchTable::setTag(uint8_t cmdSet, uint8_t cmdId, uint8_t tag)
+{
+  lockWriters();
+  Cell* row = getRow(cmdSet, true);
+  if (row)
+  {
+    row[cmdId].tag = tag;
+  }
+  unlockWriters();
+  return row != 0;
+}
+
+uint8_t
+DispatchTable::getTag(uint8_t cmdSet, uint8_t cmdId) const
+{
+  const Cell* cell = findCell(cmdSet, cmdId);
+  return cell ? cell->tag : 0;
+}
+
+bool
+DispatchTable::setAckSlot(uint8_t cmdSet, uint8_t cmdId, void* slot)
+{
+  lockWriters();
+  Cell* row = getRow(cmdSet, true);
+  if (row == 0 || ackSlotCount >= MAX_ACK_SLOTS)
+  {
+    unlockWriters();
+    return false;
+  }
+  ackSlots[ackSlotCount++] = slot;
+  row[cmdId].ackSlot       = ackSlotCount;
+  unlockWriters();
+  return true;
+}
+
+void*
+DispatchTable::getAckSlot(uint8_t cmdSet, uint8_t cmdId) const
+{
+  const Cell* cell = findCell(cmdSet, cmdId);
+  if (cell == 0 || cell->ackSlot == 0)
+  {
+    return 0;
+  }
+  return ackSlots[cell->ackSlot - 1];
+}
+
+bool
+DispatchTable::enqueue(int id, const RecvContainer& frame)
+{
+  Node* node = getNode(id);
+  if (node == 0)
+  {
+    return true;
+  }
+
+  DropPolicy policy;
+  uint32_t   depth;
+  uint32_t   token;
+  do
+  {
+    token  = node->lock.readBegin();
+    policy = node->policy;
+    depth  = node->queueDepth;
+  } while (node->lock.readRetry(token));
+
+  if (policy == DISPATCH_LATEST)
+  {
+    QueuedFrame latest;
+    latest.id    = id;
+    latest.frame = frame;
+    bool replaced =
+      node->latest.getWriteCount() != node->latestTaken.load();
+    node->latest.write(&latest, sizeof(latest));
+    return !replaced;
+  }
+
+  QueuedFrame* queue = node->queue.load();
+  uint32_t     head  = node->queueHead.loadRelaxed();
+  if (queue == 0 || head - node->queueTail.load() >= depth)
+  {
+    return false;
+  }
+  queue[head % MAX_QUEUE_DEPTH].id    = id;
+  queue[head % MAX_QUEUE_DEPTH].frame = frame;
+  node->queueHead.store(head + 1);
+  return true;
+}
+
+bool
+DispatchTable::dequeue(int index, Subscriber& out, RecvContainer& frame)
+{
+  if (nodes == 0 || index < 0 || (uint32_t)index >= used.load())
+  {
+    return false;
+  }
+  Node& node = nodes[index];
+
+  QueuedFrame* queue = node.queue.load();
+  if (queue)
+  {
+    uint32_t tail = node.queueTail.loadRelaxed();
+    while (tail != node.queueHead.load())
+    {
+      const QueuedFrame& queued = queue[tail % MAX_QUEUE_DEPTH];
+      bool               live   = getSubscriber(queued.id, out);
+      if (live)
+      {
+        frame = queued.frame;
+      }
+      //! Only now may enqueue() reuse the entry
+      node.queueTail.store(++tail);
+      if (live)
+      {
+        return true;
+      }
+    }
+  }
+
+  QueuedFrame latest;
+  uint32_t    written = node.latest.read(&latest, 0, sizeof(latest));
+  if (written == 0 || written == node.latestTaken.load())
+  {
+    return false;
+  }
+  node.latestTaken.store(written);
+  if (!getSubscriber(latest.id, out))
+  {
+    return false;
+  }
+  frame = latest.frame;
+  return true;
+}
+
+void
+DispatchTable::countDelivered(int id)
+{
+  Node* node = getNode(id);
+  if (node)
+  {
+    node->delivered.add(1);
+  }
+}
+
+void
+DispatchTable::countDropped(int id)
+{
+  Node* node = getNode(id);
+  if (node)
+  {
+    node->dropped.add(1);
+  }
+}
+
+DispatchTable::SubscriberStats
+DispatchTable::getStats(int id) const
+{
+  SubscriberStats stats = { 0, 0, 0 };
+  Node*           node  = getNode(id);
+  if (node)
+  {
+    stats.delivered = node->delivered.loadRelaxed();
+    stats.dropped   = node->dropped.loadRelaxed();
+    stats.pending   = node->queueHead.load() - node->queueTail.load();
+    if (node->latest.getWriteCount() != node->latestTaken.load())
+    {
+      stats.pending++;
+    }
+  }
+  return stats;
+}
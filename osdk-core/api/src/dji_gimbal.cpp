@@ -17,6 +17,8 @@ using namespace DJI::OSDK;
 DJI::OSDK::Gimbal::Gimbal(Vehicle* vehicle)
   : vehicle(vehicle)
 {
+  angleFrame.length = 0;
+  speedFrame.length = 0;
 }
 
 DJI::OSDK::Gimbal::~Gimbal()
@@ -26,16 +28,26 @@ DJI::OSDK::Gimbal::~Gimbal()
 void
 DJI::OSDK::Gimbal::setAngle(Gimbal::AngleData* data)
 {
-  vehicle->protocolLayer->send(0, encrypt,
-                               OpenProtocol::CMDSet::Control::gimbalAngle,
-                               (unsigned char*)data, sizeof(Gimbal::AngleData));
+  if (vehicle->getSetpoints()->post(SetpointMailbox::SETPOINT_GIMBAL_ANGLE,
+                                    data, sizeof(Gimbal::AngleData)))
+  {
+    return;
+  }
+  vehicle->protocolLayer->sendPrepared(
+    &angleFrame, encrypt, OpenProtocol::CMDSet::Control::gimbalAngle, data,
+    sizeof(Gimbal::AngleData));
 }
 
 void
 DJI::OSDK::Gimbal::setSpeed(Gimbal::SpeedData* data)
 {
   data->reserved = 0x80;
-  vehicle->protocolLayer->send(0, encrypt,
-                               OpenProtocol::CMDSet::Control::gimbalSpeed,
-                               (unsigned char*)data, sizeof(Gimbal::SpeedData));
+  if (vehicle->getSetpoints()->post(SetpointMailbox::SETPOINT_GIMBAL_SPEED,
+                                    data, sizeof(Gimbal::SpeedData)))
+  {
+    return;
+  }
+  vehicle->protocolLayer->sendPrepared(
+    &speedFrame, encrypt, OpenProtocol::CMDSet::Control::gimbalSpeed, data,
+    sizeof(Gimbal::SpeedData));
 }
@@ -0,0 +1,449 @@
+/** @file dji_link_quality.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Link-quality score and telemetry rate adaptation under congestion
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_link_quality.hpp"
+#include "dji_package_planner.hpp"
+#include "dji_vehicle.hpp"
+
+#include <string.h>
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+const float LinkQuality::SCORE_WEIGHT      = 0.3f;
+//! Ratios at which a period's quality reaches 0: 10% of the frames failing
+//! CRC, 20% of the bytes discarded, 25% of the frames retransmitted
+const float LinkQuality::CRC_WEIGHT        = 10.0f;
+const float LinkQuality::RESYNC_WEIGHT     = 5.0f;
+const float LinkQuality::RETRANSMIT_WEIGHT = 4.0f;
+
+LinkQuality::LinkQuality(Vehicle* vehicle)
+  : vehicle(vehicle)
+  , havePrevious(false)
+  , adaptive(false)
+  , degradeBelow(0.6f)
+  , restoreAbove(0.85f)
+  , restoreHold(3)
+  , goodPeriods(0)
+{
+  job.storeRelaxed(-1);
+  action.storeRelaxed(RATES_KEEP);
+  ratesLock.storeRelaxed(0);
+  scorePermille.storeRelaxed(1000);
+  degradations.storeRelaxed(0);
+  restorations.storeRelaxed(0);
+  memset(topicMinimum, 0, sizeof(topicMinimum));
+  memset(managed, 0, sizeof(managed));
+}
+
+bool
+LinkQuality::enable(uint16_t periodMs)
+{
+  PeriodicScheduler* scheduler = vehicle->getScheduler();
+  if (periodMs == 0 || scheduler == 0)
+  {
+    return false;
+  }
+
+  time_us period = (time_us)periodMs * 1000;
+  int     id     = job.load();
+  if (id >= 0)
+  {
+    return scheduler->setPeriod(id, period);
+  }
+
+  havePrevious = false;
+  id           = scheduler->addJob(period, evaluate, this);
+  if (id < 0)
+  {
+    return false;
+  }
+  job.store(id);
+
+  PeriodicScheduler::RealTimeConfig config = { 0, -1, false };
+  scheduler->start(config);
+  return true;
+}
+
+void
+LinkQuality::disable()
+{
+  int id = job.exchange(-1);
+  if (id >= 0)
+  {
+    vehicle->getScheduler()->removeJob(id);
+  }
+  action.store(RATES_KEEP);
+  restoreAll();
+}
+
+bool
+LinkQuality::isEnabled() const
+{
+  return job.load() >= 0;
+}
+
+float
+LinkQuality::getScore() const
+{
+  return scorePermille.loadRelaxed() / 1000.0f;
+}
+
+LinkQuality::Sample
+LinkQuality::getLastSample() const
+{
+  Sample sample;
+  if (last.read(&sample, 0, sizeof(sample)) == 0)
+  {
+    memset(&sample, 0, sizeof(sample));
+    sample.quality = 1;
+    sample.score   = 1;
+  }
+  return sample;
+}
+
+void
+LinkQuality::setAdaptiveRates(bool enable)
+{
+  adaptive = enable;
+  if (!enable && vehicle->subscribe)
+  {
+    action.store(RATES_KEEP);
+    restoreAll();
+  }
+}
+
+void
+LinkQuality::setThresholds(float degradeBelow, float restoreAbove,
+                           uint8_t restoreHold)
+{
+  this->degradeBelow = degradeBelow;
+  this->restoreAbove =
+    restoreAbove < degradeBelow ? degradeBelow : restoreAbove;
+  this->restoreHold = restoreHold ? restoreHold : 1;
+}
+
+void
+LinkQuality::setTopicMinimum(Telemetry::TopicName topic, uint16_t freq)
+{
+  if (topic < Telemetry::TOTAL_TOPIC_NUMBER)
+  {
+    topicMinimum[topic] = freq;
+  }
+}
+
+void
+LinkQuality::evaluate(time_us deadline, UserData userData)
+{
+  static_cast<LinkQuality*>(userData)->update();
+}
+
+void
+LinkQuality::update()
+{
+  LinkStats now = vehicle->protocolLayer->getLinkStats();
+  if (!havePrevious)
+  {
+    previous     = now;
+    havePrevious = true;
+    return;
+  }
+
+  uint32_t frames  = now.framesParsed - previous.framesParsed;
+  uint32_t crc     = (now.headerCRCErrors - previous.headerCRCErrors) +
+                 (now.dataCRCErrors - previous.dataCRCErrors);
+  uint64_t bytesIn = now.bytesIn - previous.bytesIn;
+  uint32_t resync  = now.resyncBytes - previous.resyncBytes;
+  uint32_t sent    = now.framesSent - previous.framesSent;
+  uint32_t retx    = now.retransmissions - previous.retransmissions;
+
+  Sample sample;
+  sample.crcErrorRatio   = (frames + crc) ? (float)crc / (frames + crc) : 0;
+  sample.resyncRatio     = bytesIn ? (float)resync / bytesIn : 0;
+  sample.retransmitRatio = sent ? (float)retx / sent : 0;
+  sample.txQueueFill     = 0;
+  if (now.serialTxStatsValid && now.serialTx.capacity)
+  {
+    sample.txQueueFill = (float)now.serialTx.queued / now.serialTx.capacity;
+    if (now.serialTx.dropped != previous.serialTx.dropped)
+    {
+      sample.txQueueFill = 1;
+    }
+  }
+  previous = now;
+
+  //! The worst symptom decides
+  float worst = sample.txQueueFill;
+  if (CRC_WEIGHT * sample.crcErrorRatio > worst)
+    worst = CRC_WEIGHT * sample.crcErrorRatio;
+  if (RESYNC_WEIGHT * sample.resyncRatio > worst)
+    worst = RESYNC_WEIGHT * sample.resyncRatio;
+  if (RETRANSMIT_WEIGHT * sample.retransmitRatio > worst)
+    worst = RETRANSMIT_WEIGHT * sample.retransmitRatio;
+  sample.quality = worst < 1 ? 1 - worst : 0;
+
+  sample.score = getScore();
+  if (bytesIn)
+  {
+    sample.score =
+      (1 - SCORE_WEIGHT) * sample.score + SCORE_WEIGHT * sample.quality;
+    scorePermille.storeRelaxed((uint32_t)(sample.score * 1000 + 0.5f));
+  }
+  last.write(&sample, sizeof(sample));
+
+  DataSubscription* subscribe = vehicle->subscribe;
+  if (!adaptive || subscribe == 0)
+  {
+    return;
+  }
+  if (sample.score < degradeBelow)
+  {
+    goodPeriods = 0;
+    requestRates(RATES_DEGRADE);
+  }
+  else if (sample.score > restoreAbove)
+  {
+    if (goodPeriods < restoreHold)
+    {
+      goodPeriods++;
+    }
+    if (goodPeriods >= restoreHold)
+    {
+      requestRates(RATES_RESTORE);
+    }
+  }
+  else
+  {
+    goodPeriods = 0;
+  }
+}
+
+void
+LinkQuality::requestRates(RateAction next)
+{
+  //! Only the newest request counts; queued every period in case the
+  //! callback queue dropped the last one
+  action.store(next);
+  VehicleCallBackHandler handler;
+  RecvContainer          unused;
+  handler.callback = adapt;
+  handler.userData = this;
+  memset(&unused, 0, sizeof(unused));
+  vehicle->deferCallback(handler, unused);
+}
+
+void
+LinkQuality::adapt(Vehicle* vehicle, RecvContainer recvFrame,
+                   UserData userData)
+{
+  LinkQuality*      self      = static_cast<LinkQuality*>(userData);
+  DataSubscription* subscribe = vehicle->subscribe;
+  RateChange        changes[DataSubscription::MAX_NUMBER_OF_PACKAGE];
+  int               count = 0;
+
+  self->lockRates();
+  uint8_t next = self->action.exchange(RATES_KEEP);
+  if (self->adaptive && subscribe)
+  {
+    if (next == RATES_DEGRADE)
+    {
+      count = self->degrade(subscribe, changes);
+    }
+    else if (next == RATES_RESTORE)
+    {
+      count = self->restore(subscribe, false, changes);
+    }
+  }
+  self->unlockRates();
+  self->apply(subscribe, changes, count, next == RATES_RESTORE);
+}
+
+void
+LinkQuality::restoreAll()
+{
+  DataSubscription* subscribe = vehicle->subscribe;
+  RateChange        changes[DataSubscription::MAX_NUMBER_OF_PACKAGE];
+
+  if (subscribe)
+  {
+    lockRates();
+    int count = restore(subscribe, true, changes);
+    unlockRates();
+    apply(subscribe, changes, count, true);
+  }
+}
+
+void
+LinkQuality::lockRates()
+{
+  uint32_t expected = 0;
+  while (!ratesLock.compareExchange(expected, 1))
+  {
+    expected = 0;
+  }
+}
+
+void
+LinkQuality::unlockRates()
+{
+  ratesLock.store(0);
+}
+
+uint16_t
+LinkQuality::minimumFor(int packageID, DataSubscription* subscribe) const
+{
+  SubscriptionPackage::PackageInfo info;
+  Telemetry::TopicName             topics[Telemetry::TOTAL_TOPIC_NUMBER];
+  uint16_t                         minimum = 1;
+
+  if (subscribe->getPackageInfo(packageID, info, topics))
+  {
+    for (int i = 0; i < info.numberOfTopics; i++)
+    {
+      if (topicMinimum[topics[i]] > minimum)
+      {
+        minimum = topicMinimum[topics[i]];
+      }
+    }
+  }
+  return minimum;
+}
+
+int
+LinkQuality::degrade(DataSubscription* subscribe, RateChange* changes)
+{
+  int count = 0;
+  for (int i = 0; i < DataSubscription::MAX_NUMBER_OF_PACKAGE; i++)
+  {
+    SubscriptionPackage::PackageInfo info;
+    ManagedPackage&                  m = managed[i];
+    if (!subscribe->getPackageInfo(i, info))
+    {
+      m.original = 0;
+      continue;
+    }
+    if (m.original && info.freq != m.target)
+    {
+      //! Raised from elsewhere, or the last change is pending or rejected
+      if (info.freq > m.original)
+        m.original = 0;
+      else
+        m.target = info.freq;
+      continue;
+    }
+
+    //! A minimum above every FC rate keeps the package where it is
+    uint16_t minimum = PackagePlanner::roundUpFreq(minimumFor(i, subscribe));
+    uint16_t next    = PackagePlanner::lowerFreq(info.freq);
+    if (next < minimum || minimum == 0)
+    {
+      next = minimum ? minimum : info.freq;
+    }
+    if (next >= info.freq)
+    {
+      continue;
+    }
+
+    changes[count].packageID = i;
+    changes[count].freq      = next;
+    changes[count].before    = m;
+    count++;
+    if (m.original == 0)
+    {
+      m.original = info.freq;
+    }
+    m.target = next;
+  }
+  return count;
+}
+
+int
+LinkQuality::restore(DataSubscription* subscribe, bool all,
+                     RateChange* changes)
+{
+  int count = 0;
+  for (int i = 0; i < DataSubscription::MAX_NUMBER_OF_PACKAGE; i++)
+  {
+    SubscriptionPackage::PackageInfo info;
+    ManagedPackage&                  m = managed[i];
+    if (m.original == 0)
+    {
+      continue;
+    }
+    if (!subscribe->getPackageInfo(i, info) || info.freq > m.original)
+    {
+      m.original = 0;
+      continue;
+    }
+    if (!all && info.freq != m.target)
+    {
+      m.target = info.freq;
+      continue;
+    }
+
+    uint16_t next = all ? m.original : PackagePlanner::higherFreq(info.freq);
+    if (next == 0 || next > m.original)
+    {
+      next = m.original;
+    }
+
+    changes[count].packageID = i;
+    changes[count].freq      = next;
+    changes[count].before    = m;
+    count++;
+    m.target = next;
+    if (next == m.original)
+    {
+      m.original = 0;
+    }
+  }
+  return count;
+}
+
+void
+LinkQuality::apply(DataSubscription* subscribe, const RateChange* changes,
+                   int count, bool up)
+{
+  for (int i = 0; i < count; i++)
+  {
+    const RateChange& c = changes[i];
+    if (subscribe->changePackageFrequency(c.packageID, c.freq))
+    {
+      DSTATUS("Link quality %.2f, package %d %s %dHz", getScore(),
+              c.packageID, up ? "back to" : "lowered to", c.freq);
+      (up ? restorations : degradations).add(1);
+      continue;
+    }
+
+    //! Not sent: forget the plan unless a later one replaced it
+    lockRates();
+    ManagedPackage& m = managed[c.packageID];
+    if (m.target == c.freq)
+    {
+      m = c.before;
+    }
+    unlockRates();
+  }
+}
+
+void
+LinkQuality::writeMetrics(MetricsWriter& writer) const
+{
+  writer.family("osdk_link_quality_score", "gauge",
+                "Moving average of the link quality, 1 for a clean link.");
+  writer.sample("osdk_link_quality_score", getScore());
+  writer.family("osdk_link_quality_rate_changes_total", "counter",
+                "Package rate changes made by the link quality policy.");
+  writer.sample("osdk_link_quality_rate_changes_total",
+                (uint64_t)degradations.loadRelaxed(), "direction=\"down\"");
+  writer.sample("osdk_link_quality_rate_changes_total",
+                (uint64_t)restorations.loadRelaxed(), "direction=\"up\"");
+}
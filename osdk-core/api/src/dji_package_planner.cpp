@@ -0,0 +1,411 @@
+/** @file dji_package_planner.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Telemetry package planner for a given link bandwidth
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_package_planner.hpp"
+#include "dji_broadcast.hpp"
+#include "dji_log.hpp"
+#include "dji_subscription.hpp"
+
+#include <string.h>
+
+using namespace DJI;
+using namespace DJI::OSDK;
+using namespace DJI::OSDK::Telemetry;
+
+const uint16_t PackagePlanner::FREQ_LIST[FREQ_COUNT] = { 1,   10,  50,
+                                                         100, 200, 400 };
+const float PackagePlanner::DEFAULT_LINK_BUDGET = 0.7f;
+
+//! UART 8N1: start + 8 data + stop bits
+static const uint32_t BITS_PER_BYTE = 10;
+//! Subscription push: cmd set/id, then the package ID
+static const uint32_t SUBSCRIPTION_PREFIX = SET_CMD_SIZE + 1;
+//! Broadcast: cmd set/id, then the 16 bit flag of the channels present
+static const uint32_t BROADCAST_PREFIX = SET_CMD_SIZE + 2;
+
+PackagePlanner::PackagePlanner(uint32_t baudRate, bool encrypted)
+  : baudRate(baudRate)
+  , encrypted(encrypted)
+  , linkBudget(DEFAULT_LINK_BUDGET)
+{
+}
+
+void
+PackagePlanner::setLinkBudget(float share)
+{
+  linkBudget = share;
+}
+
+float
+PackagePlanner::getLinkBudget() const
+{
+  return linkBudget;
+}
+
+uint32_t
+PackagePlanner::frameBytes(uint32_t payload) const
+{
+  //! Same as Protocol::calculateLength()
+  uint32_t len = payload + sizeof(Header) + sizeof(uint32_t);
+  if (encrypted)
+  {
+    len += 16 - payload % 16;
+  }
+  return len;
+}
+
+uint32_t
+PackagePlanner::packageCost(uint16_t freq, uint16_t size) const
+{
+  return frameBytes(SUBSCRIPTION_PREFIX + size) * freq;
+}
+
+uint16_t
+PackagePlanner::roundUpFreq(uint16_t hz)
+{
+  for (int i = 0; i < FREQ_COUNT; ++i)
+  {
+    if (FREQ_LIST[i] >= hz)
+    {
+      return FREQ_LIST[i];
+    }
+  }
+  return 0;
+}
+
+uint16_t
+PackagePlanner::lowerFreq(uint16_t hz)
+{
+  for (int i = FREQ_COUNT - 1; i >= 0; --i)
+  {
+    if (FREQ_LIST[i] < hz)
+    {
+      return FREQ_LIST[i];
+    }
+  }
+  return 0;
+}
+
+uint16_t
+PackagePlanner::higherFreq(uint16_t hz)
+{
+  for (int i = 0; i < FREQ_COUNT; ++i)
+  {
+    if (FREQ_LIST[i] > hz)
+    {
+      return FREQ_LIST[i];
+    }
+  }
+  return 0;
+}
+
+bool
+PackagePlanner::planSubscription(const TopicRequest* requests, int count,
+                                 bool timeStamp, SubscriptionPlan& plan) const
+{
+  const uint16_t prefix = timeStamp ? sizeof(TimeStamp) : 0;
+
+  uint16_t wanted[TOTAL_TOPIC_NUMBER];
+  memset(wanted, 0, sizeof(wanted));
+  memset(&plan, 0, sizeof(plan));
+  plan.timeStamp = timeStamp;
+
+  for (int i = 0; i < count; ++i)
+  {
+    TopicName topic = requests[i].topic;
+    if (topic >= TOTAL_TOPIC_NUMBER)
+    {
+      DERROR("Invalid topic %d", topic);
+      return false;
+    }
+    if (requests[i].minFreq > TopicDataBase[topic].maxFreq)
+    {
+      DERROR("Topic %d requested at %dHz, max frequency %dHz", topic,
+             requests[i].minFreq, TopicDataBase[topic].maxFreq);
+      return false;
+    }
+    if (requests[i].minFreq > wanted[topic])
+    {
+      wanted[topic] = requests[i].minFreq;
+    }
+  }
+
+  //! Start from one package per topic, at its own rate
+  Candidate candidate[TOTAL_TOPIC_NUMBER];
+  int       n = 0;
+  for (int t = 0; t < TOTAL_TOPIC_NUMBER; ++t)
+  {
+    if (wanted[t] == 0)
+    {
+      continue;
+    }
+    Candidate& c     = candidate[n++];
+    c.freq           = roundUpFreq(wanted[t]);
+    c.capFreq        = TopicDataBase[t].maxFreq;
+    c.size           = TopicDataBase[t].size;
+    c.numberOfTopics = 1;
+    c.topics[0]      = t;
+  }
+
+  /*
+   * Greedily merge the pair that saves the most bytes per second: merging
+   * trades one frame overhead at the slower rate for carrying the slower
+   * topics at the faster rate. Keep merging at a loss while there are more
+   * candidates than packages.
+   */
+  for (;;)
+  {
+    int     bestFrom  = -1;
+    int     bestInto  = -1;
+    int32_t bestDelta = 0;
+
+    for (int a = 0; a < n; ++a)
+    {
+      for (int b = 0; b < n; ++b)
+      {
+        if (a == b || candidate[b].freq < candidate[a].freq ||
+            candidate[b].freq > candidate[a].capFreq ||
+            prefix + candidate[a].size + candidate[b].size >
+              ADD_PACKAEG_DATA_LENGTH)
+        {
+          continue;
+        }
+        int32_t delta =
+          (int32_t)packageCost(candidate[b].freq, prefix + candidate[a].size +
+                                                    candidate[b].size) -
+          (int32_t)packageCost(candidate[a].freq, prefix + candidate[a].size) -
+          (int32_t)packageCost(candidate[b].freq, prefix + candidate[b].size);
+        if (bestFrom < 0 || delta < bestDelta)
+        {
+          bestFrom  = a;
+          bestInto  = b;
+          bestDelta = delta;
+        }
+      }
+    }
+
+    if (bestFrom < 0 || (bestDelta >= 0 && n <= MAX_PACKAGES))
+    {
+      break;
+    }
+
+    Candidate& from = candidate[bestFrom];
+    Candidate& into = candidate[bestInto];
+    memcpy(into.topics + into.numberOfTopics, from.topics,
+           from.numberOfTopics);
+    into.numberOfTopics += from.numberOfTopics;
+    into.size += from.size;
+    if (from.capFreq < into.capFreq)
+    {
+      into.capFreq = from.capFreq;
+    }
+    candidate[bestFrom] = candidate[--n];
+  }
+
+  if (n > MAX_PACKAGES)
+  {
+    DERROR("Requested topics need %d packages, only %d available", n,
+           MAX_PACKAGES);
+    return false;
+  }
+
+  //! Fastest package first
+  for (int i = 0; i < n; ++i)
+  {
+    int fastest = i;
+    for (int j = i + 1; j < n; ++j)
+    {
+      if (candidate[j].freq > candidate[fastest].freq)
+      {
+        fastest = j;
+      }
+    }
+    Candidate c        = candidate[i];
+    candidate[i]       = candidate[fastest];
+    candidate[fastest] = c;
+
+    PlannedPackage& p = plan.package[i];
+    p.freq            = candidate[i].freq;
+    p.numberOfTopics  = candidate[i].numberOfTopics;
+    p.dataSize        = prefix + candidate[i].size;
+    p.bytesPerSecond  = packageCost(p.freq, p.dataSize);
+    for (int k = 0; k < p.numberOfTopics; ++k)
+    {
+      p.topics[k] = (TopicName)candidate[i].topics[k];
+    }
+    plan.bytesPerSecond += p.bytesPerSecond;
+  }
+  plan.numberOfPackages = n;
+  return true;
+}
+
+uint8_t
+PackagePlanner::toBroadcastFreq(uint16_t hz)
+{
+  switch (hz)
+  {
+    case 0:
+      return DataBroadcast::FREQ_0HZ;
+    case 1:
+      return DataBroadcast::FREQ_1HZ;
+    case 10:
+      return DataBroadcast::FREQ_10HZ;
+    case 50:
+      return DataBroadcast::FREQ_50HZ;
+    case 100:
+      return DataBroadcast::FREQ_100HZ;
+    case 200:
+      return DataBroadcast::FREQ_200HZ;
+    default:
+      return DataBroadcast::FREQ_400HZ;
+  }
+}
+
+int
+PackagePlanner::broadcastChannelSize(int channel, bool m100)
+{
+  // clang-format off
+  static const int a3[CHANNEL_COUNT] = {
+    sizeof(TimeStamp) + sizeof(SyncStamp),
+    sizeof(Quaternion),
+    sizeof(Vector3f),
+    sizeof(Vector3f) + sizeof(VelocityInfo),
+    sizeof(Vector3f),
+    sizeof(GlobalPosition) + sizeof(RelativePosition),
+    sizeof(GPSInfo),
+    sizeof(RTK),
+    sizeof(Mag),
+    sizeof(RC),
+    sizeof(Gimbal),
+    sizeof(Status),
+    sizeof(Battery),
+    sizeof(SDKInfo),
+    0,
+    0
+  };
+  static const int m100Layout[CHANNEL_COUNT] = {
+    sizeof(M100TimeStamp),
+    sizeof(Quaternion),
+    sizeof(Vector3f),
+    sizeof(M100Velocity),
+    sizeof(Vector3f),
+    sizeof(GlobalPosition),
+    sizeof(Mag),
+    sizeof(RC),
+    sizeof(Gimbal),
+    sizeof(M100Status),
+    sizeof(M100Battery),
+    sizeof(SDKInfo),
+    0,
+    0,
+    0,
+    0
+  };
+  // clang-format on
+  return m100 ? m100Layout[channel] : a3[channel];
+}
+
+bool
+PackagePlanner::planBroadcast(const uint16_t* minHz, bool m100,
+                              BroadcastPlan& plan) const
+{
+  uint16_t frameRate = 0;
+
+  memset(&plan, 0, sizeof(plan));
+  for (int c = 0; c < CHANNEL_COUNT; ++c)
+  {
+    uint16_t hz = 0;
+    if (minHz[c] > 0)
+    {
+      if (broadcastChannelSize(c, m100) == 0)
+      {
+        DERROR("Broadcast channel %d does not exist on this aircraft", c);
+        return false;
+      }
+      hz = roundUpFreq(minHz[c]);
+      if (hz == 0)
+      {
+        DERROR("Broadcast channel %d requested at %dHz, max frequency %dHz",
+               c, minHz[c], FREQ_LIST[FREQ_COUNT - 1]);
+        return false;
+      }
+    }
+    plan.hz[c]   = hz;
+    plan.freq[c] = toBroadcastFreq(hz);
+    if (hz > frameRate)
+    {
+      frameRate = hz;
+    }
+  }
+
+  //! One frame per tick of the fastest channel, slower channels spread
+  //! evenly over the ticks
+  for (uint32_t tick = 0; tick < frameRate; ++tick)
+  {
+    uint32_t payload = BROADCAST_PREFIX;
+    for (int c = 0; c < CHANNEL_COUNT; ++c)
+    {
+      if (plan.hz[c] && (tick * plan.hz[c]) % frameRate < plan.hz[c])
+      {
+        payload += broadcastChannelSize(c, m100);
+      }
+    }
+    plan.bytesPerSecond += frameBytes(payload);
+  }
+  return true;
+}
+
+float
+PackagePlanner::getUtilization(const SubscriptionPlan* subscription,
+                               const BroadcastPlan*    broadcast) const
+{
+  uint32_t bytes = 0;
+  if (subscription)
+  {
+    bytes += subscription->bytesPerSecond;
+  }
+  if (broadcast)
+  {
+    bytes += broadcast->bytesPerSecond;
+  }
+  return baudRate ? (float)bytes * BITS_PER_BYTE / baudRate : 1.0f;
+}
+
+bool
+PackagePlanner::report(const SubscriptionPlan* subscription,
+                       const BroadcastPlan*    broadcast) const
+{
+  if (subscription)
+  {
+    for (int i = 0; i < subscription->numberOfPackages; ++i)
+    {
+      const PlannedPackage& p = subscription->package[i];
+      DSTATUS("Package %d: %d topics, %d bytes @ %dHz, %u B/s", i,
+              p.numberOfTopics, p.dataSize, p.freq, p.bytesPerSecond);
+    }
+  }
+  if (broadcast)
+  {
+    DSTATUS("Broadcast: %u B/s", broadcast->bytesPerSecond);
+  }
+
+  float utilization = getUtilization(subscription, broadcast);
+  DSTATUS("Predicted link utilization %d%% of %u baud",
+          (int)(utilization * 100 + 0.5f), baudRate);
+  if (utilization > linkBudget)
+  {
+    DSTATUS("Warning: telemetry plan exceeds the %d%% link budget, ACKs "
+            "will be delayed",
+            (int)(linkBudget * 100 + 0.5f));
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,264 @@
+/** @file dji_periodic_scheduler.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Fixed-rate jobs for streaming setpoints (control, virtual RC, gimbal)
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_periodic_scheduler.hpp"
+#include "dji_log.hpp"
+
+#include <stdio.h>
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+PeriodicScheduler::PeriodicScheduler(HardDriver* driver)
+  : driver(driver)
+{
+  for (int i = 0; i < MAX_JOBS; ++i)
+  {
+    jobs[i].state.storeRelaxed(JOB_FREE);
+  }
+  current.storeRelaxed(-1);
+}
+
+PeriodicScheduler::~PeriodicScheduler()
+{
+}
+
+int
+PeriodicScheduler::addJob(time_us period, PeriodicCallBack callback,
+                          UserData userData, time_us phase)
+{
+  if (period == 0 || callback == 0)
+  {
+    return -1;
+  }
+
+  for (int i = 0; i < MAX_JOBS; ++i)
+  {
+    Job&    job      = jobs[i];
+    uint8_t expected = JOB_FREE;
+    if (!job.state.compareExchange(expected, JOB_CLAIMED))
+    {
+      continue;
+    }
+    job.callback = callback;
+    job.userData = userData;
+    job.period.storeRelaxed(period);
+    job.deadline = driver->getTimeStampUs() + phase;
+    job.runs.storeRelaxed(0);
+    job.overruns.storeRelaxed(0);
+    job.skipped.storeRelaxed(0);
+    job.durationMax.storeRelaxed(0);
+    job.jitter.reset();
+    job.state.store(JOB_ACTIVE);
+    return i;
+  }
+
+  DERROR("No free periodic job slot\n");
+  return -1;
+}
+
+bool
+PeriodicScheduler::removeJob(int id)
+{
+  if (id < 0 || id >= MAX_JOBS)
+  {
+    return false;
+  }
+  uint8_t expected = JOB_ACTIVE;
+  if (!jobs[id].state.compareExchange(expected, JOB_REMOVING))
+  {
+    return false;
+  }
+
+  //! Pairs with the fence in runDue(): either it sees JOB_REMOVING before
+  //! starting the job, or we see it running
+  atomicFence();
+  while (current.load() == id)
+  {
+    if (!waitForRun())
+    {
+      //! runDue() frees the slot after the run
+      return true;
+    }
+  }
+  release(id);
+  return true;
+}
+
+void
+PeriodicScheduler::release(int id)
+{
+  uint8_t expected = JOB_REMOVING;
+  jobs[id].state.compareExchange(expected, JOB_FREE);
+}
+
+bool
+PeriodicScheduler::waitForRun()
+{
+  //! Without a scheduler thread runDue() runs from an interrupt or from the
+  //! caller's own loop; waiting here could never end
+  return false;
+}
+
+bool
+PeriodicScheduler::setPeriod(int id, time_us period)
+{
+  if (id < 0 || id >= MAX_JOBS || period == 0 ||
+      jobs[id].state.load() != JOB_ACTIVE)
+  {
+    return false;
+  }
+  jobs[id].period.store(period);
+  return true;
+}
+
+bool
+PeriodicScheduler::getStats(int id, PeriodicStats& stats) const
+{
+  if (id < 0 || id >= MAX_JOBS || jobs[id].state.load() != JOB_ACTIVE)
+  {
+    return false;
+  }
+
+  const Job& job    = jobs[id];
+  stats.period      = job.period.loadRelaxed();
+  stats.runs        = job.runs.loadRelaxed();
+  stats.overruns    = job.overruns.loadRelaxed();
+  stats.skipped     = job.skipped.loadRelaxed();
+  stats.jitterP50   = job.jitter.getPercentile(50);
+  stats.jitterP99   = job.jitter.getPercentile(99);
+  stats.jitterMax   = job.jitter.getMax();
+  stats.durationMax = job.durationMax.loadRelaxed();
+  return true;
+}
+
+time_us
+PeriodicScheduler::runDue(time_us now)
+{
+  time_us next = 0;
+
+  for (int i = 0; i < MAX_JOBS; ++i)
+  {
+    Job& job = jobs[i];
+    current.store(i);
+    atomicFence();
+    if (job.state.load() != JOB_ACTIVE)
+    {
+      current.store(-1);
+      continue;
+    }
+
+    if (now >= job.deadline)
+    {
+      time_us start = driver->getTimeStampUs();
+      job.jitter.record(start > job.deadline ? start - job.deadline : 0);
+      job.callback(job.deadline, job.userData);
+      time_us end = driver->getTimeStampUs();
+
+      job.runs.add(1);
+      job.durationMax.max(end - start);
+
+      time_us period = job.period.load();
+      job.deadline += period;
+      if (end >= job.deadline)
+      {
+        //! Stay on the grid: drop the deadlines already missed
+        time_us missed = (end - job.deadline) / period + 1;
+        job.deadline += missed * period;
+        job.overruns.add(1);
+        job.skipped.add((uint32_t)missed);
+      }
+      now = end;
+    }
+
+    current.store(-1);
+    atomicFence();
+    if (job.state.load() == JOB_REMOVING)
+    {
+      release(i);
+      continue;
+    }
+
+    if (next == 0 || job.deadline < next)
+    {
+      next = job.deadline;
+    }
+  }
+  return next;
+}
+
+bool
+PeriodicScheduler::start(const RealTimeConfig& config)
+{
+  DSTATUS("No scheduler thread on this platform, call runDue() from a "
+          "timer\n");
+  return false;
+}
+
+void
+PeriodicScheduler::stop()
+{
+}
+
+void
+PeriodicScheduler::writeMetrics(MetricsWriter& writer) const
+{
+  static const double quantiles[] = { 0.5, 0.9, 0.99 };
+  char                labels[64];
+
+  writer.family("osdk_periodic_jitter_seconds", "summary",
+                "Start time of periodic jobs minus their deadline.");
+  for (int i = 0; i < MAX_JOBS; i++)
+  {
+    const Job& job = jobs[i];
+    if (job.state.load() != JOB_ACTIVE || job.jitter.getCount() == 0)
+    {
+      continue;
+    }
+    for (int q = 0; q < 3; q++)
+    {
+      snprintf(labels, sizeof(labels), "job=\"%d\",quantile=\"%g\"", i,
+               quantiles[q]);
+      writer.sample("osdk_periodic_jitter_seconds",
+                    job.jitter.getPercentile(quantiles[q] * 100) / 1e6,
+                    labels);
+    }
+    snprintf(labels, sizeof(labels), "job=\"%d\"", i);
+    writer.sample("osdk_periodic_jitter_seconds_sum",
+                  job.jitter.getSum() / 1e6, labels);
+    writer.sample("osdk_periodic_jitter_seconds_count",
+                  (uint64_t)job.jitter.getCount(), labels);
+  }
+
+  writer.family("osdk_periodic_overruns_total", "counter",
+                "Periodic job runs that ended after the next deadline.");
+  for (int i = 0; i < MAX_JOBS; i++)
+  {
+    if (jobs[i].state.load() == JOB_ACTIVE)
+    {
+      snprintf(labels, sizeof(labels), "job=\"%d\"", i);
+      writer.sample("osdk_periodic_overruns_total",
+                    (uint64_t)jobs[i].overruns.loadRelaxed(), labels);
+    }
+  }
+
+  writer.family("osdk_periodic_skipped_total", "counter",
+                "Periodic job deadlines dropped to catch up.");
+  for (int i = 0; i < MAX_JOBS; i++)
+  {
+    if (jobs[i].state.load() == JOB_ACTIVE)
+    {
+      snprintf(labels, sizeof(labels), "job=\"%d\"", i);
+      writer.sample("osdk_periodic_skipped_total",
+                    (uint64_t)jobs[i].skipped.loadRelaxed(), labels);
+    }
+  }
+}
@@ -0,0 +1,223 @@
+/** @file dji_setpoint_mailbox.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Latest-value-wins mailboxes for control, gimbal and virtual RC setpoints
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_setpoint_mailbox.hpp"
+#include "dji_vehicle.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+static const char* const slotNames[SetpointMailbox::SETPOINT_COUNT] = {
+  "control", "gimbal_angle", "gimbal_speed", "virtual_rc"
+};
+
+SetpointMailbox::SetpointMailbox(Vehicle* vehicle)
+  : vehicle(vehicle)
+{
+  mailboxes[SETPOINT_CONTROL].cmd = OpenProtocol::CMDSet::Control::control;
+  mailboxes[SETPOINT_GIMBAL_ANGLE].cmd =
+    OpenProtocol::CMDSet::Control::gimbalAngle;
+  mailboxes[SETPOINT_GIMBAL_SPEED].cmd =
+    OpenProtocol::CMDSet::Control::gimbalSpeed;
+  mailboxes[SETPOINT_VIRTUAL_RC].cmd = OpenProtocol::CMDSet::VirtualRC::data;
+  for (int i = 0; i < SETPOINT_COUNT; ++i)
+  {
+    mailboxes[i].owner = this;
+    mailboxes[i].job.storeRelaxed(-1);
+    mailboxes[i].writer.storeRelaxed(0);
+    mailboxes[i].pending.storeRelaxed(0);
+    mailboxes[i].sending.storeRelaxed(0);
+    mailboxes[i].frame.length = 0;
+  }
+}
+
+SetpointMailbox::~SetpointMailbox()
+{
+}
+
+bool
+SetpointMailbox::enable(Slot slot, uint16_t maxRate)
+{
+  PeriodicScheduler* scheduler = vehicle->getScheduler();
+  if (slot >= SETPOINT_COUNT || maxRate == 0 || scheduler == 0)
+  {
+    return false;
+  }
+
+  Mailbox& box    = mailboxes[slot];
+  time_us  period = 1000000 / maxRate;
+  int      job    = box.job.load();
+  if (job >= 0)
+  {
+    return scheduler->setPeriod(job, period);
+  }
+
+  job = scheduler->addJob(period, transmit, &box);
+  if (job < 0)
+  {
+    return false;
+  }
+  box.job.store(job);
+
+  PeriodicScheduler::RealTimeConfig config = { 0, -1, false };
+  scheduler->start(config);
+  return true;
+}
+
+void
+SetpointMailbox::disable(Slot slot)
+{
+  if (slot >= SETPOINT_COUNT)
+  {
+    return;
+  }
+  int job = mailboxes[slot].job.exchange(-1);
+  if (job >= 0)
+  {
+    vehicle->getScheduler()->removeJob(job);
+  }
+  mailboxes[slot].pending.store(0);
+}
+
+bool
+SetpointMailbox::isEnabled(Slot slot) const
+{
+  return slot < SETPOINT_COUNT && mailboxes[slot].job.load() >= 0;
+}
+
+bool
+SetpointMailbox::post(Slot slot, const void* data, int len)
+{
+  if (!isEnabled(slot))
+  {
+    return false;
+  }
+  if (len > MAX_PAYLOAD)
+  {
+    DERROR("Setpoint of %d bytes does not fit the mailbox\n", len);
+    return false;
+  }
+
+  Mailbox& box = mailboxes[slot];
+  uint8_t  frame[MAX_PAYLOAD + 1];
+  frame[0] = (uint8_t)len;
+  memcpy(frame + 1, data, len);
+
+  //! SeqBuffer takes a single writer
+  uint32_t expected = 0;
+  while (!box.writer.compareExchange(expected, 1))
+  {
+    expected = 0;
+  }
+  box.latest.write(frame, len + 1);
+  box.writer.store(0);
+
+  box.posted.add(1);
+  if (box.pending.exchange(1))
+  {
+    box.coalesced.add(1);
+  }
+  return true;
+}
+
+void
+SetpointMailbox::discard(Slot slot)
+{
+  if (slot >= SETPOINT_COUNT)
+  {
+    return;
+  }
+  Mailbox& box = mailboxes[slot];
+  if (box.pending.exchange(0))
+  {
+    box.coalesced.add(1);
+  }
+  //! Pairs with the fence in transmit(): it either finds nothing pending
+  //! or is waited for here
+  atomicFence();
+  while (box.sending.load())
+  {
+#if defined(__linux__)
+    sched_yield();
+#endif
+  }
+}
+
+void
+SetpointMailbox::transmit(time_us deadline, UserData userData)
+{
+  Mailbox* box = static_cast<Mailbox*>(userData);
+  box->sending.store(1);
+  atomicFence();
+  if (box->pending.exchange(0) == 0)
+  {
+    box->sending.store(0);
+    return;
+  }
+
+  uint8_t frame[MAX_PAYLOAD + 1];
+  if (box->latest.read(frame, 0, sizeof(frame)) != 0)
+  {
+    box->owner->vehicle->protocolLayer->sendPrepared(
+      &box->frame, DJI::OSDK::encrypt, box->cmd, frame + 1, frame[0]);
+    box->sent.add(1);
+  }
+  box->sending.store(0);
+}
+
+SetpointMailbox::Stats
+SetpointMailbox::getStats(Slot slot) const
+{
+  Stats stats = { 0, 0, 0 };
+  if (slot < SETPOINT_COUNT)
+  {
+    stats.posted    = mailboxes[slot].posted.loadRelaxed();
+    stats.sent      = mailboxes[slot].sent.loadRelaxed();
+    stats.coalesced = mailboxes[slot].coalesced.loadRelaxed();
+  }
+  return stats;
+}
+
+void
+SetpointMailbox::writeMetrics(MetricsWriter& writer) const
+{
+  char labels[32];
+
+  writer.family("osdk_setpoint_coalesced_total", "counter",
+                "Setpoints replaced by a newer one before they were sent.");
+  for (int i = 0; i < SETPOINT_COUNT; i++)
+  {
+    if (isEnabled((Slot)i))
+    {
+      snprintf(labels, sizeof(labels), "slot=\"%s\"", slotNames[i]);
+      writer.sample("osdk_setpoint_coalesced_total",
+                    (uint64_t)mailboxes[i].coalesced.loadRelaxed(), labels);
+    }
+  }
+
+  writer.family("osdk_setpoint_sent_total", "counter",
+                "Setpoints sent from the mailboxes.");
+  for (int i = 0; i < SETPOINT_COUNT; i++)
+  {
+    if (isEnabled((Slot)i))
+    {
+      snprintf(labels, sizeof(labels), "slot=\"%s\"", slotNames[i]);
+      writer.sample("osdk_setpoint_sent_total",
+                    (uint64_t)mailboxes[i].sent.loadRelaxed(), labels);
+    }
+  }
+}
@@ -14,50 +14,49 @@
 
 using namespace DJI::OSDK;
 using namespace DJI::OSDK::Telemetry;
-const uint8_t  ADD_PACKAEG_DATA_LENGTH = 200;
-const uint32_t DBVersion               = 0x00000100;
+const uint32_t DBVersion = 0x00000100;
 //
 // @note: make sure the order of entry is the same as in the enum TopicName
 // definition
 //
 // clang-format off
 TopicInfo Telemetry::TopicDataBase[] =
-{  // Topic Name ,                     UID,
-  {TOPIC_QUATERNION                , UID_QUATERNION               , sizeof(TypeMap<TOPIC_QUATERNION              >::type), 200 ,   0,  255,  0},
-  {TOPIC_ACCELERATION_GROUND       , UID_ACCELERATION_GROUND      , sizeof(TypeMap<TOPIC_ACCELERATION_GROUND     >::type), 200 ,   0,  255,  0},
-  {TOPIC_ACCELERATION_BODY         , UID_ACCELERATION_BODY        , sizeof(TypeMap<TOPIC_ACCELERATION_BODY       >::type), 200 ,   0,  255,  0},
-  {TOPIC_ACCELERATION_RAW          , UID_ACCELERATION_RAW         , sizeof(TypeMap<TOPIC_ACCELERATION_RAW        >::type), 400 ,   0,  255,  0},
-  {TOPIC_VELOCITY                  , UID_VELOCITY                 , sizeof(TypeMap<TOPIC_VELOCITY                >::type), 200 ,   0,  255,  0},
-  {TOPIC_ANGULAR_RATE_FUSIONED     , UID_ANGULAR_RATE_FUSIONED    , sizeof(TypeMap<TOPIC_ANGULAR_RATE_FUSIONED   >::type), 200 ,   0,  255,  0},
-  {TOPIC_ANGULAR_RATE_RAW          , UID_ANGULAR_RATE_RAW         , sizeof(TypeMap<TOPIC_ANGULAR_RATE_RAW        >::type), 400 ,   0,  255,  0},
-  {TOPIC_ALTITUDE_FUSIONED         , UID_ALTITUDE_FUSIONED        , sizeof(TypeMap<TOPIC_ALTITUDE_FUSIONED       >::type), 200 ,   0,  255,  0},
-  {TOPIC_ALTITUDE_BAROMETER        , UID_ALTITUDE_BAROMETER       , sizeof(TypeMap<TOPIC_ALTITUDE_BAROMETER      >::type), 200 ,   0,  255,  0},
-  {TOPIC_HEIGHT_HOMEPOINT          , UID_HEIGHT_HOMEPOINT         , sizeof(TypeMap<TOPIC_HEIGHT_HOMEPOINT        >::type), 1   ,   0,  255,  0},
-  {TOPIC_HEIGHT_FUSION             , UID_HEIGHT_FUSION            , sizeof(TypeMap<TOPIC_HEIGHT_FUSION           >::type), 100 ,   0,  255,  0},
-  {TOPIC_GPS_FUSED                 , UID_GPS_FUSED                , sizeof(TypeMap<TOPIC_GPS_FUSED               >::type), 50  ,   0,  255,  0},
-  {TOPIC_GPS_DATE                  , UID_GPS_DATE                 , sizeof(TypeMap<TOPIC_GPS_DATE                >::type), 50  ,   0,  255,  0},
-  {TOPIC_GPS_TIME                  , UID_GPS_TIME                 , sizeof(TypeMap<TOPIC_GPS_TIME                >::type), 50  ,   0,  255,  0},
-  {TOPIC_GPS_POSITION              , UID_GPS_POSITION             , sizeof(TypeMap<TOPIC_GPS_POSITION            >::type), 50  ,   0,  255,  0},
-  {TOPIC_GPS_VELOCITY              , UID_GPS_VELOCITY             , sizeof(TypeMap<TOPIC_GPS_VELOCITY            >::type), 50  ,   0,  255,  0},
-  {TOPIC_GPS_DETAILS               , UID_GPS_DETAILS              , sizeof(TypeMap<TOPIC_GPS_DETAILS             >::type), 50  ,   0,  255,  0},
-  {TOPIC_RTK_POSITION              , UID_RTK_POSITION             , sizeof(TypeMap<TOPIC_RTK_POSITION            >::type), 50  ,   0,  255,  0},
-  {TOPIC_RTK_VELOCITY              , UID_RTK_VELOCITY             , sizeof(TypeMap<TOPIC_RTK_VELOCITY            >::type), 50  ,   0,  255,  0},
-  {TOPIC_RTK_YAW                   , UID_RTK_YAW                  , sizeof(TypeMap<TOPIC_RTK_YAW                 >::type), 50  ,   0,  255,  0},
-  {TOPIC_RTK_POSITION_INFO         , UID_RTK_POSITION_INFO        , sizeof(TypeMap<TOPIC_RTK_POSITION_INFO       >::type), 50  ,   0,  255,  0},
-  {TOPIC_RTK_YAW_INFO              , UID_RTK_YAW_INFO             , sizeof(TypeMap<TOPIC_RTK_YAW_INFO            >::type), 50  ,   0,  255,  0},
-  {TOPIC_COMPASS                   , UID_COMPASS                  , sizeof(TypeMap<TOPIC_COMPASS                 >::type), 100 ,   0,  255,  0},
-  {TOPIC_RC                        , UID_RC                       , sizeof(TypeMap<TOPIC_RC                      >::type), 50  ,   0,  255,  0},
-  {TOPIC_GIMBAL_ANGLES             , UID_GIMBAL_ANGLES            , sizeof(TypeMap<TOPIC_GIMBAL_ANGLES           >::type), 50  ,   0,  255,  0},
-  {TOPIC_GIMBAL_STATUS             , UID_GIMBAL_STATUS            , sizeof(TypeMap<TOPIC_GIMBAL_STATUS           >::type), 50  ,   0,  255,  0},
-  {TOPIC_STATUS_FLIGHT             , UID_STATUS_FLIGHT            , sizeof(TypeMap<TOPIC_STATUS_FLIGHT           >::type), 50  ,   0,  255,  0},
-  {TOPIC_STATUS_DISPLAYMODE        , UID_STATUS_DISPLAYMODE       , sizeof(TypeMap<TOPIC_STATUS_DISPLAYMODE      >::type), 50  ,   0,  255,  0},
-  {TOPIC_STATUS_LANDINGGEAR        , UID_STATUS_LANDINGGEAR       , sizeof(TypeMap<TOPIC_STATUS_LANDINGGEAR      >::type), 50  ,   0,  255,  0},
-  {TOPIC_STATUS_MOTOR_START_ERROR  , UID_STATUS_MOTOR_START_ERROR , sizeof(TypeMap<TOPIC_STATUS_MOTOR_START_ERROR>::type), 50  ,   0,  255,  0},
-  {TOPIC_BATTERY_INFO              , UID_BATTERY_INFO             , sizeof(TypeMap<TOPIC_BATTERY_INFO            >::type), 50  ,   0,  255,  0},
-  {TOPIC_CONTROL_DEVICE            , UID_CONTROL_DEVICE           , sizeof(TypeMap<TOPIC_CONTROL_DEVICE          >::type), 50  ,   0,  255,  0},
-  {TOPIC_HARD_SYNC                 , UID_HARD_SYNC                , sizeof(TypeMap<TOPIC_HARD_SYNC               >::type), 400 ,   0,  255,  0},
-  {TOPIC_GPS_SIGNAL_LEVEL          , UID_GPS_SIGNAL_LEVEL         , sizeof(TypeMap<TOPIC_GPS_SIGNAL_LEVEL        >::type), 50 ,    0,  255,  0},
-  {TOPIC_GPS_CONTROL_LEVEL         , UID_GPS_CONTROL_LEVEL        , sizeof(TypeMap<TOPIC_GPS_CONTROL_LEVEL       >::type), 50 ,    0,  255,  0}
+{  // Topic Name ,                   UID,
+  {TOPIC_QUATERNION              , TopicTraits<TOPIC_QUATERNION              >::uid, sizeof(TypeMap<TOPIC_QUATERNION              >::type), TopicTraits<TOPIC_QUATERNION              >::maxFreq,   0,  255,  0},
+  {TOPIC_ACCELERATION_GROUND     , TopicTraits<TOPIC_ACCELERATION_GROUND     >::uid, sizeof(TypeMap<TOPIC_ACCELERATION_GROUND     >::type), TopicTraits<TOPIC_ACCELERATION_GROUND     >::maxFreq,   0,  255,  0},
+  {TOPIC_ACCELERATION_BODY       , TopicTraits<TOPIC_ACCELERATION_BODY       >::uid, sizeof(TypeMap<TOPIC_ACCELERATION_BODY       >::type), TopicTraits<TOPIC_ACCELERATION_BODY       >::maxFreq,   0,  255,  0},
+  {TOPIC_ACCELERATION_RAW        , TopicTraits<TOPIC_ACCELERATION_RAW        >::uid, sizeof(TypeMap<TOPIC_ACCELERATION_RAW        >::type), TopicTraits<TOPIC_ACCELERATION_RAW        >::maxFreq,   0,  255,  0},
+  {TOPIC_VELOCITY                , TopicTraits<TOPIC_VELOCITY                >::uid, sizeof(TypeMap<TOPIC_VELOCITY                >::type), TopicTraits<TOPIC_VELOCITY                >::maxFreq,   0,  255,  0},
+  {TOPIC_ANGULAR_RATE_FUSIONED   , TopicTraits<TOPIC_ANGULAR_RATE_FUSIONED   >::uid, sizeof(TypeMap<TOPIC_ANGULAR_RATE_FUSIONED   >::type), TopicTraits<TOPIC_ANGULAR_RATE_FUSIONED   >::maxFreq,   0,  255,  0},
+  {TOPIC_ANGULAR_RATE_RAW        , TopicTraits<TOPIC_ANGULAR_RATE_RAW        >::uid, sizeof(TypeMap<TOPIC_ANGULAR_RATE_RAW        >::type), TopicTraits<TOPIC_ANGULAR_RATE_RAW        >::maxFreq,   0,  255,  0},
+  {TOPIC_ALTITUDE_FUSIONED       , TopicTraits<TOPIC_ALTITUDE_FUSIONED       >::uid, sizeof(TypeMap<TOPIC_ALTITUDE_FUSIONED       >::type), TopicTraits<TOPIC_ALTITUDE_FUSIONED       >::maxFreq,   0,  255,  0},
+  {TOPIC_ALTITUDE_BAROMETER      , TopicTraits<TOPIC_ALTITUDE_BAROMETER      >::uid, sizeof(TypeMap<TOPIC_ALTITUDE_BAROMETER      >::type), TopicTraits<TOPIC_ALTITUDE_BAROMETER      >::maxFreq,   0,  255,  0},
+  {TOPIC_HEIGHT_HOMEPOINT        , TopicTraits<TOPIC_HEIGHT_HOMEPOINT        >::uid, sizeof(TypeMap<TOPIC_HEIGHT_HOMEPOINT        >::type), TopicTraits<TOPIC_HEIGHT_HOMEPOINT        >::maxFreq,   0,  255,  0},
+  {TOPIC_HEIGHT_FUSION           , TopicTraits<TOPIC_HEIGHT_FUSION           >::uid, sizeof(TypeMap<TOPIC_HEIGHT_FUSION           >::type), TopicTraits<TOPIC_HEIGHT_FUSION           >::maxFreq,   0,  255,  0},
+  {TOPIC_GPS_FUSED               , TopicTraits<TOPIC_GPS_FUSED               >::uid, sizeof(TypeMap<TOPIC_GPS_FUSED               >::type), TopicTraits<TOPIC_GPS_FUSED               >::maxFreq,   0,  255,  0},
+  {TOPIC_GPS_DATE                , TopicTraits<TOPIC_GPS_DATE                >::uid, sizeof(TypeMap<TOPIC_GPS_DATE                >::type), TopicTraits<TOPIC_GPS_DATE                >::maxFreq,   0,  255,  0},
+  {TOPIC_GPS_TIME                , TopicTraits<TOPIC_GPS_TIME                >::uid, sizeof(TypeMap<TOPIC_GPS_TIME                >::type), TopicTraits<TOPIC_GPS_TIME                >::maxFreq,   0,  255,  0},
+  {TOPIC_GPS_POSITION            , TopicTraits<TOPIC_GPS_POSITION            >::uid, sizeof(TypeMap<TOPIC_GPS_POSITION            >::type), TopicTraits<TOPIC_GPS_POSITION            >::maxFreq,   0,  255,  0},
+  {TOPIC_GPS_VELOCITY            , TopicTraits<TOPIC_GPS_VELOCITY            >::uid, sizeof(TypeMap<TOPIC_GPS_VELOCITY            >::type), TopicTraits<TOPIC_GPS_VELOCITY            >::maxFreq,   0,  255,  0},
+  {TOPIC_GPS_DETAILS             , TopicTraits<TOPIC_GPS_DETAILS             >::uid, sizeof(TypeMap<TOPIC_GPS_DETAILS             >::type), TopicTraits<TOPIC_GPS_DETAILS             >::maxFreq,   0,  255,  0},
+  {TOPIC_RTK_POSITION            , TopicTraits<TOPIC_RTK_POSITION            >::uid, sizeof(TypeMap<TOPIC_RTK_POSITION            >::type), TopicTraits<TOPIC_RTK_POSITION            >::maxFreq,   0,  255,  0},
+  {TOPIC_RTK_VELOCITY            , TopicTraits<TOPIC_RTK_VELOCITY            >::uid, sizeof(TypeMap<TOPIC_RTK_VELOCITY            >::type), TopicTraits<TOPIC_RTK_VELOCITY            >::maxFreq,   0,  255,  0},
+  {TOPIC_RTK_YAW                 , TopicTraits<TOPIC_RTK_YAW                 >::uid, sizeof(TypeMap<TOPIC_RTK_YAW                 >::type), TopicTraits<TOPIC_RTK_YAW                 >::maxFreq,   0,  255,  0},
+  {TOPIC_RTK_POSITION_INFO       , TopicTraits<TOPIC_RTK_POSITION_INFO       >::uid, sizeof(TypeMap<TOPIC_RTK_POSITION_INFO       >::type), TopicTraits<TOPIC_RTK_POSITION_INFO       >::maxFreq,   0,  255,  0},
+  {TOPIC_RTK_YAW_INFO            , TopicTraits<TOPIC_RTK_YAW_INFO            >::uid, sizeof(TypeMap<TOPIC_RTK_YAW_INFO            >::type), TopicTraits<TOPIC_RTK_YAW_INFO            >::maxFreq,   0,  255,  0},
+  {TOPIC_COMPASS                 , TopicTraits<TOPIC_COMPASS                 >::uid, sizeof(TypeMap<TOPIC_COMPASS                 >::type), TopicTraits<TOPIC_COMPASS                 >::maxFreq,   0,  255,  0},
+  {TOPIC_RC                      , TopicTraits<TOPIC_RC                      >::uid, sizeof(TypeMap<TOPIC_RC                      >::type), TopicTraits<TOPIC_RC                      >::maxFreq,   0,  255,  0},
+  {TOPIC_GIMBAL_ANGLES           , TopicTraits<TOPIC_GIMBAL_ANGLES           >::uid, sizeof(TypeMap<TOPIC_GIMBAL_ANGLES           >::type), TopicTraits<TOPIC_GIMBAL_ANGLES           >::maxFreq,   0,  255,  0},
+  {TOPIC_GIMBAL_STATUS           , TopicTraits<TOPIC_GIMBAL_STATUS           >::uid, sizeof(TypeMap<TOPIC_GIMBAL_STATUS           >::type), TopicTraits<TOPIC_GIMBAL_STATUS           >::maxFreq,   0,  255,  0},
+  {TOPIC_STATUS_FLIGHT           , TopicTraits<TOPIC_STATUS_FLIGHT           >::uid, sizeof(TypeMap<TOPIC_STATUS_FLIGHT           >::type), TopicTraits<TOPIC_STATUS_FLIGHT           >::maxFreq,   0,  255,  0},
+  {TOPIC_STATUS_DISPLAYMODE      , TopicTraits<TOPIC_STATUS_DISPLAYMODE      >::uid, sizeof(TypeMap<TOPIC_STATUS_DISPLAYMODE      >::type), TopicTraits<TOPIC_STATUS_DISPLAYMODE      >::maxFreq,   0,  255,  0},
+  {TOPIC_STATUS_LANDINGGEAR      , TopicTraits<TOPIC_STATUS_LANDINGGEAR      >::uid, sizeof(TypeMap<TOPIC_STATUS_LANDINGGEAR      >::type), TopicTraits<TOPIC_STATUS_LANDINGGEAR      >::maxFreq,   0,  255,  0},
+  {TOPIC_STATUS_MOTOR_START_ERROR, TopicTraits<TOPIC_STATUS_MOTOR_START_ERROR>::uid, sizeof(TypeMap<TOPIC_STATUS_MOTOR_START_ERROR>::type), TopicTraits<TOPIC_STATUS_MOTOR_START_ERROR>::maxFreq,   0,  255,  0},
+  {TOPIC_BATTERY_INFO            , TopicTraits<TOPIC_BATTERY_INFO            >::uid, sizeof(TypeMap<TOPIC_BATTERY_INFO            >::type), TopicTraits<TOPIC_BATTERY_INFO            >::maxFreq,   0,  255,  0},
+  {TOPIC_CONTROL_DEVICE          , TopicTraits<TOPIC_CONTROL_DEVICE          >::uid, sizeof(TypeMap<TOPIC_CONTROL_DEVICE          >::type), TopicTraits<TOPIC_CONTROL_DEVICE          >::maxFreq,   0,  255,  0},
+  {TOPIC_HARD_SYNC               , TopicTraits<TOPIC_HARD_SYNC               >::uid, sizeof(TypeMap<TOPIC_HARD_SYNC               >::type), TopicTraits<TOPIC_HARD_SYNC               >::maxFreq,   0,  255,  0},
+  {TOPIC_GPS_SIGNAL_LEVEL        , TopicTraits<TOPIC_GPS_SIGNAL_LEVEL        >::uid, sizeof(TypeMap<TOPIC_GPS_SIGNAL_LEVEL        >::type), TopicTraits<TOPIC_GPS_SIGNAL_LEVEL        >::maxFreq,    0,  255,  0},
+  {TOPIC_GPS_CONTROL_LEVEL       , TopicTraits<TOPIC_GPS_CONTROL_LEVEL       >::uid, sizeof(TypeMap<TOPIC_GPS_CONTROL_LEVEL       >::type), TopicTraits<TOPIC_GPS_CONTROL_LEVEL       >::maxFreq,    0,  255,  0}
 };
 // clang-format on
 
@@ -73,6 +72,7 @@ DataSubscription::DataSubscription(Vehicle* vehiclePtr)
   for (int i = 0; i < MAX_NUMBER_OF_PACKAGE; i++)
   {
     package[i].setPackageID(i);
+    package[i].getRateMonitor()->setName("Subscription package", i);
   }
 
   subscriptionDataDecodeHandler.callback = decodeCallback;
@@ -121,12 +121,14 @@ DataSubscription::decodeCallback(Vehicle*      vehiclePtr,
    * when the program starts,
    */
 
-  subscriptionHandle->extractOnePackage(&rcvContainer, p);
+  time_us now = rcvContainer.recvTime;
+  subscriptionHandle->extractOnePackage(&rcvContainer, p, now);
+  p->getRateMonitor()->update(now);
 
   VehicleCallBackHandler h = p->getUnpackHandler();
   if (NULL != h.callback)
   {
-    (*(h.callback))(vehiclePtr, rcvContainer, h.userData);
+    vehiclePtr->invokeUserCallback(h, rcvContainer);
   }
 }
 
@@ -158,18 +160,544 @@ DataSubscription::registerUserPackageUnpackCallback(
                                            userData);
 }
 
+bool
+DataSubscription::checkRunning(int packageID, ACK::ErrorCode* ack)
+{
+  if (packageID >= 0 && packageID < MAX_NUMBER_OF_PACKAGE &&
+      package[packageID].isOccupied())
+  {
+    return true;
+  }
+
+  DERROR("Package [%d] is not running. Call startPackage first.", packageID);
+  if (ack)
+  {
+    ack->info.cmd_set = OpenProtocol::CMDSet::subscribe;
+    ack->data = OpenProtocol::ErrorCode::SubscribeACK::PACKAGE_DOES_NOT_EXIST;
+  }
+  return false;
+}
+
+void
+DataSubscription::sendPauseResume(int packageID, bool pause)
+{
+  PauseResumeData data;
+  data.packageID = packageID;
+  data.pause     = pause ? 1 : 0;
+
+  int cbIndex = vehicle->callbackIdIndex();
+  vehicle->nbCallbackFunctions[cbIndex] =
+    (void*)DataSubscription::pauseResumeCallback;
+  vehicle->nbUserData[cbIndex] = &package[packageID];
+
+  protocol->send(2, DJI::OSDK::encrypt,
+                 OpenProtocol::CMDSet::Subscribe::pauseResume, &data,
+                 sizeof(data), 500, 1, true, cbIndex);
+}
+
+ACK::ErrorCode
+DataSubscription::sendPauseResume(int packageID, bool pause, int timeout)
+{
+  ACK::ErrorCode  ack;
+  PauseResumeData data;
+  data.packageID = packageID;
+  data.pause     = pause ? 1 : 0;
+
+  protocol->send(2, DJI::OSDK::encrypt,
+                 OpenProtocol::CMDSet::Subscribe::pauseResume, &data,
+                 sizeof(data), 500, 1, NULL, 0);
+
+  ack = *((ACK::ErrorCode*)getVehicle()->waitForACK(
+    OpenProtocol::CMDSet::Subscribe::pauseResume, timeout));
+
+  if (!ACK::getError(ack))
+  {
+    DSTATUS("Package %d %s.", packageID, pause ? "paused" : "resumed");
+    package[packageID].setPaused(pause);
+  }
+  else
+  {
+    ACK::getErrorCodeMessage(ack, __func__);
+  }
+
+  return ack;
+}
+
+void
+DataSubscription::pauseResumeCallback(Vehicle*      vehiclePtr,
+                                      RecvContainer rcvContainer,
+                                      UserData      pkgHandle)
+{
+  SubscriptionPackage* packageHandle = (SubscriptionPackage*)pkgHandle;
+
+  ACK::ErrorCode ackErrorCode;
+  ackErrorCode.info = rcvContainer.recvInfo;
+  ackErrorCode.data = rcvContainer.recvData.subscribeACK;
+
+  if (!ACK::getError(ackErrorCode))
+  {
+    bool pause =
+      ackErrorCode.data == OpenProtocol::ErrorCode::SubscribeACK::PAUSED;
+    DSTATUS("Package %d %s.", packageHandle->getInfo().packageID,
+            pause ? "paused" : "resumed");
+    packageHandle->setPaused(pause);
+  }
+  else
+  {
+    ACK::getErrorCodeMessage(ackErrorCode, __func__);
+  }
+}
+
 bool
 DataSubscription::pausePackage(int packageID)
 {
+  if (!checkRunning(packageID, NULL))
+  {
+    return false;
+  }
+  sendPauseResume(packageID, true);
   return true;
 }
 
+ACK::ErrorCode
+DataSubscription::pausePackage(int packageID, int timeout)
+{
+  ACK::ErrorCode ack;
+  if (!checkRunning(packageID, &ack))
+  {
+    ack.info.cmd_id = OpenProtocol::CMDSet::Subscribe::pauseResume[1];
+    return ack;
+  }
+  return sendPauseResume(packageID, true, timeout);
+}
+
 bool
 DataSubscription::resumePackage(int packageID)
 {
+  if (!checkRunning(packageID, NULL))
+  {
+    return false;
+  }
+  sendPauseResume(packageID, false);
+  return true;
+}
+
+ACK::ErrorCode
+DataSubscription::resumePackage(int packageID, int timeout)
+{
+  ACK::ErrorCode ack;
+  if (!checkRunning(packageID, &ack))
+  {
+    ack.info.cmd_id = OpenProtocol::CMDSet::Subscribe::pauseResume[1];
+    return ack;
+  }
+  return sendPauseResume(packageID, false, timeout);
+}
+
+bool
+DataSubscription::changePackageFrequency(int packageID, uint16_t newFreq)
+{
+  if (!checkRunning(packageID, NULL) ||
+      !package[packageID].isFrequencyValid(newFreq))
+  {
+    return false;
+  }
+
+  PackageFreqData data;
+  data.packageID = packageID;
+  data.freq      = newFreq;
+  package[packageID].setPendingFrequency(newFreq);
+
+  int cbIndex = vehicle->callbackIdIndex();
+  vehicle->nbCallbackFunctions[cbIndex] =
+    (void*)DataSubscription::changeFrequencyCallback;
+  vehicle->nbUserData[cbIndex] = &package[packageID];
+
+  protocol->send(2, DJI::OSDK::encrypt,
+                 OpenProtocol::CMDSet::Subscribe::updatePackageFreq, &data,
+                 sizeof(data), 500, 1, true, cbIndex);
   return true;
 }
 
+void
+DataSubscription::changeFrequencyCallback(Vehicle*      vehiclePtr,
+                                          RecvContainer rcvContainer,
+                                          UserData      pkgHandle)
+{
+  SubscriptionPackage* packageHandle = (SubscriptionPackage*)pkgHandle;
+
+  ACK::ErrorCode ackErrorCode;
+  ackErrorCode.info = rcvContainer.recvInfo;
+  ackErrorCode.data = rcvContainer.recvData.subscribeACK;
+
+  if (!ACK::getError(ackErrorCode))
+  {
+    DSTATUS("Package %d now at %dHz.", packageHandle->getInfo().packageID,
+            packageHandle->getPendingFrequency());
+    packageHandle->setFrequency(packageHandle->getPendingFrequency());
+  }
+  else
+  {
+    ACK::getErrorCodeMessage(ackErrorCode, __func__);
+    DSTATUS("Warning: the blocking changePackageFrequency can rebuild "
+            "package %d instead",
+            packageHandle->getInfo().packageID);
+  }
+}
+
+ACK::ErrorCode
+DataSubscription::changePackageFrequency(int packageID, uint16_t newFreq,
+                                         int timeout)
+{
+  ACK::ErrorCode ack;
+
+  if (!checkRunning(packageID, &ack))
+  {
+    ack.info.cmd_id = OpenProtocol::CMDSet::Subscribe::updatePackageFreq[1];
+    return ack;
+  }
+  if (!package[packageID].isFrequencyValid(newFreq))
+  {
+    ack.info.cmd_set = OpenProtocol::CMDSet::subscribe;
+    ack.info.cmd_id  = OpenProtocol::CMDSet::Subscribe::updatePackageFreq[1];
+    ack.data = OpenProtocol::ErrorCode::SubscribeACK::ILLEGAL_FREQUENCY;
+    return ack;
+  }
+
+  PackageFreqData data;
+  data.packageID = packageID;
+  data.freq      = newFreq;
+
+  protocol->send(2, DJI::OSDK::encrypt,
+                 OpenProtocol::CMDSet::Subscribe::updatePackageFreq, &data,
+                 sizeof(data), 500, 1, NULL, 0);
+
+  ack = *((ACK::ErrorCode*)getVehicle()->waitForACK(
+    OpenProtocol::CMDSet::Subscribe::updatePackageFreq, timeout));
+
+  if (!ACK::getError(ack))
+  {
+    DSTATUS("Package %d now at %dHz.", packageID, newFreq);
+    package[packageID].setFrequency(newFreq);
+    return ack;
+  }
+
+  DSTATUS("Warning: FC did not update package %d in place (0x%X), "
+          "rebuilding it",
+          packageID, ack.data);
+  return rebuildPackage(packageID, newFreq, timeout);
+}
+
+/*!
+ * @details Make before break: a spare package is started at the new rate
+ * first, then package[packageID] is removed and re-added, then the spare is
+ * removed. The topics are handed over between packages on first data, see
+ * SubscriptionPackage::claimTopics(); only if a package is removed before
+ * its replacement delivered anything do its topics read as unsubscribed,
+ * for at most one period of the new rate.
+ */
+ACK::ErrorCode
+DataSubscription::rebuildPackage(int packageID, uint16_t newFreq, int timeout)
+{
+  ACK::ErrorCode                   ack;
+  SubscriptionPackage::PackageInfo info = package[packageID].getInfo();
+  VehicleCallBackHandler handler = package[packageID].getUnpackHandler();
+  bool                   timeStamp = (info.config == 1);
+  TopicName              topics[TOTAL_TOPIC_NUMBER];
+
+  memcpy(topics, package[packageID].getTopicList(),
+         info.numberOfTopics * sizeof(TopicName));
+
+  int spare = -1;
+  for (int i = 0; i < MAX_NUMBER_OF_PACKAGE; ++i)
+  {
+    // Leave packages that are set up but not started to their owner
+    if (i != packageID && !package[i].isOccupied() &&
+        package[i].getInfo().numberOfTopics == 0)
+    {
+      spare = i;
+      break;
+    }
+  }
+
+  if (spare >= 0 && initPackageFromTopicList(spare, info.numberOfTopics,
+                                             topics, timeStamp, newFreq))
+  {
+    package[spare].setUserUnpackCallback(handler.callback, handler.userData);
+    ack = startPackage(spare, timeout);
+    if (ACK::getError(ack))
+    {
+      package[spare].cleanUpPackage();
+      spare = -1;
+    }
+  }
+  else
+  {
+    spare = -1;
+  }
+  if (spare < 0)
+  {
+    DSTATUS("Warning: no spare package, package %d stops until it is "
+            "re-added",
+            packageID);
+  }
+
+  ack = removePackage(packageID, timeout);
+  if (ACK::getError(ack))
+  {
+    // Still running at the old rate
+    if (spare >= 0)
+    {
+      removePackage(spare, timeout);
+    }
+    return ack;
+  }
+
+  initPackageFromTopicList(packageID, info.numberOfTopics, topics, timeStamp,
+                           newFreq);
+  package[packageID].setUserUnpackCallback(handler.callback,
+                                           handler.userData);
+  ack = startPackage(packageID, timeout);
+  if (ACK::getError(ack))
+  {
+    if (spare >= 0)
+    {
+      DERROR("Package %d could not be re-added, its topics continue on "
+             "package %d",
+             packageID, spare);
+    }
+    return ack;
+  }
+
+  if (spare >= 0)
+  {
+    removePackage(spare, timeout);
+  }
+  return ack;
+}
+
+bool
+DataSubscription::initPackagesFromPlan(
+  const PackagePlanner::SubscriptionPlan& plan)
+{
+  for (int i = 0; i < plan.numberOfPackages; ++i)
+  {
+    PackagePlanner::PlannedPackage p = plan.package[i];
+    if (!initPackageFromTopicList(i, p.numberOfTopics, p.topics,
+                                  plan.timeStamp, p.freq))
+    {
+      DERROR("Failed to set up planned package %d", i);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool
+DataSubscription::hasLayout(int packageID, const uint32_t* uids,
+                            int numberOfTopics, bool timeStamp)
+{
+  if (packageID < 0 || packageID >= MAX_NUMBER_OF_PACKAGE)
+  {
+    DERROR("Invalid package id %d", packageID);
+    return false;
+  }
+
+  SubscriptionPackage::PackageInfo info = package[packageID].getInfo();
+  if (!package[packageID].isOccupied() ||
+      info.numberOfTopics != numberOfTopics ||
+      info.config != (timeStamp ? 1 : 0) ||
+      memcmp(package[packageID].getUidList(), uids,
+             numberOfTopics * sizeof(uint32_t)) != 0)
+  {
+    DERROR("Package %d does not have the requested layout", packageID);
+    return false;
+  }
+  return true;
+}
+
+bool
+DataSubscription::enableHistory(TopicName topic, int capacity)
+{
+  if (topic >= TOTAL_TOPIC_NUMBER)
+  {
+    DERROR("Invalid topic %d", topic);
+    return false;
+  }
+  if (TopicDataBase[topic].pkgID < MAX_NUMBER_OF_PACKAGE)
+  {
+    DERROR("Topic %d is subscribed, enable its history before starting "
+           "package %d",
+           topic, TopicDataBase[topic].pkgID);
+    return false;
+  }
+  return history[topic].init(capacity, TopicDataBase[topic].size);
+}
+
+bool
+DataSubscription::disableHistory(TopicName topic)
+{
+  if (topic >= TOTAL_TOPIC_NUMBER)
+  {
+    DERROR("Invalid topic %d", topic);
+    return false;
+  }
+  if (TopicDataBase[topic].pkgID < MAX_NUMBER_OF_PACKAGE)
+  {
+    DERROR("Topic %d is subscribed, remove package %d first", topic,
+           TopicDataBase[topic].pkgID);
+    return false;
+  }
+  history[topic].release();
+  return true;
+}
+
+bool
+DataSubscription::readTopics(const TopicName* topics, void* const* dst,
+                             const size_t* sizes, int count,
+                             uint32_t* sequence, time_us* arrival)
+{
+  uint8_t  pkgOf[TOTAL_TOPIC_NUMBER];
+  uint32_t offsetOf[TOTAL_TOPIC_NUMBER];
+  uint32_t latest[MAX_NUMBER_OF_PACKAGE];
+  uint32_t token[MAX_NUMBER_OF_PACKAGE];
+
+  if (count > TOTAL_TOPIC_NUMBER)
+  {
+    DERROR("Too many topics in one snapshot: %d", count);
+    return false;
+  }
+
+  //! The topic to package mapping only changes on add/remove package
+  for (int i = 0; i < count; i++)
+  {
+    pkgOf[i]    = TopicDataBase[topics[i]].pkgID;
+    offsetOf[i] = TopicDataBase[topics[i]].offset;
+    if (pkgOf[i] >= MAX_NUMBER_OF_PACKAGE ||
+        offsetOf[i] + sizes[i] > (uint32_t)ADD_PACKAEG_DATA_LENGTH)
+    {
+      DERROR("Topic 0x%X value memory not initialized, return default",
+             topics[i]);
+      pkgOf[i] = MAX_NUMBER_OF_PACKAGE;
+      memset(dst[i], 0xFF, sizes[i]);
+      sequence[i] = 0;
+      arrival[i]  = 0;
+    }
+  }
+
+  for (int attempt = 0; attempt < MAX_SNAPSHOT_RETRIES; attempt++)
+  {
+    bool used[MAX_NUMBER_OF_PACKAGE] = { false };
+
+    for (int i = 0; i < count; i++)
+    {
+      uint8_t p = pkgOf[i];
+      if (p < MAX_NUMBER_OF_PACKAGE && !used[p])
+      {
+        latest[p] = package[p].getData().readBegin(token[p]);
+        used[p]   = true;
+      }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+      uint8_t p = pkgOf[i];
+      if (p >= MAX_NUMBER_OF_PACKAGE)
+      {
+        continue;
+      }
+      const SeqBuffer<ADD_PACKAEG_DATA_LENGTH>& data = package[p].getData();
+      if (latest[p] == 0)
+      {
+        memset(dst[i], 0, sizes[i]);
+        arrival[i] = 0;
+      }
+      else
+      {
+        memcpy(dst[i], data.slotData(latest[p]) + offsetOf[i], sizes[i]);
+        arrival[i] = data.getSlotStamp(latest[p]);
+      }
+      sequence[i] = latest[p];
+    }
+
+    bool consistent = true;
+    for (int p = 0; p < MAX_NUMBER_OF_PACKAGE; p++)
+    {
+      if (used[p] && !package[p].getData().readValidate(latest[p], token[p]))
+      {
+        consistent = false;
+      }
+    }
+    if (consistent)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+DataSubscription::getRateStats(int packageID, RateStats& stats)
+{
+  if (packageID < 0 || packageID >= MAX_NUMBER_OF_PACKAGE)
+  {
+    DERROR("Invalid package id %d", packageID);
+    return false;
+  }
+  package[packageID].getRateMonitor()->getStats(stats);
+  return true;
+}
+
+bool
+DataSubscription::getPackageInfo(int packageID,
+                                 SubscriptionPackage::PackageInfo& info,
+                                 Telemetry::TopicName*             topics)
+{
+  if (packageID < 0 || packageID >= MAX_NUMBER_OF_PACKAGE ||
+      !package[packageID].isOccupied())
+  {
+    return false;
+  }
+  info = package[packageID].getInfo();
+  if (topics)
+  {
+    memcpy(topics, package[packageID].getTopicList(),
+           info.numberOfTopics * sizeof(Telemetry::TopicName));
+  }
+  return true;
+}
+
+void
+DataSubscription::pollRates(time_us now)
+{
+  for (int i = 0; i < MAX_NUMBER_OF_PACKAGE; i++)
+  {
+    if (package[i].isOccupied())
+    {
+      package[i].getRateMonitor()->poll(now);
+    }
+  }
+}
+
+void
+DataSubscription::writeMetrics(MetricsWriter& writer)
+{
+  RateStats stats[MAX_NUMBER_OF_PACKAGE];
+  int       ids[MAX_NUMBER_OF_PACKAGE];
+  int       count = 0;
+
+  for (int i = 0; i < MAX_NUMBER_OF_PACKAGE; i++)
+  {
+    if (package[i].isOccupied())
+    {
+      package[i].getRateMonitor()->getStats(stats[count]);
+      ids[count++] = i;
+    }
+  }
+  RateMonitor::writeMetrics(writer, "osdk_subscription", "package", stats, ids,
+                            count);
+}
+
 void
 DataSubscription::verify()
 {
@@ -219,9 +747,7 @@ void
 DataSubscription::startPackage(int packageID)
 {
   // We need to prevent running startPackage multiple times
-  // The reason is that allocateDataBuffer will delete and reallocating the
-  // memory
-  // During this period, data will be copied to illegal memory
+  // The reason is that clearDataBuffer discards the data of a running package
   if (package[packageID].isOccupied())
   {
     DERROR("Cannot start package [%d] which "
@@ -234,7 +760,7 @@ DataSubscription::startPackage(int packageID)
   uint8_t buffer[ADD_PACKAEG_DATA_LENGTH];
 
   int bufferLength = package[packageID].serializePackageInfo(buffer);
-  package[packageID].allocateDataBuffer();
+  package[packageID].clearDataBuffer();
 
   // Register Callback
   int cbIndex = vehicle->callbackIdIndex();
@@ -280,9 +806,7 @@ DataSubscription::startPackage(int packageID, int timeout)
   ACK::ErrorCode ack;
 
   // We need to prevent running startPackage multiple times
-  // The reason is that allocateDataBuffer will delete and reallocating the
-  // memory
-  // During this period, data will be copied to illegal memory
+  // The reason is that clearDataBuffer discards the data of a running package
   if (package[packageID].isOccupied())
   {
     DERROR("Cannot start package [%d] which "
@@ -302,7 +826,7 @@ DataSubscription::startPackage(int packageID, int timeout)
   uint8_t buffer[ADD_PACKAEG_DATA_LENGTH];
 
   int bufferLength = package[packageID].serializePackageInfo(buffer);
-  package[packageID].allocateDataBuffer();
+  package[packageID].clearDataBuffer();
 
   protocol->send(2, DJI::OSDK::encrypt,
                  OpenProtocol::CMDSet::Subscribe::addPackage, buffer,
@@ -335,7 +859,7 @@ DataSubscription::startPackage(int packageID, int timeout)
 // adapted from DataSubscribe::Package::unpack
 void
 DataSubscription::extractOnePackage(RecvContainer*       pRcvContainer,
-                                    SubscriptionPackage* pkg)
+                                    SubscriptionPackage* pkg, time_us arrival)
 {
   //  uint8_t *data = ((uint8_t *)header) + sizeof(Header) + 2;
   //  DDEBUG(
@@ -347,23 +871,44 @@ DataSubscription::extractOnePackage(RecvContainer*       pRcvContainer,
   uint8_t* data = pRcvContainer->recvData.raw_ack_array;
   data++; // skip the package ID
 
-  /*
-   * TODO: Handle the time stamp field if it exists
-   */
-
-  protocol->getThreadHandle()->lockMSG();
-  if (pkg->getDataBuffer())
+  if (pkg->getBufferSize())
   {
     // TODO: the length needs to come from the header, not package
-    memcpy(pkg->getDataBuffer(), data, pkg->getBufferSize());
-    // memcpy(pkg->getDataBuffer(), data, header->length - CoreAPI::PackageMin -
-    // 3);
+    pkg->updateData(data, arrival);
   }
   else
   {
     DERROR("Package does not have a valid DataBuffer");
+    return;
+  }
+
+  if (pkg->isClaimPending())
+  {
+    // First data of a package replacing another one, see claimTopics()
+    pkg->claimTopics();
+  }
+
+  SubscriptionPackage::PackageInfo info = pkg->getInfo();
+  uint64_t                         fcTime = 0;
+  if (info.config == 1)
+  {
+    // The package starts with the FC time stamp
+    TimeStamp stamp;
+    memcpy(&stamp, data, sizeof(stamp));
+    fcTime = (uint64_t)stamp.time_ms * 1000 + stamp.time_ns / 1000;
+    vehicle->getClockSync()->addSample(fcTime, arrival);
+  }
+
+  TopicName* topics  = pkg->getTopicList();
+  uint32_t*  offsets = pkg->getOffsetList();
+  for (int i = 0; i < info.numberOfTopics; ++i)
+  {
+    if (history[topics[i]].isEnabled() &&
+        TopicDataBase[topics[i]].pkgID == info.packageID)
+    {
+      history[topics[i]].push(data + offsets[i], arrival, fcTime);
+    }
   }
-  protocol->getThreadHandle()->freeMSG();
 }
 
 void
@@ -434,7 +979,9 @@ DataSubscription::removePackage(int packageID, int timeout)
 //////////////////////
 SubscriptionPackage::SubscriptionPackage()
   : occupied(false)
-  , incomingDataBuffer(NULL)
+  , paused(false)
+  , claimPending(false)
+  , pendingFreq(0)
   , packageDataSize(0)
 {
   userUnpackHandler.callback = NULL;
@@ -470,6 +1017,70 @@ SubscriptionPackage::setOccupied(bool status)
   occupied = status;
 }
 
+bool
+SubscriptionPackage::isPaused()
+{
+  return paused;
+}
+
+void
+SubscriptionPackage::setPaused(bool status)
+{
+  paused = status;
+  if (!paused)
+  {
+    // The pause is not a delivery gap
+    rateMonitor.reset();
+  }
+  rateMonitor.setExpectedRate(paused ? 0 : info.freq);
+}
+
+bool
+SubscriptionPackage::isFrequencyValid(uint16_t freq)
+{
+  if (freq == 0)
+  {
+    return false;
+  }
+  for (int i = 0; i < info.numberOfTopics; i++)
+  {
+    if (TopicDataBase[topicList[i]].maxFreq < freq)
+    {
+      DERROR("Requesting Frequency %d, Max Frequency %d", freq,
+             TopicDataBase[topicList[i]].maxFreq);
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+SubscriptionPackage::setFrequency(uint16_t freq)
+{
+  info.freq = freq;
+  for (int i = 0; i < info.numberOfTopics; i++)
+  {
+    if (TopicDataBase[topicList[i]].pkgID == info.packageID)
+    {
+      TopicDataBase[topicList[i]].freq = freq;
+    }
+  }
+  rateMonitor.reset();
+  rateMonitor.setExpectedRate(paused ? 0 : freq);
+}
+
+uint16_t
+SubscriptionPackage::getPendingFrequency()
+{
+  return pendingFreq;
+}
+
+void
+SubscriptionPackage::setPendingFrequency(uint16_t freq)
+{
+  pendingFreq = freq;
+}
+
 /*
  * Fill in the necessary information for ADD_PACKAGE call
  */
@@ -520,18 +1131,6 @@ SubscriptionPackage::setTopicList(TopicName* topics, int numberOfTopics,
   return true;
 }
 
-void
-SubscriptionPackage::allocateDataBuffer()
-{
-  if (incomingDataBuffer)
-  {
-    delete incomingDataBuffer;
-    incomingDataBuffer = NULL;
-  }
-
-  incomingDataBuffer = new uint8_t[packageDataSize];
-}
-
 void
 SubscriptionPackage::cleanUpPackage()
 {
@@ -552,11 +1151,29 @@ SubscriptionPackage::cleanUpPackage()
 void
 SubscriptionPackage::clearDataBuffer()
 {
-  if (incomingDataBuffer)
+  incomingData.clear();
+}
+
+void
+SubscriptionPackage::updateData(const uint8_t* data, time_us arrival)
+{
+  incomingData.write(data, packageDataSize, arrival);
+}
+
+const SeqBuffer<ADD_PACKAEG_DATA_LENGTH>&
+SubscriptionPackage::getData() const
+{
+  return incomingData;
+}
+
+uint32_t
+SubscriptionPackage::readData(void* dst, uint32_t offset, size_t len) const
+{
+  if (offset + len > (uint32_t)ADD_PACKAEG_DATA_LENGTH)
   {
-    delete incomingDataBuffer;
-    incomingDataBuffer = NULL;
+    return 0;
   }
+  return incomingData.read(dst, offset, len);
 }
 
 int
@@ -604,12 +1221,6 @@ SubscriptionPackage::getOffsetList()
   return &offsetList[0];
 }
 
-uint8_t*
-SubscriptionPackage::getDataBuffer()
-{
-  return incomingDataBuffer;
-}
-
 uint32_t
 SubscriptionPackage::getBufferSize()
 {
@@ -622,37 +1233,79 @@ SubscriptionPackage::getUnpackHandler()
   return userUnpackHandler;
 }
 
+RateMonitor*
+SubscriptionPackage::getRateMonitor()
+{
+  return &rateMonitor;
+}
+
 void
 SubscriptionPackage::packageAddSuccessHandler()
 {
-  // In the TopicDataBase, we set the freq, protocoland data pointer for each
-  // subscribed topic
+  claimPending = false;
   for (size_t i = 0; i < info.numberOfTopics; ++i)
   {
-    TopicDataBase[topicList[i]].pkgID = info.packageID;
-    TopicDataBase[topicList[i]].freq  = info.freq;
-
-    // The offset already takes time stamp into consideration
-    TopicDataBase[topicList[i]].latest = incomingDataBuffer + offsetList[i];
+    if (TopicDataBase[topicList[i]].pkgID != 255)
+    {
+      claimPending = true;
+    }
   }
+  if (!claimPending)
+  {
+    claimTopics();
+  }
+
+  paused = false;
+  rateMonitor.reset();
+  rateMonitor.setExpectedRate(info.freq);
 
   setOccupied(true);
 }
 
+void
+SubscriptionPackage::claimTopics()
+{
+  // In the TopicDataBase, we set the freq, package and data offset for each
+  // subscribed topic
+  for (size_t i = 0; i < info.numberOfTopics; ++i)
+  {
+    // The offset already takes time stamp into consideration; set it before
+    // pkgID, which is what getValue() looks at first
+    TopicDataBase[topicList[i]].offset = offsetList[i];
+    TopicDataBase[topicList[i]].freq   = info.freq;
+    TopicDataBase[topicList[i]].pkgID  = info.packageID;
+  }
+  claimPending = false;
+}
+
+bool
+SubscriptionPackage::isClaimPending()
+{
+  return claimPending;
+}
+
 void
 SubscriptionPackage::packageRemoveSuccessHandler()
 {
   // Clean up
-  // Step 1. Clear fields in TopicDataBase
+  // Step 1. Clear fields in TopicDataBase, unless another package has
+  // taken the topic over
   for (size_t i = 0; i < info.numberOfTopics; ++i)
   {
+    if (TopicDataBase[topicList[i]].pkgID != info.packageID)
+    {
+      continue;
+    }
     TopicDataBase[topicList[i]].freq   = 0;
     TopicDataBase[topicList[i]].pkgID  = 255;  // Set pkgID to invalid
-    TopicDataBase[topicList[i]].latest = NULL; // Clear data pointer
+    TopicDataBase[topicList[i]].offset = 0;
   }
 
   // Step 2. Clean up package content, except packageID
   cleanUpPackage();
+  rateMonitor.setExpectedRate(0);
+  paused       = false;
+  claimPending = false;
 
   setOccupied(false);
 }
@@ -0,0 +1,349 @@
+/** @file dji_topic_history.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Time-indexed history of Subscribe-style telemetry topics
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_topic_history.hpp"
+#include "dji_log.hpp"
+
+#include <new>
+#include <string.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+TopicHistory::TopicHistory()
+  : capacity(0)
+  , valueSize(0)
+  , hostTime(0)
+  , fcTime(0)
+  , values(0)
+  , slotIndex(0)
+  , count(0)
+  , enabled(false)
+  , readers(0)
+{
+}
+
+TopicHistory::~TopicHistory()
+{
+  release();
+}
+
+bool
+TopicHistory::init(int capacity, int valueSize)
+{
+  release();
+
+  //! One slot is always kept out of the readable span for the writer
+  if (capacity < 2 || valueSize <= 0)
+  {
+    DERROR("Invalid history capacity %d for %d byte values", capacity,
+           valueSize);
+    return false;
+  }
+
+  hostTime  = new (std::nothrow) time_us[capacity];
+  fcTime    = new (std::nothrow) uint64_t[capacity];
+  values    = new (std::nothrow) uint8_t[capacity * valueSize];
+  slotIndex = new (std::nothrow) Atomic<uint32_t>[capacity];
+  if (!hostTime || !fcTime || !values || !slotIndex)
+  {
+    DERROR("Failed to allocate a history of %d samples", capacity);
+    release();
+    return false;
+  }
+
+  this->valueSize = valueSize;
+  this->capacity  = capacity;
+  count.storeRelaxed(0);
+  //! Publishes the arrays to readers that check enabled
+  enabled.store(true);
+  return true;
+}
+
+void
+TopicHistory::release()
+{
+  enabled.store(false);
+  //! Pairs with the fence in enterRead(): a query either sees the history
+  //! disabled or is counted here
+  atomicFence();
+  while (readers.load() != 0)
+  {
+#if defined(__linux__)
+    sched_yield();
+#endif
+  }
+
+  capacity  = 0;
+  valueSize = 0;
+  delete[] hostTime;
+  delete[] fcTime;
+  delete[] values;
+  delete[] slotIndex;
+  hostTime  = 0;
+  fcTime    = 0;
+  values    = 0;
+  slotIndex = 0;
+  count.storeRelaxed(0);
+}
+
+bool
+TopicHistory::isEnabled() const
+{
+  return enabled.load();
+}
+
+bool
+TopicHistory::enterRead() const
+{
+  readers.add(1);
+  atomicFence();
+  if (enabled.load())
+  {
+    return true;
+  }
+  readers.add((uint32_t)-1);
+  return false;
+}
+
+void
+TopicHistory::leaveRead() const
+{
+  readers.add((uint32_t)-1);
+}
+
+int
+TopicHistory::getCapacity() const
+{
+  return capacity;
+}
+
+void
+TopicHistory::push(const void* value, time_us host, uint64_t fc)
+{
+  //! A frame decoded while the package is being removed may race release()
+  if (!enterRead())
+  {
+    return;
+  }
+  uint32_t index = count.loadRelaxed();
+  uint32_t slot  = index % capacity;
+
+  slotIndex[slot].store(0);
+  atomicFence();
+  hostTime[slot] = host;
+  fcTime[slot]   = fc;
+  memcpy(values + slot * valueSize, value, valueSize);
+  slotIndex[slot].store(index + 1);
+  count.store(index + 1);
+  leaveRead();
+}
+
+uint64_t
+TopicHistory::timeOf(uint32_t index, Clock clock) const
+{
+  uint32_t slot = index % capacity;
+  return clock == FC_TIME ? fcTime[slot] : hostTime[slot];
+}
+
+bool
+TopicHistory::copySlot(uint32_t index, void* value, time_us* host,
+                       uint64_t* fc) const
+{
+  uint32_t slot = index % capacity;
+
+  if (slotIndex[slot].load() != index + 1)
+  {
+    return false;
+  }
+  if (value)
+  {
+    memcpy(value, values + slot * valueSize, valueSize);
+  }
+  if (host)
+  {
+    *host = hostTime[slot];
+  }
+  if (fc)
+  {
+    *fc = fcTime[slot];
+  }
+  atomicFence();
+  return slotIndex[slot].loadRelaxed() == index + 1;
+}
+
+uint32_t
+TopicHistory::lowerBound(uint32_t first, uint32_t end, uint64_t t,
+                         Clock clock) const
+{
+  //! Times read here may be torn by the writer, callers validate the result
+  while (first < end)
+  {
+    uint32_t mid = first + (end - first) / 2;
+    if (timeOf(mid, clock) < t)
+    {
+      first = mid + 1;
+    }
+    else
+    {
+      end = mid;
+    }
+  }
+  return first;
+}
+
+bool
+TopicHistory::bracket(uint64_t t, Clock clock, void* before, void* after,
+                      double& alpha) const
+{
+  if (!enterRead())
+  {
+    return false;
+  }
+  bool found = findBracket(t, clock, before, after, alpha);
+  leaveRead();
+  return found;
+}
+
+bool
+TopicHistory::findBracket(uint64_t t, Clock clock, void* before, void* after,
+                          double& alpha) const
+{
+  for (int retry = 0; retry < MAX_RETRIES; ++retry)
+  {
+    uint32_t end = count.load();
+    if (end == 0)
+    {
+      return false;
+    }
+    uint32_t first =
+      end > (uint32_t)(capacity - 1) ? end - (capacity - 1) : 0;
+
+    uint32_t hi = lowerBound(first, end, t, clock);
+    if (hi == end)
+    {
+      //! Newer than the latest sample, no extrapolation
+      time_us  host;
+      uint64_t fc;
+      if (copySlot(end - 1, 0, &host, &fc) &&
+          (clock == FC_TIME ? fc : host) < t)
+      {
+        return false;
+      }
+      continue;
+    }
+    uint32_t lo = hi > first ? hi - 1 : hi;
+
+    time_us  hostLo, hostHi;
+    uint64_t fcLo, fcHi;
+    if (!copySlot(lo, before, &hostLo, &fcLo) ||
+        !copySlot(hi, after, &hostHi, &fcHi))
+    {
+      continue;
+    }
+
+    uint64_t tLo = clock == FC_TIME ? fcLo : hostLo;
+    uint64_t tHi = clock == FC_TIME ? fcHi : hostHi;
+    if (clock == FC_TIME && (tLo == 0 || tHi == 0))
+    {
+      //! Package subscribed without time stamps
+      return false;
+    }
+    if (lo == hi && t != tLo)
+    {
+      //! Older than the oldest sample kept
+      return false;
+    }
+    if (t < tLo || t > tHi)
+    {
+      //! The search read a slot while it was rewritten
+      continue;
+    }
+
+    alpha = tHi > tLo ? (double)(t - tLo) / (double)(tHi - tLo) : 0.0;
+    return true;
+  }
+  return false;
+}
+
+int
+TopicHistory::range(uint64_t t0, uint64_t t1, Clock clock, void* out,
+                    int valueStride, time_us* hostTimes, uint64_t* fcTimes,
+                    int timeStride, int maxCount) const
+{
+  if (t0 > t1 || !enterRead())
+  {
+    return 0;
+  }
+
+  uint32_t end = count.load();
+  uint32_t first =
+    end > (uint32_t)(capacity - 1) ? end - (capacity - 1) : 0;
+  int n = 0;
+
+  for (uint32_t i = lowerBound(first, end, t0, clock);
+       i < end && n < maxCount; ++i)
+  {
+    uint8_t*  v  = (uint8_t*)out + n * valueStride;
+    time_us*  h  = (time_us*)((uint8_t*)hostTimes + n * timeStride);
+    uint64_t* f  = (uint64_t*)((uint8_t*)fcTimes + n * timeStride);
+    if (!copySlot(i, v, h, f))
+    {
+      //! Overwritten meanwhile, the sample is gone
+      continue;
+    }
+    uint64_t t = clock == FC_TIME ? *f : *h;
+    if (t > t1)
+    {
+      break;
+    }
+    if (t >= t0)
+    {
+      ++n;
+    }
+  }
+  leaveRead();
+  return n;
+}
+
+int
+TopicHistory::last(int n, void* out, int valueStride, time_us* hostTimes,
+                   uint64_t* fcTimes, int timeStride) const
+{
+  if (n <= 0 || !enterRead())
+  {
+    return 0;
+  }
+
+  uint32_t end = count.load();
+  uint32_t first =
+    end > (uint32_t)(capacity - 1) ? end - (capacity - 1) : 0;
+  if (end - first > (uint32_t)n)
+  {
+    first = end - n;
+  }
+
+  int copied = 0;
+  for (uint32_t i = first; i < end; ++i)
+  {
+    if (copySlot(i, (uint8_t*)out + copied * valueStride,
+                 (time_us*)((uint8_t*)hostTimes + copied * timeStride),
+                 (uint64_t*)((uint8_t*)fcTimes + copied * timeStride)))
+    {
+      ++copied;
+    }
+  }
+  leaveRead();
+  return copied;
+}
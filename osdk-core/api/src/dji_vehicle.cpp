@@ -10,6 +10,7 @@
  */
 
 #include "dji_vehicle.hpp"
+#include "dji_trace.hpp"
 #include <new>
 
 using namespace DJI;
@@ -28,6 +29,12 @@ Vehicle::Vehicle(const char* device, uint32_t baudRate, bool threadSupport)
   , hardSync(NULL)
   , readThread(NULL)
   , callbackThread(NULL)
+  , scheduler(NULL)
+  , setpoints(this)
+  , linkQuality(this)
+  , workers(NULL)
+  , workerThreads(false)
+  , isolatedCount(0)
 {
   if (!device)
     DERROR("Illegal serial device handle!\n");
@@ -54,6 +61,12 @@ Vehicle::Vehicle(bool threadSupport)
   , hardSync(NULL)
   , readThread(NULL)
   , callbackThread(NULL)
+  , scheduler(NULL)
+  , setpoints(this)
+  , linkQuality(this)
+  , workers(NULL)
+  , workerThreads(false)
+  , isolatedCount(0)
 {
   this->threadSupported = threadSupport;
   callbackId            = 0;
@@ -72,8 +85,37 @@ Vehicle::mandatorySetUp()
     // We only need a buffer of recvContainers if we are using threads
     this->nbCallbackRecvContainer = new RecvContainer[200];
     this->circularBuffer = new CircularBuffer();
+
+#if defined(__linux__) && !defined(QT) && !defined(STM32)
+    workers = new (std::nothrow) PosixWorkerPool();
+#else
+    workers = new (std::nothrow) WorkerPool();
+#endif
+    if (workers == NULL)
+    {
+      DERROR("Failed to allocate the worker pool\n");
+    }
+    else
+    {
+      workerThreads = workers->start(OSDK_WORKER_THREADS);
+    }
   }
 
+  for (int i = 0; i < DispatchTable::MAX_SUBSCRIBERS; ++i)
+  {
+    subscriberLanes[i].vehicle = this;
+    subscriberLanes[i].index   = i;
+    subscriberLanes[i].lane    = -1;
+  }
+
+  typedACK.store(NO_TYPED_ACK);
+
+  //! No ACK yet, see waitForACKFrame()
+  memset(&lastReceivedFrame, 0, sizeof(lastReceivedFrame));
+  lastReceivedFrame.recvInfo.cmd_set = 0xFF;
+
+  initDispatch();
+
   /*
    * @note Initialize predefined callbacks
    */
@@ -228,22 +270,38 @@ Vehicle::callbackPoll()
   {
     circularBuffer->cbPop(circularBuffer, &cbVal, &recvCont);
     protocolLayer->getThreadHandle()->freeNonBlockCBAck();
-    cbVal.callback(this, recvCont, cbVal.userData);
+    invokeUserCallback(cbVal, recvCont, false);
   }
   else
   {
     protocolLayer->getThreadHandle()->freeNonBlockCBAck();
   }
+
+  if (workers && !workerThreads)
+  {
+    workers->runOne();
+  }
 }
 
 Vehicle::~Vehicle()
 {
+  if (scheduler)
+  {
+    scheduler->stop();
+    delete scheduler;
+  }
   if (threadSupported)
   {
     this->readThread->stopThread();
     this->callbackThread->stopThread();
     delete[](nbCallbackRecvContainer);
   }
+  //! After the threads that post to it
+  if (workers)
+  {
+    workers->stop();
+    delete workers;
+  }
   delete this->camera;
   delete this->gimbal;
   delete this->control;
@@ -847,6 +905,18 @@ void
 Vehicle::processReceivedData(RecvContainer receivedFrame)
 {
   receivedFrame.recvInfo.version = this->getFwVersion();
+  OSDK_TRACE_RECV(dispatch, receivedFrame);
+
+  //! Any incoming frame drives the telemetry rate windows
+  time_us now = receivedFrame.recvTime;
+  if (subscribe)
+  {
+    subscribe->pollRates(now);
+  }
+  if (broadcast)
+  {
+    broadcast->pollRates(now);
+  }
   if (receivedFrame.dispatchInfo.isAck)
   {
     // TODO Fill up ACKErorCode Container
@@ -862,26 +932,32 @@ Vehicle::processReceivedData(RecvContainer receivedFrame)
       {
         this->nbCallbackRecvContainer[receivedFrame.dispatchInfo.callbackID] =
             receivedFrame;
-        protocolLayer->getThreadHandle()->lockNonBlockCBAck();
-        this->circularBuffer->cbPush(
-          this->circularBuffer, this->nbVehicleCallBackHandler,
+        deferCallback(
+          this->nbVehicleCallBackHandler,
           this->nbCallbackRecvContainer[receivedFrame.dispatchInfo.callbackID]);
-        protocolLayer->getThreadHandle()->freeNonBlockCBAck();
       }
       else
-        this->nbVehicleCallBackHandler.callback(
-          this,
-          receivedFrame,
-          this->nbVehicleCallBackHandler.userData);
+      {
+        invokeUserCallback(this->nbVehicleCallBackHandler, receivedFrame,
+                           false);
+      }
     }
 
     else
     {
       DDEBUG("Dispatcher identified as blocking call\n");
-      // TODO remove
-      this->lastReceivedFrame = receivedFrame;
-
-      ACKHandler(static_cast<void*>(&receivedFrame));
+      //! Written under the ACK lock so waitForACKFrame() cannot check it
+      //! and then miss the notify
+      protocolLayer->getThreadHandle()->lockACK();
+      setLastReceivedFrame(receivedFrame);
+      protocolLayer->getThreadHandle()->freeACK();
+
+      //! A typed call decodes its own ACK, see expectACKFrame()
+      if (typedACK.load() != (uint16_t)(receivedFrame.recvInfo.cmd_set << 8 |
+                                         receivedFrame.recvInfo.cmd_id))
+      {
+        ACKHandler(static_cast<void*>(&receivedFrame));
+      }
       protocolLayer->getThreadHandle()->notify();
     }
   }
@@ -892,6 +968,275 @@ Vehicle::processReceivedData(RecvContainer receivedFrame)
   }
 }
 
+void
+Vehicle::invokeUserCallback(VehicleCallBackHandler handler,
+                            RecvContainer& recvFrame, bool deferrable)
+{
+  if (deferrable && threadSupported &&
+      callbackProfiler.isIsolated(handler.callback))
+  {
+    //! Keep a handler that keeps blowing its budget off the read thread
+    if (!deferIsolated(handler, recvFrame))
+    {
+      deferCallback(handler, recvFrame);
+    }
+    return;
+  }
+
+  time_us start = protocolLayer->getDriver()->getTimeStampUs();
+  OSDK_TRACE_RECV(callback_entry, recvFrame);
+  handler.callback(this, recvFrame, handler.userData);
+  OSDK_TRACE_RECV(callback_return, recvFrame);
+  callbackProfiler.record(handler.callback,
+                          protocolLayer->getDriver()->getTimeStampUs() - start);
+}
+
+bool
+Vehicle::deferIsolated(VehicleCallBackHandler handler,
+                       RecvContainer&         recvFrame)
+{
+  if (workers == NULL)
+  {
+    return false;
+  }
+
+  IsolatedSlot* slot = NULL;
+  for (int i = 0; i < isolatedCount; ++i)
+  {
+    if (isolatedSlots[i].handler.callback == handler.callback &&
+        isolatedSlots[i].handler.userData == handler.userData)
+    {
+      slot = &isolatedSlots[i];
+      break;
+    }
+  }
+  if (slot == NULL)
+  {
+    if (isolatedCount == CallbackProfiler::TABLE_SIZE)
+    {
+      return false;
+    }
+    slot          = &isolatedSlots[isolatedCount];
+    slot->vehicle = this;
+    slot->handler = handler;
+    slot->lane    = workers->addLane(runIsolated, (UserData)slot);
+    if (slot->lane < 0)
+    {
+      return false;
+    }
+    isolatedCount++;
+  }
+
+  //! Latest wins: a frame the worker has not run yet is replaced
+  if (slot->latest.getWriteCount() != slot->taken.load())
+  {
+    callbackProfiler.countDropped(handler.callback);
+  }
+  slot->latest.write(&recvFrame, sizeof(recvFrame));
+  workers->post(slot->lane);
+  return true;
+}
+
+bool
+Vehicle::runIsolated(UserData userData)
+{
+  IsolatedSlot* slot = static_cast<IsolatedSlot*>(userData);
+  RecvContainer frame;
+
+  uint32_t written = slot->latest.read(&frame, 0, sizeof(frame));
+  if (written == 0 || written == slot->taken.load())
+  {
+    return false;
+  }
+  slot->taken.store(written);
+  slot->vehicle->invokeUserCallback(slot->handler, frame, false);
+  //! A frame stored meanwhile posted the lane again
+  return false;
+}
+
+CallbackProfiler*
+Vehicle::getCallbackProfiler()
+{
+  return &callbackProfiler;
+}
+
+ClockSync*
+Vehicle::getClockSync()
+{
+  return &clockSync;
+}
+
+void
+Vehicle::initDispatch()
+{
+  dispatchTable.setTag(OpenProtocol::CMDSet::Broadcast::broadcast[0],
+                       OpenProtocol::CMDSet::Broadcast::broadcast[1],
+                       PUSH_BROADCAST);
+  dispatchTable.setTag(OpenProtocol::CMDSet::Broadcast::subscribe[0],
+                       OpenProtocol::CMDSet::Broadcast::subscribe[1],
+                       PUSH_SUBSCRIBE);
+  dispatchTable.setTag(OpenProtocol::CMDSet::Broadcast::fromMobile[0],
+                       OpenProtocol::CMDSet::Broadcast::fromMobile[1],
+                       PUSH_MOBILE);
+  dispatchTable.setTag(OpenProtocol::CMDSet::Broadcast::mission[0],
+                       OpenProtocol::CMDSet::Broadcast::mission[1],
+                       PUSH_MISSION);
+  dispatchTable.setTag(OpenProtocol::CMDSet::Broadcast::waypoint[0],
+                       OpenProtocol::CMDSet::Broadcast::waypoint[1],
+                       PUSH_WAYPOINT);
+
+  //! Blocking calls whose ACK has its own storage, the others use
+  //! ackErrorCode
+  dispatchTable.setAckSlot(OpenProtocol::CMDSet::Mission::waypointAddPoint[0],
+                           OpenProtocol::CMDSet::Mission::waypointAddPoint[1],
+                           &waypointAddPointACK);
+  dispatchTable.setAckSlot(OpenProtocol::CMDSet::Mission::waypointDownload[0],
+                           OpenProtocol::CMDSet::Mission::waypointDownload[1],
+                           &waypointInitACK);
+  dispatchTable.setAckSlot(
+    OpenProtocol::CMDSet::Mission::waypointIndexDownload[0],
+    OpenProtocol::CMDSet::Mission::waypointIndexDownload[1],
+    &waypointIndexACK);
+  dispatchTable.setAckSlot(OpenProtocol::CMDSet::Mission::hotpointStart[0],
+                           OpenProtocol::CMDSet::Mission::hotpointStart[1],
+                           &hotpointStartACK);
+  dispatchTable.setAckSlot(OpenProtocol::CMDSet::Mission::hotpointDownload[0],
+                           OpenProtocol::CMDSet::Mission::hotpointDownload[1],
+                           &hotpointReadACK);
+  dispatchTable.setAckSlot(OpenProtocol::CMDSet::Activation::getVersion[0],
+                           OpenProtocol::CMDSet::Activation::getVersion[1],
+                           &rawVersionACK);
+  dispatchTable.setAckSlot(OpenProtocol::CMDSet::MFIO::get[0],
+                           OpenProtocol::CMDSet::MFIO::get[1], &mfioGetACK);
+}
+
+int
+Vehicle::subscribePushData(uint8_t cmdSet, uint8_t cmdId,
+                           VehicleCallBack callback, UserData userData,
+                           DispatchTable::DropPolicy policy, int queueDepth)
+{
+  VehicleCallBackHandler handler;
+  handler.callback = callback;
+  handler.userData = userData;
+  return dispatchTable.subscribe(cmdSet, cmdId, handler, policy, queueDepth);
+}
+
+bool
+Vehicle::unsubscribePushData(int id)
+{
+  return dispatchTable.unsubscribe(id);
+}
+
+DispatchTable*
+Vehicle::getDispatchTable()
+{
+  return &dispatchTable;
+}
+
+void
+Vehicle::deferCallback(VehicleCallBackHandler handler,
+                       RecvContainer&         recvFrame)
+{
+  if (!threadSupported)
+  {
+    invokeUserCallback(handler, recvFrame, false);
+    return;
+  }
+
+  protocolLayer->getThreadHandle()->lockNonBlockCBAck();
+  circularBuffer->cbPush(circularBuffer, handler, recvFrame);
+  protocolLayer->getThreadHandle()->freeNonBlockCBAck();
+}
+
+bool
+Vehicle::runSubscriber(UserData userData)
+{
+  SubscriberLane*           lane    = static_cast<SubscriberLane*>(userData);
+  Vehicle*                  vehicle = lane->vehicle;
+  DispatchTable::Subscriber subscriber;
+  RecvContainer             frame;
+
+  if (!vehicle->dispatchTable.dequeue(lane->index, subscriber, frame))
+  {
+    return false;
+  }
+  vehicle->invokeUserCallback(subscriber.handler, frame, false);
+  vehicle->dispatchTable.countDelivered(subscriber.id);
+  //! One frame per turn, so the other lanes get theirs
+  return true;
+}
+
+PeriodicScheduler*
+Vehicle::getScheduler()
+{
+  if (scheduler == NULL)
+  {
+#if defined(__linux__) && !defined(QT) && !defined(STM32)
+    scheduler = new (std::nothrow)
+      PosixPeriodicScheduler(protocolLayer->getDriver());
+#else
+    scheduler =
+      new (std::nothrow) PeriodicScheduler(protocolLayer->getDriver());
+#endif
+    if (scheduler == NULL)
+    {
+      DERROR("Failed to allocate the periodic scheduler\n");
+    }
+  }
+  return scheduler;
+}
+
+SetpointMailbox*
+Vehicle::getSetpoints()
+{
+  return &setpoints;
+}
+
+LinkQuality*
+Vehicle::getLinkQuality()
+{
+  return &linkQuality;
+}
+
+int
+Vehicle::sendBurst(const CommandBurst& burst, BurstResult* result)
+{
+  return protocolLayer->sendBurst(burst.getCommands(), burst.size(), result);
+}
+
+void
+Vehicle::writeMetrics(MetricsWriter& writer)
+{
+  protocolLayer->writeMetrics(writer);
+  callbackProfiler.writeMetrics(writer);
+  if (scheduler)
+  {
+    scheduler->writeMetrics(writer);
+  }
+  setpoints.writeMetrics(writer);
+  linkQuality.writeMetrics(writer);
+  if (subscribe)
+  {
+    subscribe->writeMetrics(writer);
+  }
+  if (broadcast)
+  {
+    broadcast->writeMetrics(writer);
+  }
+}
+
+bool
+Vehicle::exportMetrics(const char* path)
+{
+  MetricsWriter writer;
+  if (!writer.open(path))
+  {
+    return false;
+  }
+  writeMetrics(writer);
+  return writer.commit();
+}
+
 int
 Vehicle::callbackIdIndex()
 {
@@ -1301,125 +1646,147 @@ void
 Vehicle::PushDataHandler(void* eventData)
 {
   RecvContainer* pushDataEntry = (RecvContainer*)eventData;
+  uint8_t        cmdSet        = pushDataEntry->recvInfo.cmd_set;
+  uint8_t        cmdId         = pushDataEntry->recvInfo.cmd_id;
+  uint8_t        tag           = dispatchTable.getTag(cmdSet, cmdId);
 
-  const uint8_t cmd[] = { pushDataEntry->recvInfo.cmd_set,
-                          pushDataEntry->recvInfo.cmd_id };
-
-  if (memcmp(cmd, OpenProtocol::CMDSet::Broadcast::broadcast, sizeof(cmd)) == 0)
+  //! The SDK's own handler first, then the subscribers
+  switch (tag)
   {
-    if (broadcast)
-    {
-      if (broadcast->unpackHandler.callback)
+    case PUSH_BROADCAST:
+      if (broadcast && broadcast->unpackHandler.callback)
       {
         broadcast->unpackHandler.callback(this, *(pushDataEntry),
                                           broadcast->unpackHandler.userData);
       }
-    }
-  }
-  else if (memcmp(cmd, OpenProtocol::CMDSet::Broadcast::subscribe,
-                  sizeof(cmd)) == 0)
-  {
-    if (subscribe)
-    {
-      DDEBUG("Decode callback subscribe");
-      if (subscribe->subscriptionDataDecodeHandler.callback)
+      break;
+    case PUSH_SUBSCRIBE:
+      if (subscribe && subscribe->subscriptionDataDecodeHandler.callback)
       {
+        DDEBUG("Decode callback subscribe");
         subscribe->subscriptionDataDecodeHandler.callback(
           this, *(pushDataEntry),
           subscribe->subscriptionDataDecodeHandler.userData);
       }
-    }
+      break;
+    case PUSH_MOBILE:
+      if (moc && moc->fromMSDKHandler.callback)
+      {
+        DDEBUG("Received data from mobile\n");
+        invokeUserCallback(moc->fromMSDKHandler, *(pushDataEntry));
+      }
+      break;
+    case PUSH_MISSION:
+      missionPushData(pushDataEntry);
+      break;
+    case PUSH_WAYPOINT:
+      if (missionManager && missionManager->wpMission)
+      {
+        //! @todo add waypoint session decode
+        if (missionManager->wpMission->wayPointEventCallback.callback)
+        {
+          invokeUserCallback(missionManager->wpMission->wayPointEventCallback,
+                             *(pushDataEntry));
+        }
+        else
+        {
+          DDEBUG("WayPoint DATA");
+        }
+      }
+      break;
+    default:
+      break;
   }
-  else if (memcmp(cmd, OpenProtocol::CMDSet::Broadcast::fromMobile,
-                  sizeof(cmd)) == 0)
+
+  DispatchTable::Subscriber subscribers[DispatchTable::MAX_SUBSCRIBERS];
+  int count = dispatchTable.lookup(cmdSet, cmdId, subscribers,
+                                   DispatchTable::MAX_SUBSCRIBERS);
+  if (tag == PUSH_NONE && count == 0)
+  {
+    DDEBUG("Received Unknown PushData\n");
+    return;
+  }
+
+  for (int i = 0; i < count; ++i)
   {
-    if (moc)
+    DispatchTable::Subscriber& s    = subscribers[i];
+    SubscriberLane&            lane =
+      subscriberLanes[DispatchTable::getIndex(s.id)];
+
+    if (s.policy != DispatchTable::DISPATCH_INLINE && workers &&
+        lane.lane < 0)
     {
-      DDEBUG("Received data from mobile\n");
-      if (moc->fromMSDKHandler.callback)
-      {
-        moc->fromMSDKHandler.callback(this, *(pushDataEntry),
-                                      moc->fromMSDKHandler.userData);
-      }
+      lane.lane = workers->addLane(runSubscriber, (UserData)&lane);
+    }
+    if (s.policy == DispatchTable::DISPATCH_INLINE || lane.lane < 0)
+    {
+      invokeUserCallback(s.handler, *(pushDataEntry));
+      dispatchTable.countDelivered(s.id);
+      continue;
+    }
+
+    if (!dispatchTable.enqueue(s.id, *(pushDataEntry)))
+    {
+      //! Queue full, or with DISPATCH_LATEST the waiting frame was replaced
+      dispatchTable.countDropped(s.id);
     }
+    workers->post(lane.lane);
   }
-  else if (memcmp(cmd, OpenProtocol::CMDSet::Broadcast::mission, sizeof(cmd)) ==
-           0)
+}
+
+void
+Vehicle::missionPushData(RecvContainer* pushDataEntry)
+{
+  if (missionManager)
   {
-    if (missionManager)
+    if (missionCallback.callback)
     {
-      if (missionCallback.callback)
-      {
-        missionCallback.callback(this, *(pushDataEntry),
-                                 missionCallback.userData);
-      }
-      else
+      invokeUserCallback(missionCallback, *(pushDataEntry));
+    }
+    else
+    {
+      switch (pushDataEntry->recvData.missionACK)
       {
-        switch (pushDataEntry->recvData.missionACK)
-        {
-          case MISSION_MODE_A:
-            break;
-          case MISSION_WAYPOINT:
-            if (missionManager->wpMission)
+        case MISSION_MODE_A:
+          break;
+        case MISSION_WAYPOINT:
+          if (missionManager->wpMission)
+          {
+            if (wayPointData)
             {
-              if (wayPointData)
-              {
-                if (missionManager->wpMission->wayPointCallback.callback)
-                  missionManager->wpMission->wayPointCallback.callback(
-                    this, *(pushDataEntry),
-                    missionManager->wpMission->wayPointCallback.userData);
-                else
-                  DDEBUG("Mode WayPoint\n");
-              }
+              if (missionManager->wpMission->wayPointCallback.callback)
+                invokeUserCallback(
+                  missionManager->wpMission->wayPointCallback,
+                  *(pushDataEntry));
+              else
+                DDEBUG("Mode WayPoint\n");
             }
-            break;
-          case MISSION_HOTPOINT:
-            if (missionManager->hpMission)
+          }
+          break;
+        case MISSION_HOTPOINT:
+          if (missionManager->hpMission)
+          {
+            if (hotPointData)
             {
-              if (hotPointData)
-              {
-                if (missionManager->hpMission->hotPointCallback.callback)
-                  missionManager->hpMission->hotPointCallback.callback(
-                    this, *(pushDataEntry),
-                    missionManager->hpMission->hotPointCallback.userData);
-                else
-                  DDEBUG("Mode HotPoint\n");
-              }
+              if (missionManager->hpMission->hotPointCallback.callback)
+                invokeUserCallback(
+                  missionManager->hpMission->hotPointCallback,
+                  *(pushDataEntry));
+              else
+                DDEBUG("Mode HotPoint\n");
             }
-            break;
-          case MISSION_IOC:
-            //! @todo compare IOC with other mission modes comprehensively
-            DDEBUG("Mode IOC \n");
-            break;
-          default:
-            DERROR("Unknown mission code 0x%X \n", pushDataEntry->recvData.ack);
-            break;
-        }
-      }
-    }
-  }
-  else if (memcmp(cmd, OpenProtocol::CMDSet::Broadcast::waypoint,
-                  sizeof(cmd)) == 0)
-  {
-    if (missionManager->wpMission)
-    {
-      //! @todo add waypoint session decode
-      if (missionManager->wpMission->wayPointEventCallback.callback)
-      {
-        missionManager->wpMission->wayPointEventCallback.callback(
-          this, *(pushDataEntry),
-          missionManager->wpMission->wayPointEventCallback.userData);
-      }
-      else
-      {
-        DDEBUG("WayPoint DATA");
+          }
+          break;
+        case MISSION_IOC:
+          //! @todo compare IOC with other mission modes comprehensively
+          DDEBUG("Mode IOC \n");
+          break;
+        default:
+          DERROR("Unknown mission code 0x%X \n", pushDataEntry->recvData.ack);
+          break;
       }
     }
   }
-  else
-  {
-    DDEBUG("Received Unknown PushData\n");
-  }
 }
 
 void*
@@ -1431,41 +1798,8 @@ Vehicle::waitForACK(const uint8_t (&cmd)[OpenProtocol::MAX_CMD_ARRAY_SIZE],
   protocolLayer->getThreadHandle()->lockACK();
   protocolLayer->getThreadHandle()->wait(timeout);
 
-  if (memcmp(cmd, OpenProtocol::CMDSet::Mission::waypointAddPoint,
-             sizeof(cmd)) == 0)
-  {
-    pACK = static_cast<void*>(&this->waypointAddPointACK);
-  }
-  else if (memcmp(cmd, OpenProtocol::CMDSet::Mission::waypointDownload,
-                  sizeof(cmd)) == 0)
-  {
-    pACK = static_cast<void*>(&this->waypointInitACK);
-  }
-  else if (memcmp(cmd, OpenProtocol::CMDSet::Mission::waypointIndexDownload,
-                  sizeof(cmd)) == 0)
-  {
-    pACK = static_cast<void*>(&this->waypointIndexACK);
-  }
-  else if (memcmp(cmd, OpenProtocol::CMDSet::Mission::hotpointStart,
-                  sizeof(cmd)) == 0)
-  {
-    pACK = static_cast<void*>(&this->hotpointStartACK);
-  }
-  else if (memcmp(cmd, OpenProtocol::CMDSet::Mission::hotpointDownload,
-		  sizeof(cmd)) == 0)
-  {
-    pACK = static_cast<void*>(&this->hotpointReadACK);
-  }
-  else if (memcmp(cmd, OpenProtocol::CMDSet::Activation::getVersion,
-                  sizeof(cmd)) == 0)
-  {
-    pACK = static_cast<void*>(&this->rawVersionACK);
-  }
-  else if (memcmp(cmd, OpenProtocol::CMDSet::MFIO::get, sizeof(cmd)) == 0)
-  {
-    pACK = static_cast<void*>(&this->mfioGetACK);
-  }
-  else
+  pACK = dispatchTable.getAckSlot(cmd[0], cmd[1]);
+  if (pACK == 0)
   {
     pACK = static_cast<void*>(&this->ackErrorCode);
   }
@@ -1475,6 +1809,55 @@ Vehicle::waitForACK(const uint8_t (&cmd)[OpenProtocol::MAX_CMD_ARRAY_SIZE],
   return pACK;
 }
 
+void
+Vehicle::expectACKFrame(uint8_t cmdSet, uint8_t cmdId)
+{
+  typedACK.store((uint16_t)(cmdSet << 8 | cmdId));
+  protocolLayer->getThreadHandle()->lockACK();
+  protocolLayer->getThreadHandle()->lockFrame();
+  lastReceivedFrame.recvInfo.cmd_set = 0xFF;
+  lastReceivedFrame.recvInfo.cmd_id  = 0xFF;
+  protocolLayer->getThreadHandle()->freeFrame();
+  protocolLayer->getThreadHandle()->freeACK();
+}
+
+bool
+Vehicle::waitForACKFrame(uint8_t cmdSet, uint8_t cmdId, int timeout,
+                         RecvContainer& frame)
+{
+  HardDriver* driver   = protocolLayer->getDriver();
+  time_ms     deadline = driver->getTimeStamp() + (time_ms)timeout * 1000;
+  bool        received;
+
+  protocolLayer->getThreadHandle()->lockACK();
+  for (;;)
+  {
+    frame    = getLastReceivedFrame();
+    received = frame.recvInfo.cmd_set == cmdSet &&
+               frame.recvInfo.cmd_id == cmdId;
+    time_ms now = driver->getTimeStamp();
+    if (received || now >= deadline)
+    {
+      break;
+    }
+    //! Woken by any blocking ACK; wait() takes whole seconds
+    protocolLayer->getThreadHandle()->wait(
+      (int)((deadline - now + 999) / 1000));
+  }
+  protocolLayer->getThreadHandle()->freeACK();
+
+  uint16_t expected = (uint16_t)(cmdSet << 8 | cmdId);
+  typedACK.compareExchange(expected, NO_TYPED_ACK);
+
+  if (!received)
+  {
+    memset(&frame, 0, sizeof(frame));
+    frame.recvInfo.cmd_set = cmdSet;
+    frame.recvInfo.cmd_id  = cmdId;
+  }
+  return received;
+}
+
 void
 Vehicle::obtainCtrlAuthority(VehicleCallBack callback, UserData userData)
 {
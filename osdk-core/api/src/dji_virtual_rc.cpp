@@ -17,7 +17,8 @@ using namespace DJI::OSDK;
 
 VirtualRC::VirtualRC(Vehicle* vehicle)
 {
-  this->vehicle = vehicle;
+  this->vehicle     = vehicle;
+  dataFrame.length = 0;
   resetVRCData();
 }
 
@@ -36,9 +37,14 @@ void
 VirtualRC::sendData(VirtualRCData data)
 {
   vrcData = data;
-  vehicle->protocolLayer->send(0, DJI::OSDK::encrypt,
-                               OpenProtocol::CMDSet::VirtualRC::data, &vrcData,
-                               sizeof(vrcData));
+  if (vehicle->getSetpoints()->post(SetpointMailbox::SETPOINT_VIRTUAL_RC,
+                                    &vrcData, sizeof(vrcData)))
+  {
+    return;
+  }
+  vehicle->protocolLayer->sendPrepared(&dataFrame, DJI::OSDK::encrypt,
+                                       OpenProtocol::CMDSet::VirtualRC::data,
+                                       &vrcData, sizeof(vrcData));
 }
 
 void
@@ -66,6 +72,11 @@ void
 VirtualRC::neutralVRCSticks()
 {
   resetVRCData();
+  if (vehicle->getSetpoints()->post(SetpointMailbox::SETPOINT_VIRTUAL_RC,
+                                    &vrcData, sizeof(vrcData)))
+  {
+    return;
+  }
   vehicle->protocolLayer->send(0, DJI::OSDK::encrypt,
                                OpenProtocol::CMDSet::VirtualRC::data, &vrcData,
                                sizeof(vrcData));
@@ -0,0 +1,122 @@
+/** @file dji_worker_pool.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Worker lanes for consumers that must not hold up each other
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_worker_pool.hpp"
+#include "dji_log.hpp"
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+WorkerPool::WorkerPool()
+{
+  for (int i = 0; i < MAX_LANES; ++i)
+  {
+    lanes[i].callback = 0;
+    lanes[i].userData = 0;
+    lanes[i].ready.storeRelaxed(0);
+    lanes[i].running.storeRelaxed(0);
+  }
+  count.storeRelaxed(0);
+  cursor.storeRelaxed(0);
+}
+
+WorkerPool::~WorkerPool()
+{
+}
+
+int
+WorkerPool::addLane(LaneCallBack callback, UserData userData)
+{
+  if (callback == 0)
+  {
+    return -1;
+  }
+  //! Scans only run lanes that were posted, which happens after this returns
+  int id = count.add(1);
+  if (id >= MAX_LANES)
+  {
+    DERROR("No free worker lane\n");
+    return -1;
+  }
+  lanes[id].callback = callback;
+  lanes[id].userData = userData;
+  return id;
+}
+
+void
+WorkerPool::post(int lane)
+{
+  if (lane < 0 || lane >= MAX_LANES)
+  {
+    return;
+  }
+  lanes[lane].ready.store(1);
+  wake();
+}
+
+bool
+WorkerPool::runOne()
+{
+  int n = count.load();
+  if (n > MAX_LANES)
+  {
+    n = MAX_LANES;
+  }
+  if (n == 0)
+  {
+    return false;
+  }
+
+  //! Start each scan one lane further, so every ready lane gets its turn
+  uint32_t start = cursor.add(1);
+  for (int k = 0; k < n; ++k)
+  {
+    Lane& lane = lanes[(start + k) % n];
+    if (lane.ready.load() == 0)
+    {
+      continue;
+    }
+    uint8_t expected = 0;
+    if (!lane.running.compareExchange(expected, 1))
+    {
+      continue;
+    }
+    //! A post() from here on marks the lane ready again
+    if (lane.ready.exchange(0) == 0)
+    {
+      lane.running.store(0);
+      continue;
+    }
+    if (lane.callback(lane.userData))
+    {
+      lane.ready.store(1);
+    }
+    lane.running.store(0);
+    return true;
+  }
+  return false;
+}
+
+bool
+WorkerPool::start(int threads)
+{
+  return false;
+}
+
+void
+WorkerPool::stop()
+{
+}
+
+void
+WorkerPool::wake()
+{
+}
@@ -22,6 +22,31 @@ namespace DJI
 {
 namespace OSDK
 {
+
+//! UART line error counters, as far as the platform exposes them
+typedef struct SerialErrorStats
+{
+  uint32_t overrun;       //! UART FIFO overruns
+  uint32_t bufferOverrun; //! driver buffer overruns
+  uint32_t frame;
+  uint32_t parity;
+  uint32_t brk;
+} SerialErrorStats;
+
+//! Transmit queue of drivers that write from their own thread
+typedef struct SerialTxStats
+{
+  uint32_t queued;     //! bytes waiting now
+  uint32_t highWater;  //! most bytes ever waiting
+  uint32_t capacity;
+  uint32_t frames;     //! frames accepted by send()
+  uint32_t dropped;    //! frames refused because the queue was full
+  uint32_t writes;     //! write()/writev() calls
+  uint32_t wouldBlock; //! writes that hit a full kernel buffer
+  uint32_t gaps;       //! writes that found the line idle, bytes waiting
+  uint32_t gapMaxNs;   //! longest of those idle times
+} SerialTxStats;
+
 class HardDriver
 {
 public:
@@ -44,6 +69,11 @@ public:
    *  The difference between the return value of the function call two times
    *  is the excat time between them in msec.
    *
+   *  time_us getTimeStampUs();
+   *  @brief same clock in usec, for statistics. Not pure virtual: the
+   *  default just scales getTimeStamp(), override if the platform has a
+   *  finer clock.
+   *
    *  size_t send(const uint8_t *buf, size_t len);
    *  @brief return sent data length.
    *
@@ -76,6 +106,10 @@ public:
 public:
   virtual void    init()         = 0;
   virtual time_ms getTimeStamp() = 0;
+  virtual time_us getTimeStampUs()
+  {
+    return getTimeStamp() * 1000;
+  }
   virtual size_t send(const uint8_t* buf, size_t len) = 0;
   virtual size_t readall(uint8_t* buf, size_t maxlen) = 0;
   virtual bool getDeviceStatus()
@@ -83,6 +117,18 @@ public:
     return true;
   }
 
+  //! @return false if the platform cannot report line errors
+  virtual bool getSerialErrorStats(SerialErrorStats&)
+  {
+    return false;
+  }
+
+  //! @return false if send() writes synchronously
+  virtual bool getSerialTxStats(SerialTxStats&)
+  {
+    return false;
+  }
+
 public:
   //! @todo move to Logging class
   virtual void displayLog(const char* buf = 0);
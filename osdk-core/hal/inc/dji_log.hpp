@@ -29,9 +29,44 @@
 #define ERROR 1
 #define DEBUG 0
 
-#define DSTATUS DLOG(STATUS)
-#define DERROR DLOG(ERROR)
-#define DDEBUG DLOG(DEBUG)
+//! @note log levels are resolved at compile time: a level defined as 0 turns
+//! its macro into dead code, so neither the arguments nor the call survive.
+//! Override on the command line, e.g. -DOSDK_LOG_DEBUG=1. STATUS, ERROR and
+//! DEBUG above are not used for this since platform headers define them
+//! too, e.g. <wingdi.h> has ERROR 0.
+#ifndef OSDK_LOG_STATUS
+#define OSDK_LOG_STATUS 1
+#endif
+#ifndef OSDK_LOG_ERROR
+#define OSDK_LOG_ERROR 1
+#endif
+#ifndef OSDK_LOG_DEBUG
+#define OSDK_LOG_DEBUG 0
+#endif
+
+#define DLOG_LEVEL(_level_, _title_)                                           \
+  DJI::OSDK::Log::instance()                                                   \
+    .title((_level_), _title_, __func__, __LINE__)                             \
+    .print
+#define DLOG_DISABLED(_title_) while (0) DLOG_LEVEL(0, _title_)
+
+#if OSDK_LOG_STATUS
+#define DSTATUS DLOG_LEVEL(OSDK_LOG_STATUS, "STATUS")
+#else
+#define DSTATUS DLOG_DISABLED("STATUS")
+#endif
+
+#if OSDK_LOG_ERROR
+#define DERROR DLOG_LEVEL(OSDK_LOG_ERROR, "ERROR")
+#else
+#define DERROR DLOG_DISABLED("ERROR")
+#endif
+
+#if OSDK_LOG_DEBUG
+#define DDEBUG DLOG_LEVEL(OSDK_LOG_DEBUG, "DEBUG")
+#else
+#define DDEBUG DLOG_DISABLED("DEBUG")
+#endif
 
 namespace DJI
 {
@@ -48,7 +83,8 @@ public:
 
   //! @note if title level is 0, this log would not be print at all
   //! this feature is used for dynamical/statical optional log output
-  Log& title(int level, const char* prefix, const char* func, int line);
+  virtual Log& title(int level, const char* prefix, const char* func,
+                     int line);
 
   Log& print();
 
@@ -73,6 +109,12 @@ public:
   Log& operator<<(int8_t c);
   Log& operator<<(const char* str);
 
+protected:
+  //! @note replace the process-wide logger, e.g. by an asynchronous one.
+  //! Call before any other thread logs; the previous instance is leaked
+  //! on purpose since references to it may still be held.
+  static void install(Log* log);
+
 private:
   Mutex* mutex;
   bool   vaild;
@@ -29,6 +29,9 @@ public:
   void freeMemory(MMU_Tab* mmu_tab);
   MMU_Tab* allocMemory(uint16_t size);
 
+  //! Largest number of bytes in use at once since setupMMU()
+  uint16_t getHighWaterMark() const;
+
 public:
   static const int MMU_TABLE_NUM = 32;
   static const int MEMORY_SIZE   = 1024;
@@ -36,6 +39,8 @@ public:
 private:
   MMU_Tab memoryTable[MMU_TABLE_NUM];
   uint8_t memory[MEMORY_SIZE];
+
+  uint16_t highWaterMark;
 };
 
 } // OSDK
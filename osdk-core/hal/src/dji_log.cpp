@@ -33,6 +33,15 @@ Log::~Log()
 {
 }
 
+void
+Log::install(Log* log)
+{
+  if (log)
+  {
+    Singleton<Log>::singleInstance = log;
+  }
+}
+
 Log&
 Log::title(int level, const char* prefix, const char* func, int line)
 {
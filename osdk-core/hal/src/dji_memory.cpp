@@ -21,6 +21,7 @@
 using namespace DJI::OSDK;
 
 MMU::MMU()
+  : highWaterMark(0)
 {
 }
 
@@ -28,6 +29,7 @@ void
 MMU::setupMMU()
 {
   uint32_t i;
+  highWaterMark            = 0;
   memoryTable[0].tabIndex  = 0;
   memoryTable[0].usageFlag = 1;
   memoryTable[0].pmem      = memory;
@@ -81,6 +83,10 @@ MMU::allocMemory(uint16_t size)
   if (MEMORY_SIZE < (mem_used + size))
     return (MMU_Tab*)0;
 
+  //! @note counted as soon as the space is known to fit
+  if (mem_used + size > highWaterMark)
+    highWaterMark = mem_used + size;
+
   if (mem_used == 0)
   {
     memoryTable[1].pmem      = memoryTable[0].pmem;
@@ -169,3 +175,9 @@ MMU::allocMemory(uint16_t size)
 
   return (MMU_Tab*)0;
 }
+
+uint16_t
+MMU::getHighWaterMark() const
+{
+  return highWaterMark;
+}
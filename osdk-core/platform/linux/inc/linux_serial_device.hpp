@@ -20,6 +20,8 @@
 
 #include <cstring>
 #include <fcntl.h>
+#include <pthread.h>
+#include <sys/select.h>
 #include <termios.h>
 #include <unistd.h>
 
@@ -33,11 +35,24 @@ namespace OSDK
 
 /*! @brief POSIX-Compatible Serial Driver for *NIX platforms
  *
+ * @details send() never blocks on the UART. The port is opened a second
+ * time with O_NONBLOCK for writing; a frame is written right away when
+ * nothing is queued, and whatever the kernel does not take goes to a
+ * TX_RING_SIZE byte ring. A writer thread drains the ring with writev(),
+ * so frames queued meanwhile share one call, and waits with poll(POLLOUT)
+ * while the kernel buffer is full. A frame that does not fit the ring is
+ * dropped and counted.
+ *
+ * The writer keeps the time the line should finish the bytes written so
+ * far, at the configured baud rate. A write that comes later than that
+ * while bytes were waiting in the ring left the line idle between frames;
+ * the longest such gap is reported in SerialTxStats::gapMaxNs.
  */
 class LinuxSerialDevice : public HardDriver
 {
 public:
-  static const int BUFFER_SIZE = 2048;
+  static const int BUFFER_SIZE  = 2048;
+  static const int TX_RING_SIZE = 8192;
 
 public:
   LinuxSerialDevice(const char* device, uint32_t baudrate);
@@ -45,6 +60,9 @@ public:
 
   void init();
   bool getDeviceStatus();
+  //! @note read via TIOCGICOUNT, not every USB-serial driver supports it
+  bool getSerialErrorStats(SerialErrorStats& stats);
+  bool getSerialTxStats(SerialTxStats& stats);
 
   void setBaudrate(uint32_t baudrate);
   void setDevice(const char* device);
@@ -65,6 +83,8 @@ public:
 
   //! Implemented here because ..
   DJI::OSDK::time_ms getTimeStamp();
+  //! CLOCK_MONOTONIC
+  DJI::OSDK::time_us getTimeStampUs();
 
   void delay_nms(uint16_t time)
   {
@@ -90,6 +110,28 @@ private:
   int _serialRead(uint8_t* buf, int len);
 
   int _checkBaudRate(uint8_t (&buf)[BUFFER_SIZE]);
+
+  //! Transmit ring, guarded by txLock
+  int             m_tx_fd;
+  bool            txNonBlocking;
+  bool            txRunning;
+  pthread_t       txThread;
+  pthread_mutex_t txLock;
+  pthread_cond_t  txReady;
+  uint8_t         txRing[TX_RING_SIZE];
+  uint32_t        txHead; //! next byte to write out
+  uint32_t        txSize;
+  SerialTxStats   txStats;
+  uint64_t        txLineIdleNs; //! line done with the bytes written so far
+  uint64_t        txWaitingNs;  //! ring went non-empty
+
+  bool _txStart(const char* dev);
+  void _txStop();
+  static void* tx_call(void* param);
+  void _txDrain();
+  //! Account a write of len bytes at now, under txLock
+  void _txWritten(uint64_t now, size_t len);
+  uint64_t _monotonicNs();
 };
 }
 }
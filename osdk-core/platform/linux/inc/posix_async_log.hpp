@@ -0,0 +1,110 @@
+/*! @file posix_async_log.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Asynchronous binary logger for DJI Onboard SDK Linux/*NIX platforms
+ *
+ *  @copyright
+ *  2017 DJI. All rights reserved.
+ * */
+
+#ifndef POSIXASYNCLOG_H
+#define POSIXASYNCLOG_H
+
+#include "dji_log.hpp"
+
+#include <atomic>
+#include <pthread.h>
+#include <stdint.h>
+
+namespace DJI
+{
+namespace OSDK
+{
+
+/*! @brief Low-overhead drop-in backend for DLOG/DSTATUS/DERROR
+ *
+ * @details The calling thread only records the format pointer and the raw
+ * arguments into its own lock-free ring; formatting and stdout I/O happen
+ * on a background thread. When a ring is full the record is dropped and
+ * counted instead of blocking the caller, so the read and callback threads
+ * never stall on the terminal.
+ *
+ * Call PosixAsyncLog::install() once at the top of main(), before the
+ * Vehicle is created; the Linux samples do it in setupOSDK().
+ *
+ * @note %s arguments are copied (truncated to fit the record); %n is not
+ * supported. Records with more than MAX_ARGS arguments are formatted on
+ * the calling thread instead.
+ */
+class PosixAsyncLog : public Log
+{
+public:
+  static const int MAX_ARGS     = 8;
+  static const int STRING_SPACE = 96;
+  static const int RING_SIZE    = 256; //! records per thread, power of 2
+
+  //! @note replaces the process-wide logger, returns the installed instance
+  static PosixAsyncLog* install();
+
+  Log& title(int level, const char* prefix, const char* func, int line);
+  Log& print(const char* fmt, ...);
+
+  //! Wait (bounded) until every pending record is written out
+  void flush();
+
+  //! Number of records lost because a per-thread ring was full
+  uint32_t getDroppedCount() const;
+
+public:
+  typedef union Arg {
+    long long          i;
+    unsigned long long u;
+    double             d;
+    long double        ld;
+    const void*        p;
+  } Arg;
+
+  typedef struct Record
+  {
+    const char* fmt;
+    const char* prefix; //! NULL for records continuing the previous line
+    const char* func;
+    int         level;
+    int         line;
+    uint8_t     argc;
+    uint8_t     preformatted;
+    uint8_t     strUsed;
+    Arg         args[MAX_ARGS];
+    char        strings[STRING_SPACE];
+  } Record;
+
+  class ThreadRing;
+
+private:
+  PosixAsyncLog();
+  ~PosixAsyncLog();
+
+  ThreadRing* localRing();
+  bool        drainOnce();
+  void        write(const Record& rec);
+
+  static void* drain_call(void* param);
+  static void  atExit();
+  static void  releaseRing(void* ring);
+
+private:
+  pthread_t             threadID;
+  pthread_mutex_t       ringsLock;
+  pthread_key_t         ringKey;
+  ThreadRing*           rings;
+  std::atomic<uint32_t> dropped;
+  uint32_t              droppedReported;
+  std::atomic<bool>     running;
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // POSIXASYNCLOG_H
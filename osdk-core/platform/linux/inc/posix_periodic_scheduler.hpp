@@ -0,0 +1,61 @@
+/*! @file posix_periodic_scheduler.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Real-time thread for the periodic scheduler on Linux/*NIX platforms
+ *
+ *  @copyright
+ *  2017 DJI. All rights reserved.
+ * */
+
+#ifndef POSIXPERIODICSCHEDULER_H
+#define POSIXPERIODICSCHEDULER_H
+
+#include "dji_periodic_scheduler.hpp"
+
+#include <atomic>
+#include <pthread.h>
+
+namespace DJI
+{
+namespace OSDK
+{
+
+/*! @brief Runs the periodic jobs from a dedicated thread
+ *
+ * @details The thread sleeps with clock_nanosleep(TIMER_ABSTIME) until the
+ * earliest deadline, so sleeping never adds up error the way a usleep()
+ * loop does. With no job due it wakes every IDLE_WAIT to pick up new jobs
+ * and stop requests.
+ *
+ * SCHED_FIFO and mlockall() need CAP_SYS_NICE and CAP_IPC_LOCK (or root);
+ * without them start() warns and keeps the default policy.
+ */
+class PosixPeriodicScheduler : public PeriodicScheduler
+{
+public:
+  static const time_us IDLE_WAIT = 10000;
+
+  PosixPeriodicScheduler(HardDriver* driver);
+  ~PosixPeriodicScheduler();
+
+  bool start(const RealTimeConfig& config);
+  void stop();
+
+protected:
+  bool waitForRun();
+
+private:
+  static void* run_call(void* param);
+  void run();
+  void sleepUntil(time_us deadline);
+
+  pthread_t         threadID;
+  std::atomic<bool> running;
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // POSIXPERIODICSCHEDULER_H
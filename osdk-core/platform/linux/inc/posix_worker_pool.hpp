@@ -0,0 +1,60 @@
+/*! @file posix_worker_pool.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Worker threads for the worker lanes on Linux/*NIX platforms
+ *
+ *  @copyright
+ *  2017 DJI. All rights reserved.
+ * */
+
+#ifndef POSIXWORKERPOOL_H
+#define POSIXWORKERPOOL_H
+
+#include "dji_worker_pool.hpp"
+
+#include <atomic>
+#include <pthread.h>
+
+namespace DJI
+{
+namespace OSDK
+{
+
+/*! @brief Runs the worker lanes on a few threads
+ *
+ * @details A worker with no ready lane sleeps on a condition variable
+ * until a post(), waking every IDLE_WAIT anyway to notice stop().
+ */
+class PosixWorkerPool : public WorkerPool
+{
+public:
+  static const int     MAX_THREADS = 8;
+  static const time_us IDLE_WAIT   = 10000;
+
+  PosixWorkerPool();
+  ~PosixWorkerPool();
+
+  bool start(int threads);
+  void stop();
+
+protected:
+  void wake();
+
+private:
+  static void* run_call(void* param);
+  void run();
+
+  pthread_t         threadIDs[MAX_THREADS];
+  int               threadCount;
+  pthread_mutex_t   idleLock;
+  pthread_cond_t    idleCond;
+  uint32_t          wakeups; //! under idleLock
+  std::atomic<bool> running;
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // POSIXWORKERPOOL_H
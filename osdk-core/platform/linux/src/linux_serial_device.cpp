@@ -14,7 +14,12 @@
 
 #include "linux_serial_device.hpp"
 #include <algorithm>
+#include <errno.h>
 #include <iterator>
+#include <linux/serial.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
 
 using namespace DJI::OSDK;
 
@@ -22,13 +27,28 @@ using namespace DJI::OSDK;
 
 LinuxSerialDevice::LinuxSerialDevice(const char* device, uint32_t baudrate)
 {
-  m_device   = device;
-  m_baudrate = baudrate;
+  m_device      = device;
+  m_baudrate    = baudrate;
+  m_serial_fd   = -1;
+  m_tx_fd       = -1;
+  txNonBlocking = false;
+  txRunning     = false;
+  txHead        = 0;
+  txSize        = 0;
+  txLineIdleNs  = 0;
+  txWaitingNs   = 0;
+  memset(&txStats, 0, sizeof(txStats));
+  txStats.capacity = TX_RING_SIZE;
+  pthread_mutex_init(&txLock, NULL);
+  pthread_cond_init(&txReady, NULL);
 }
 
 LinuxSerialDevice::~LinuxSerialDevice()
 {
+  _txStop();
   _serialClose();
+  pthread_cond_destroy(&txReady);
+  pthread_mutex_destroy(&txLock);
 }
 
 void
@@ -55,16 +75,110 @@ LinuxSerialDevice::getDeviceStatus()
   return deviceStatus;
 }
 
+bool
+LinuxSerialDevice::getSerialErrorStats(SerialErrorStats& stats)
+{
+  struct serial_icounter_struct icount;
+  if (m_serial_fd < 0 || ioctl(m_serial_fd, TIOCGICOUNT, &icount) < 0)
+  {
+    return false;
+  }
+  stats.overrun       = icount.overrun;
+  stats.bufferOverrun = icount.buf_overrun;
+  stats.frame         = icount.frame;
+  stats.parity        = icount.parity;
+  stats.brk           = icount.brk;
+  return true;
+}
+
+//! @note Behaviour change: this used to return time(NULL), i.e. seconds,
+//! despite the msec contract. Every Protocol timeout and retransmission
+//! interval is compared against it, so on Linux they are now honoured in
+//! milliseconds as written (a 500 ms retry used to wait 500 s).
 DJI::OSDK::time_ms
 LinuxSerialDevice::getTimeStamp()
 {
-  return (uint32_t)time(NULL);
+  return getTimeStampUs() / 1000;
+}
+
+DJI::OSDK::time_us
+LinuxSerialDevice::getTimeStampUs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (DJI::OSDK::time_us)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+bool
+LinuxSerialDevice::getSerialTxStats(SerialTxStats& stats)
+{
+  pthread_mutex_lock(&txLock);
+  stats        = txStats;
+  stats.queued = txSize;
+  pthread_mutex_unlock(&txLock);
+  return txRunning;
 }
 
 size_t
 LinuxSerialDevice::send(const uint8_t* buf, size_t len)
 {
-  return _serialWrite(buf, len);
+  if (!txRunning)
+  {
+    return _serialWrite(buf, len);
+  }
+
+  pthread_mutex_lock(&txLock);
+  if (len > (size_t)(TX_RING_SIZE - txSize))
+  {
+    txStats.dropped++;
+    pthread_mutex_unlock(&txLock);
+    return 0;
+  }
+  txStats.frames++;
+
+  //! Nothing queued: try the kernel buffer directly, no thread hand-off
+  uint64_t now  = _monotonicNs();
+  size_t   done = 0;
+  if (txSize == 0 && txNonBlocking)
+  {
+    ssize_t ret = write(m_tx_fd, buf, len);
+    txStats.writes++;
+    if (ret > 0)
+    {
+      done = ret;
+      _txWritten(now, done);
+    }
+    else if (ret < 0 && errno == EAGAIN)
+    {
+      txStats.wouldBlock++;
+    }
+    else if (ret < 0 && errno != EINTR)
+    {
+      pthread_mutex_unlock(&txLock);
+      return (size_t)-1;
+    }
+  }
+
+  size_t rest = len - done;
+  if (rest > 0)
+  {
+    if (txSize == 0)
+    {
+      txWaitingNs = now;
+    }
+    uint32_t tail  = (txHead + txSize) % TX_RING_SIZE;
+    size_t   first = std::min(rest, (size_t)(TX_RING_SIZE - tail));
+    memcpy(txRing + tail, buf + done, first);
+    memcpy(txRing, buf + done + first, rest - first);
+    txSize += rest;
+    if (txSize > txStats.highWater)
+    {
+      txStats.highWater = txSize;
+    }
+    pthread_cond_signal(&txReady);
+  }
+  pthread_mutex_unlock(&txLock);
+  return len;
 }
 
 size_t
@@ -303,6 +417,7 @@ LinuxSerialDevice::_serialStart(const char* dev_name, int baud_rate)
 
     FD_ZERO(&m_serial_fd_set);
     FD_SET(m_serial_fd, &m_serial_fd_set);
+    _txStart(ptemp);
     return m_serial_fd;
   }
   return -1;
@@ -314,6 +429,149 @@ LinuxSerialDevice::_serialWrite(const uint8_t* buf, int len)
   return write(m_serial_fd, buf, len);
 }
 
+bool
+LinuxSerialDevice::_txStart(const char* dev)
+{
+  //! A second open file description, so O_NONBLOCK leaves reads alone
+  m_tx_fd       = open(dev, O_WRONLY | O_NOCTTY | O_NONBLOCK);
+  txNonBlocking = m_tx_fd >= 0;
+  if (!txNonBlocking)
+  {
+    DSTATUS("Warning: cannot reopen %s for non-blocking writes, the writer "
+            "thread will block instead\n",
+            dev);
+    m_tx_fd = m_serial_fd;
+  }
+
+  txRunning = true;
+  if (pthread_create(&txThread, NULL, tx_call, this) != 0)
+  {
+    DERROR("fail to create thread for serial writes\n");
+    txRunning = false;
+    if (txNonBlocking)
+    {
+      close(m_tx_fd);
+    }
+    m_tx_fd = -1;
+    return false;
+  }
+  pthread_setname_np(txThread, "serialTx");
+  return true;
+}
+
+void
+LinuxSerialDevice::_txStop()
+{
+  pthread_mutex_lock(&txLock);
+  bool wasRunning = txRunning;
+  txRunning       = false;
+  pthread_cond_signal(&txReady);
+  pthread_mutex_unlock(&txLock);
+
+  if (wasRunning)
+  {
+    pthread_join(txThread, NULL);
+    if (txNonBlocking)
+    {
+      close(m_tx_fd);
+    }
+    m_tx_fd = -1;
+  }
+}
+
+void*
+LinuxSerialDevice::tx_call(void* param)
+{
+  static_cast<LinuxSerialDevice*>(param)->_txDrain();
+  return NULL;
+}
+
+void
+LinuxSerialDevice::_txDrain()
+{
+  pthread_mutex_lock(&txLock);
+  while (txRunning)
+  {
+    if (txSize == 0)
+    {
+      pthread_cond_wait(&txReady, &txLock);
+      continue;
+    }
+
+    //! Everything queued in one call, in two pieces if the ring wraps
+    struct iovec iov[2];
+    int          count = 1;
+    uint32_t     first = std::min(txSize, (uint32_t)(TX_RING_SIZE - txHead));
+    iov[0].iov_base    = txRing + txHead;
+    iov[0].iov_len     = first;
+    if (txSize > first)
+    {
+      iov[1].iov_base = txRing;
+      iov[1].iov_len  = txSize - first;
+      count           = 2;
+    }
+    pthread_mutex_unlock(&txLock);
+
+    uint64_t now = _monotonicNs();
+    ssize_t  ret = writev(m_tx_fd, iov, count);
+    int      err = errno;
+
+    pthread_mutex_lock(&txLock);
+    txStats.writes++;
+    if (ret > 0)
+    {
+      //! The line ran dry before these bytes, which were already waiting
+      uint64_t since = std::max(txLineIdleNs, txWaitingNs);
+      if (now > since)
+      {
+        uint64_t gap = now - since;
+        txStats.gaps++;
+        if (gap > txStats.gapMaxNs)
+        {
+          txStats.gapMaxNs = gap > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)gap;
+        }
+      }
+      _txWritten(now, ret);
+      txHead = (txHead + ret) % TX_RING_SIZE;
+      txSize -= ret;
+    }
+    else if (ret < 0 && err == EAGAIN)
+    {
+      txStats.wouldBlock++;
+      pthread_mutex_unlock(&txLock);
+      struct pollfd pfd;
+      pfd.fd     = m_tx_fd;
+      pfd.events = POLLOUT;
+      poll(&pfd, 1, 100);
+      pthread_mutex_lock(&txLock);
+    }
+    else if (ret < 0 && err != EINTR)
+    {
+      DERROR("serial write failed: %s, %u bytes dropped\n", strerror(err),
+             txSize);
+      txHead = 0;
+      txSize = 0;
+    }
+  }
+  pthread_mutex_unlock(&txLock);
+}
+
+void
+LinuxSerialDevice::_txWritten(uint64_t now, size_t len)
+{
+  //! 8N1: 10 bits a byte
+  uint64_t byteNs = 10000000000ULL / (m_baudrate ? m_baudrate : 1);
+  txLineIdleNs    = std::max(txLineIdleNs, now) + len * byteNs;
+}
+
+uint64_t
+LinuxSerialDevice::_monotonicNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
 //! Current _serialRead behavior: Wait for 500 ms between characters till 18
 //! char, read 18 characters if data available & return
 //! 500 ms: long timeout to make sure that if we query the input buffer in the
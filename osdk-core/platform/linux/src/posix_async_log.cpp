@@ -0,0 +1,749 @@
+/*! @file posix_async_log.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Asynchronous binary logger for DJI Onboard SDK Linux/*NIX platforms
+ *
+ *  @copyright
+ *  2017 DJI. All rights reserved.
+ * */
+
+#include "posix_async_log.hpp"
+
+#include <new>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace DJI::OSDK;
+
+namespace
+{
+
+enum LengthModifier
+{
+  LEN_NONE,
+  LEN_HH,
+  LEN_H,
+  LEN_L,
+  LEN_LL,
+  LEN_LD,
+  LEN_Z,
+  LEN_J,
+  LEN_T
+};
+
+const unsigned long long STRING_OFFSET = 1ULL << 63;
+
+//! Conversion spec as found in a printf-style format string
+typedef struct Spec
+{
+  const char* begin; //! points at '%'
+  const char* end;   //! one past the conversion character
+  bool        starWidth;
+  bool        starPrecision;
+  int         length;
+  char        conversion;
+} Spec;
+
+//! @note returns false on a malformed or truncated spec
+bool
+parseSpec(const char* c, Spec& spec)
+{
+  spec.begin         = c++;
+  spec.starWidth     = false;
+  spec.starPrecision = false;
+  spec.length        = LEN_NONE;
+
+  while (*c && strchr("-+ #0", *c))
+    ++c;
+  if (*c == '*')
+  {
+    spec.starWidth = true;
+    ++c;
+  }
+  while (*c >= '0' && *c <= '9')
+    ++c;
+  if (*c == '.')
+  {
+    ++c;
+    if (*c == '*')
+    {
+      spec.starPrecision = true;
+      ++c;
+    }
+    while (*c >= '0' && *c <= '9')
+      ++c;
+  }
+
+  if (c[0] == 'h' && c[1] == 'h')
+  {
+    spec.length = LEN_HH;
+    c += 2;
+  }
+  else if (c[0] == 'l' && c[1] == 'l')
+  {
+    spec.length = LEN_LL;
+    c += 2;
+  }
+  else if (*c == 'h' || *c == 'l' || *c == 'L' || *c == 'z' || *c == 'j' ||
+           *c == 't')
+  {
+    switch (*c)
+    {
+      case 'h':
+        spec.length = LEN_H;
+        break;
+      case 'l':
+        spec.length = LEN_L;
+        break;
+      case 'L':
+        spec.length = LEN_LD;
+        break;
+      case 'z':
+        spec.length = LEN_Z;
+        break;
+      case 'j':
+        spec.length = LEN_J;
+        break;
+      default:
+        spec.length = LEN_T;
+        break;
+    }
+    ++c;
+  }
+
+  if (*c == '\0')
+  {
+    return false;
+  }
+  spec.conversion = *c;
+  spec.end        = c + 1;
+  return true;
+}
+
+bool
+isSigned(char conversion)
+{
+  return conversion == 'd' || conversion == 'i';
+}
+
+bool
+isUnsigned(char conversion)
+{
+  return conversion == 'u' || conversion == 'o' || conversion == 'x' ||
+         conversion == 'X';
+}
+
+bool
+isFloat(char conversion)
+{
+  return strchr("fFeEgGaA", conversion) != NULL;
+}
+
+//! @note integers are stored already truncated to their declared width so
+//! the consumer can print all of them through a single 'll' conversion
+bool
+encodeArgs(PosixAsyncLog::Record& rec, const char* fmt, va_list args)
+{
+  for (const char* c = fmt; *c; ++c)
+  {
+    if (*c != '%')
+    {
+      continue;
+    }
+    if (c[1] == '%')
+    {
+      ++c;
+      continue;
+    }
+
+    Spec spec;
+    if (!parseSpec(c, spec))
+    {
+      return false;
+    }
+    c = spec.end - 1;
+
+    int needed = 1 + spec.starWidth + spec.starPrecision;
+    if (rec.argc + needed > PosixAsyncLog::MAX_ARGS)
+    {
+      return false;
+    }
+    if (spec.starWidth)
+    {
+      rec.args[rec.argc++].i = va_arg(args, int);
+    }
+    if (spec.starPrecision)
+    {
+      rec.args[rec.argc++].i = va_arg(args, int);
+    }
+
+    PosixAsyncLog::Arg& arg = rec.args[rec.argc++];
+    if (isSigned(spec.conversion))
+    {
+      switch (spec.length)
+      {
+        case LEN_HH:
+          arg.i = (signed char)va_arg(args, int);
+          break;
+        case LEN_H:
+          arg.i = (short)va_arg(args, int);
+          break;
+        case LEN_L:
+          arg.i = va_arg(args, long);
+          break;
+        case LEN_LL:
+          arg.i = va_arg(args, long long);
+          break;
+        case LEN_Z:
+          arg.i = (long long)va_arg(args, size_t);
+          break;
+        case LEN_J:
+          arg.i = va_arg(args, intmax_t);
+          break;
+        case LEN_T:
+          arg.i = va_arg(args, ptrdiff_t);
+          break;
+        default:
+          arg.i = va_arg(args, int);
+          break;
+      }
+    }
+    else if (isUnsigned(spec.conversion))
+    {
+      switch (spec.length)
+      {
+        case LEN_HH:
+          arg.u = (unsigned char)va_arg(args, unsigned int);
+          break;
+        case LEN_H:
+          arg.u = (unsigned short)va_arg(args, unsigned int);
+          break;
+        case LEN_L:
+          arg.u = va_arg(args, unsigned long);
+          break;
+        case LEN_LL:
+          arg.u = va_arg(args, unsigned long long);
+          break;
+        case LEN_Z:
+          arg.u = va_arg(args, size_t);
+          break;
+        case LEN_J:
+          arg.u = va_arg(args, uintmax_t);
+          break;
+        case LEN_T:
+          arg.u = (unsigned long long)va_arg(args, ptrdiff_t);
+          break;
+        default:
+          arg.u = va_arg(args, unsigned int);
+          break;
+      }
+    }
+    else if (isFloat(spec.conversion))
+    {
+      if (spec.length == LEN_LD)
+      {
+        arg.ld = va_arg(args, long double);
+      }
+      else
+      {
+        arg.d = va_arg(args, double);
+      }
+    }
+    else if (spec.conversion == 'c')
+    {
+      arg.i = va_arg(args, int);
+    }
+    else if (spec.conversion == 'p')
+    {
+      arg.p = va_arg(args, void*);
+    }
+    else if (spec.conversion == 's')
+    {
+      const char* str = va_arg(args, const char*);
+      if (str == NULL)
+      {
+        str = "(null)";
+      }
+      size_t space = PosixAsyncLog::STRING_SPACE - rec.strUsed;
+      if (space == 0)
+      {
+        arg.u = 0; //! out of room, printed as an empty string
+        continue;
+      }
+      size_t len = strnlen(str, space - 1);
+      memcpy(rec.strings + rec.strUsed, str, len);
+      rec.strings[rec.strUsed + len] = '\0';
+      //! @note offsets, not pointers: the slot is reused once drained
+      arg.u = STRING_OFFSET | rec.strUsed;
+      rec.strUsed += len + 1;
+    }
+    else
+    {
+      //! %n and unknown conversions
+      return false;
+    }
+  }
+  return true;
+}
+
+//! @note appends to out, returns the new length
+size_t
+append(char* out, size_t size, size_t used, const char* fmt, ...)
+{
+  if (used >= size)
+  {
+    return used;
+  }
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(out + used, size - used, fmt, args);
+  va_end(args);
+  if (n < 0)
+  {
+    return used;
+  }
+  used += n;
+  return used < size ? used : size - 1;
+}
+
+size_t
+decodeArgs(const PosixAsyncLog::Record& rec, char* out, size_t size,
+           size_t used)
+{
+  int argIndex = 0;
+
+  for (const char* c = rec.fmt; *c; ++c)
+  {
+    if (*c != '%')
+    {
+      const char* next = strchr(c, '%');
+      size_t      len  = next ? (size_t)(next - c) : strlen(c);
+      used             = append(out, size, used, "%.*s", (int)len, c);
+      c += len - 1;
+      continue;
+    }
+    if (c[1] == '%')
+    {
+      used = append(out, size, used, "%%");
+      ++c;
+      continue;
+    }
+
+    Spec spec;
+    parseSpec(c, spec);
+    c = spec.end - 1;
+
+    //! rebuild the spec with '*' resolved and a uniform length modifier
+    char        specBuf[48];
+    size_t      specLen = 0;
+    const char* s       = spec.begin;
+    while (s < spec.end - 1 && specLen < sizeof(specBuf) - 16)
+    {
+      if (*s == '*')
+      {
+        specLen += snprintf(specBuf + specLen, sizeof(specBuf) - specLen,
+                            "%d", (int)rec.args[argIndex++].i);
+      }
+      else if (strchr("hlLzjt", *s) == NULL)
+      {
+        specBuf[specLen++] = *s;
+      }
+      ++s;
+    }
+
+    const PosixAsyncLog::Arg& arg = rec.args[argIndex++];
+    if (isSigned(spec.conversion) || isUnsigned(spec.conversion))
+    {
+      specBuf[specLen++] = 'l';
+      specBuf[specLen++] = 'l';
+    }
+    else if (isFloat(spec.conversion) && spec.length == LEN_LD)
+    {
+      specBuf[specLen++] = 'L';
+    }
+    specBuf[specLen++] = spec.conversion;
+    specBuf[specLen]   = '\0';
+
+    if (isSigned(spec.conversion))
+    {
+      used = append(out, size, used, specBuf, arg.i);
+    }
+    else if (isUnsigned(spec.conversion))
+    {
+      used = append(out, size, used, specBuf, arg.u);
+    }
+    else if (isFloat(spec.conversion))
+    {
+      if (spec.length == LEN_LD)
+      {
+        used = append(out, size, used, specBuf, arg.ld);
+      }
+      else
+      {
+        used = append(out, size, used, specBuf, arg.d);
+      }
+    }
+    else if (spec.conversion == 'c')
+    {
+      used = append(out, size, used, specBuf, (int)arg.i);
+    }
+    else if (spec.conversion == 'p')
+    {
+      used = append(out, size, used, specBuf, arg.p);
+    }
+    else if (spec.conversion == 's')
+    {
+      const char* str = "";
+      if (arg.u & STRING_OFFSET)
+      {
+        str = rec.strings + (arg.u & ~STRING_OFFSET);
+      }
+      used = append(out, size, used, specBuf, str);
+    }
+  }
+  return used;
+}
+
+PosixAsyncLog* asyncLogInstance = NULL;
+
+} // namespace
+
+class PosixAsyncLog::ThreadRing
+{
+public:
+  ThreadRing()
+    : next(NULL)
+    , drained(false)
+    , valid(true)
+    , pending(false)
+  {
+    head.store(0);
+    tail.store(0);
+    orphan.store(false);
+  }
+
+  Record                slots[RING_SIZE];
+  std::atomic<uint32_t> head; //! written by the owning thread only
+  std::atomic<uint32_t> tail; //! written by the drain thread only
+  std::atomic<bool>     orphan;
+  ThreadRing*           next;
+  bool                  drained; //! orphan and empty, drain thread only
+
+  //! title() state of the owning thread, see Log::vaild
+  bool        valid;
+  bool        pending;
+  const char* prefix;
+  const char* func;
+  int         level;
+  int         line;
+};
+
+PosixAsyncLog*
+PosixAsyncLog::install()
+{
+  if (asyncLogInstance)
+  {
+    return asyncLogInstance;
+  }
+
+  PosixAsyncLog* log = new (std::nothrow) PosixAsyncLog();
+  if (log == NULL)
+  {
+    DERROR("fail to allocate asynchronous logger\n");
+    return NULL;
+  }
+
+  log->running.store(true);
+  if (pthread_create(&log->threadID, NULL, drain_call, log) != 0)
+  {
+    DERROR("fail to create thread for asynchronous logger\n");
+    delete log;
+    return NULL;
+  }
+  pthread_setname_np(log->threadID, "asyncLog");
+
+  asyncLogInstance = log;
+  Log::install(log);
+  atexit(atExit);
+  return log;
+}
+
+PosixAsyncLog::PosixAsyncLog()
+  : rings(NULL)
+  , droppedReported(0)
+{
+  dropped.store(0);
+  running.store(false);
+  pthread_mutex_init(&ringsLock, NULL);
+  pthread_key_create(&ringKey, releaseRing);
+}
+
+PosixAsyncLog::~PosixAsyncLog()
+{
+  pthread_key_delete(ringKey);
+  pthread_mutex_destroy(&ringsLock);
+}
+
+PosixAsyncLog::ThreadRing*
+PosixAsyncLog::localRing()
+{
+  static thread_local ThreadRing* ring = NULL;
+  if (ring == NULL)
+  {
+    ring = new (std::nothrow) ThreadRing();
+    if (ring == NULL)
+    {
+      return NULL;
+    }
+    pthread_setspecific(ringKey, ring);
+    pthread_mutex_lock(&ringsLock);
+    ring->next = rings;
+    rings      = ring;
+    pthread_mutex_unlock(&ringsLock);
+  }
+  return ring;
+}
+
+void
+PosixAsyncLog::releaseRing(void* ring)
+{
+  //! @note the drain thread frees it once the remaining records are out
+  static_cast<ThreadRing*>(ring)->orphan.store(true,
+                                               std::memory_order_release);
+}
+
+Log&
+PosixAsyncLog::title(int level, const char* prefix, const char* func,
+                     int line)
+{
+  ThreadRing* ring = localRing();
+  if (ring == NULL)
+  {
+    return Log::title(level, prefix, func, line);
+  }
+
+  ring->valid = level != 0;
+  if (ring->valid)
+  {
+    ring->pending = true;
+    ring->prefix  = prefix;
+    ring->func    = func;
+    ring->level   = level;
+    ring->line    = line;
+  }
+  return *this;
+}
+
+Log&
+PosixAsyncLog::print(const char* fmt, ...)
+{
+  ThreadRing* ring = localRing();
+  va_list     args;
+  va_start(args, fmt);
+  if (ring == NULL)
+  {
+    vprintf(fmt, args);
+    va_end(args);
+    return *this;
+  }
+  if (!ring->valid)
+  {
+    va_end(args);
+    return *this;
+  }
+
+  uint32_t head = ring->head.load(std::memory_order_relaxed);
+  uint32_t tail = ring->tail.load(std::memory_order_acquire);
+  if (head - tail >= (uint32_t)RING_SIZE)
+  {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    ring->pending = false;
+    va_end(args);
+    return *this;
+  }
+
+  Record& rec = ring->slots[head & (RING_SIZE - 1)];
+  rec.fmt     = fmt;
+  rec.prefix  = NULL;
+  if (ring->pending)
+  {
+    rec.prefix    = ring->prefix;
+    rec.func      = ring->func;
+    rec.level     = ring->level;
+    rec.line      = ring->line;
+    ring->pending = false;
+  }
+  rec.argc         = 0;
+  rec.strUsed      = 0;
+  rec.preformatted = 0;
+
+  va_list copy;
+  va_copy(copy, args);
+  if (!encodeArgs(rec, fmt, copy))
+  {
+    //! @note slow path, keep the text rather than lose the record
+    vsnprintf(rec.strings, STRING_SPACE, fmt, args);
+    rec.preformatted = 1;
+  }
+  va_end(copy);
+  va_end(args);
+
+  ring->head.store(head + 1, std::memory_order_release);
+  return *this;
+}
+
+void
+PosixAsyncLog::write(const Record& rec)
+{
+  char   out[1024];
+  size_t used = 0;
+
+  if (rec.prefix)
+  {
+    used = append(out, sizeof(out), used, "\n%s/%d @ %s, L%d: ", rec.prefix,
+                  rec.level, rec.func, rec.line);
+  }
+  if (rec.preformatted)
+  {
+    used = append(out, sizeof(out), used, "%s", rec.strings);
+  }
+  else
+  {
+    used = decodeArgs(rec, out, sizeof(out), used);
+  }
+  fwrite(out, 1, used, stdout);
+}
+
+bool
+PosixAsyncLog::drainOnce()
+{
+  bool written = false;
+  bool drained = false;
+
+  //! localRing() only prepends and only this thread unlinks, so the list
+  //! from the head taken here can be walked without the lock; the console
+  //! I/O must not hold up a thread making its first log call
+  pthread_mutex_lock(&ringsLock);
+  ThreadRing* first = rings;
+  pthread_mutex_unlock(&ringsLock);
+
+  for (ThreadRing* ring = first; ring; ring = ring->next)
+  {
+    bool     orphan = ring->orphan.load(std::memory_order_acquire);
+    uint32_t tail   = ring->tail.load(std::memory_order_relaxed);
+    uint32_t head   = ring->head.load(std::memory_order_acquire);
+
+    for (; tail != head; ++tail)
+    {
+      write(ring->slots[tail & (RING_SIZE - 1)]);
+      written = true;
+    }
+    ring->tail.store(tail, std::memory_order_release);
+    ring->drained = orphan;
+    drained       = drained || orphan;
+  }
+
+  ThreadRing* dead = NULL;
+  if (drained)
+  {
+    pthread_mutex_lock(&ringsLock);
+    ThreadRing** link = &rings;
+    while (*link)
+    {
+      ThreadRing* ring = *link;
+      if (ring->drained)
+      {
+        *link      = ring->next;
+        ring->next = dead;
+        dead       = ring;
+      }
+      else
+      {
+        link = &ring->next;
+      }
+    }
+    pthread_mutex_unlock(&ringsLock);
+  }
+  while (dead)
+  {
+    ThreadRing* ring = dead;
+    dead             = ring->next;
+    delete ring;
+  }
+
+  uint32_t lost = dropped.load(std::memory_order_relaxed);
+  if (lost != droppedReported)
+  {
+    fprintf(stdout, "\nSTATUS/1 @ asyncLog: %u log records dropped",
+            lost - droppedReported);
+    droppedReported = lost;
+    written         = true;
+  }
+
+  if (written)
+  {
+    fflush(stdout);
+  }
+  return written;
+}
+
+void*
+PosixAsyncLog::drain_call(void* param)
+{
+  PosixAsyncLog* log = (PosixAsyncLog*)param;
+  while (log->running.load())
+  {
+    if (!log->drainOnce())
+    {
+      usleep(1000); //! @note batch records, keep the CPU usage low
+    }
+  }
+  return NULL;
+}
+
+void
+PosixAsyncLog::flush()
+{
+  for (int i = 0; i < 500; ++i)
+  {
+    bool empty = true;
+    pthread_mutex_lock(&ringsLock);
+    for (ThreadRing* ring = rings; ring; ring = ring->next)
+    {
+      if (ring->head.load(std::memory_order_acquire) !=
+          ring->tail.load(std::memory_order_acquire))
+      {
+        empty = false;
+        break;
+      }
+    }
+    pthread_mutex_unlock(&ringsLock);
+    if (empty)
+    {
+      return;
+    }
+    usleep(1000);
+  }
+}
+
+uint32_t
+PosixAsyncLog::getDroppedCount() const
+{
+  return dropped.load(std::memory_order_relaxed);
+}
+
+void
+PosixAsyncLog::atExit()
+{
+  if (asyncLogInstance)
+  {
+    asyncLogInstance->flush();
+  }
+}
@@ -0,0 +1,157 @@
+/*! @file posix_periodic_scheduler.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Real-time thread for the periodic scheduler on Linux/*NIX platforms
+ *
+ *  @copyright
+ *  2017 DJI. All rights reserved.
+ * */
+
+#include "posix_periodic_scheduler.hpp"
+#include "dji_log.hpp"
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+using namespace DJI::OSDK;
+
+PosixPeriodicScheduler::PosixPeriodicScheduler(HardDriver* driver)
+  : PeriodicScheduler(driver)
+{
+  running.store(false);
+}
+
+PosixPeriodicScheduler::~PosixPeriodicScheduler()
+{
+  stop();
+}
+
+bool
+PosixPeriodicScheduler::start(const RealTimeConfig& config)
+{
+  if (running.load())
+  {
+    return true;
+  }
+
+  if (config.lockMemory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+  {
+    DSTATUS("Warning: mlockall failed (%s), pages may fault\n",
+            strerror(errno));
+  }
+
+  running.store(true);
+
+  int ret = -1;
+  if (config.priority > 0)
+  {
+    pthread_attr_t     attr;
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = config.priority;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &param);
+    ret = pthread_create(&threadID, &attr, run_call, this);
+    pthread_attr_destroy(&attr);
+    if (ret != 0)
+    {
+      DSTATUS("Warning: no SCHED_FIFO for the periodic scheduler (%s), "
+              "using the default policy\n",
+              strerror(ret));
+    }
+  }
+  if (ret != 0)
+  {
+    ret = pthread_create(&threadID, NULL, run_call, this);
+  }
+  if (ret != 0)
+  {
+    DERROR("fail to create thread for periodic scheduler\n");
+    running.store(false);
+    return false;
+  }
+  pthread_setname_np(threadID, "periodic");
+
+  if (config.cpu >= 0)
+  {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(config.cpu, &cpus);
+    ret = pthread_setaffinity_np(threadID, sizeof(cpus), &cpus);
+    if (ret != 0)
+    {
+      DSTATUS("Warning: cannot pin the periodic scheduler to CPU %d (%s)\n",
+              config.cpu, strerror(ret));
+    }
+  }
+  return true;
+}
+
+void
+PosixPeriodicScheduler::stop()
+{
+  if (running.exchange(false))
+  {
+    pthread_join(threadID, NULL);
+  }
+}
+
+bool
+PosixPeriodicScheduler::waitForRun()
+{
+  if (!running.load() || pthread_equal(pthread_self(), threadID))
+  {
+    return false;
+  }
+  sched_yield();
+  return true;
+}
+
+void*
+PosixPeriodicScheduler::run_call(void* param)
+{
+  static_cast<PosixPeriodicScheduler*>(param)->run();
+  return NULL;
+}
+
+void
+PosixPeriodicScheduler::run()
+{
+  while (running.load())
+  {
+    time_us now  = driver->getTimeStampUs();
+    time_us next = runDue(now);
+    time_us idle = driver->getTimeStampUs() + IDLE_WAIT;
+    sleepUntil(next != 0 && next < idle ? next : idle);
+  }
+}
+
+void
+PosixPeriodicScheduler::sleepUntil(time_us deadline)
+{
+  //! Deadlines are on the driver's clock; LinuxSerialDevice uses
+  //! CLOCK_MONOTONIC but a custom driver may not, so go through the offset
+  struct timespec mono;
+  clock_gettime(CLOCK_MONOTONIC, &mono);
+  time_us now = driver->getTimeStampUs();
+  if (deadline <= now)
+  {
+    return;
+  }
+
+  uint64_t ns = (uint64_t)mono.tv_nsec + (deadline - now) * 1000;
+  mono.tv_sec += ns / 1000000000;
+  mono.tv_nsec = ns % 1000000000;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &mono, NULL) ==
+         EINTR)
+  {
+  }
+}
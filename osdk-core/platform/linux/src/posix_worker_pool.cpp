@@ -0,0 +1,130 @@
+/*! @file posix_worker_pool.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Worker threads for the worker lanes on Linux/*NIX platforms
+ *
+ *  @copyright
+ *  2017 DJI. All rights reserved.
+ * */
+
+#include "posix_worker_pool.hpp"
+#include "dji_log.hpp"
+
+#include <stdio.h>
+#include <time.h>
+
+using namespace DJI::OSDK;
+
+PosixWorkerPool::PosixWorkerPool()
+  : threadCount(0)
+  , wakeups(0)
+{
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&idleCond, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_mutex_init(&idleLock, NULL);
+  running.store(false);
+}
+
+PosixWorkerPool::~PosixWorkerPool()
+{
+  stop();
+  pthread_cond_destroy(&idleCond);
+  pthread_mutex_destroy(&idleLock);
+}
+
+bool
+PosixWorkerPool::start(int threads)
+{
+  if (running.load())
+  {
+    return true;
+  }
+  if (threads > MAX_THREADS)
+  {
+    threads = MAX_THREADS;
+  }
+
+  running.store(true);
+  for (threadCount = 0; threadCount < threads; ++threadCount)
+  {
+    if (pthread_create(&threadIDs[threadCount], NULL, run_call, this) != 0)
+    {
+      DERROR("fail to create thread for worker %d\n", threadCount);
+      break;
+    }
+    char name[16];
+    snprintf(name, sizeof(name), "worker%d", threadCount);
+    pthread_setname_np(threadIDs[threadCount], name);
+  }
+  if (threadCount == 0)
+  {
+    running.store(false);
+    return false;
+  }
+  return true;
+}
+
+void
+PosixWorkerPool::stop()
+{
+  if (!running.exchange(false))
+  {
+    return;
+  }
+  pthread_mutex_lock(&idleLock);
+  pthread_cond_broadcast(&idleCond);
+  pthread_mutex_unlock(&idleLock);
+  for (int i = 0; i < threadCount; ++i)
+  {
+    pthread_join(threadIDs[i], NULL);
+  }
+  threadCount = 0;
+}
+
+void
+PosixWorkerPool::wake()
+{
+  pthread_mutex_lock(&idleLock);
+  wakeups++;
+  pthread_cond_signal(&idleCond);
+  pthread_mutex_unlock(&idleLock);
+}
+
+void*
+PosixWorkerPool::run_call(void* param)
+{
+  static_cast<PosixWorkerPool*>(param)->run();
+  return NULL;
+}
+
+void
+PosixWorkerPool::run()
+{
+  uint32_t seen = 0;
+  while (running.load())
+  {
+    if (runOne())
+    {
+      continue;
+    }
+
+    //! Sleep only if no post() came since the last look at the lanes
+    pthread_mutex_lock(&idleLock);
+    if (wakeups == seen && running.load())
+    {
+      struct timespec deadline;
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      uint64_t ns = (uint64_t)deadline.tv_nsec + IDLE_WAIT * 1000;
+      deadline.tv_sec += ns / 1000000000;
+      deadline.tv_nsec = ns % 1000000000;
+      pthread_cond_timedwait(&idleCond, &idleLock, &deadline);
+    }
+    seen = wakeups;
+    pthread_mutex_unlock(&idleLock);
+  }
+}
@@ -0,0 +1,123 @@
+/** @file dji_command_latency.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Per-command round-trip latency statistics for the OPEN protocol
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_COMMAND_LATENCY_H
+#define DJI_COMMAND_LATENCY_H
+
+#include "dji_atomic.hpp"
+#include "dji_histogram.hpp"
+#include "dji_metrics.hpp"
+#include "dji_type.hpp"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+//! Number of distinct (cmd_set, cmd_id) pairs tracked
+#ifndef OSDK_LATENCY_TABLE_SIZE
+#ifdef STM32
+#define OSDK_LATENCY_TABLE_SIZE 2
+#else
+#define OSDK_LATENCY_TABLE_SIZE 32
+#endif
+#endif
+
+//! Snapshot of one command pair, times in microseconds
+typedef struct CommandLatency
+{
+  static const int RETRY_BUCKETS = 8; //! 0..6 retries, 7+ in the last one
+
+  uint8_t  cmd_set;
+  uint8_t  cmd_id;
+  uint32_t acked;    //! commands that got their ACK
+  uint32_t timeouts; //! commands that ran out of retries
+  uint64_t ackP50;   //! from the first write to the ACK, retries included
+  uint64_t ackP90;
+  uint64_t ackP99;
+  uint64_t ackMax;
+  double   ackMean;
+  uint64_t queueP99; //! from send() to the first write, i.e. our own queuing
+  uint64_t queueMax;
+  uint32_t retries[RETRY_BUCKETS];
+} CommandLatency;
+
+//! @note called from the read thread, keep it short
+typedef void (*LatencyAlertCallback)(uint8_t cmd_set, uint8_t cmd_id,
+                                     uint64_t p99, uint64_t baseline,
+                                     UserData userData);
+
+/*! @brief Fixed-memory latency and retry histograms per command pair
+ *
+ * @details Entries are claimed lock-free on first use. A periodic report
+ * prints one line per command and compares the p99 of the last period with
+ * a slowly moving baseline to flag drifts.
+ */
+class CommandLatencyTable
+{
+public:
+  CommandLatencyTable();
+
+  void recordQueueDelay(uint8_t cmd_set, uint8_t cmd_id, time_us delay);
+  void recordAck(uint8_t cmd_set, uint8_t cmd_id, time_us latency,
+                 uint32_t retries);
+  void recordTimeout(uint8_t cmd_set, uint8_t cmd_id);
+
+  bool get(uint8_t cmd_set, uint8_t cmd_id, CommandLatency& out) const;
+  //! @return number of entries written to out
+  int getAll(CommandLatency* out, int maxCount) const;
+  void reset();
+
+  void writeMetrics(MetricsWriter& writer) const;
+
+  //! @param periodMs 0 disables the periodic report
+  void setReportPeriod(uint32_t periodMs);
+  //! Alert when the p99 of a period exceeds the baseline by ratio (0.5=+50%)
+  void setDriftAlert(double ratio, LatencyAlertCallback callback = 0,
+                     UserData userData = 0);
+  //! Emit the periodic report when it is due
+  void poll(time_us now);
+
+public:
+  static const int    TABLE_SIZE          = OSDK_LATENCY_TABLE_SIZE;
+  static const int    MIN_WINDOW_SAMPLES  = 10;
+  static const double BASELINE_WEIGHT;
+
+private:
+  typedef struct Entry
+  {
+    Atomic<uint32_t> key; //! 0 = free, else 0x10000 | set << 8 | id
+    Histogram        ack;
+    Histogram        ackWindow;
+    Histogram        queue;
+    Atomic<uint32_t> retries[CommandLatency::RETRY_BUCKETS];
+    Atomic<uint32_t> timeouts;
+    uint64_t         baselineP99;
+  } Entry;
+
+  Entry*       find(uint8_t cmd_set, uint8_t cmd_id, bool create);
+  const Entry* find(uint8_t cmd_set, uint8_t cmd_id) const;
+  void fill(const Entry& entry, CommandLatency& out) const;
+  void report();
+
+  Entry entries[TABLE_SIZE];
+
+  uint32_t             reportPeriodMs;
+  time_us              nextReport;
+  double               driftRatio;
+  LatencyAlertCallback alertCallback;
+  UserData             alertUserData;
+}; // class CommandLatencyTable
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_COMMAND_LATENCY_H
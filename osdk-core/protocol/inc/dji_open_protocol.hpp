@@ -14,9 +14,14 @@
 
 #include "dji_ack.hpp"
 #include "dji_aes.hpp"
+#include "dji_atomic.hpp"
+#include "dji_command_latency.hpp"
 #include "dji_hard_driver.hpp"
 #include "dji_log.hpp"
+#include "dji_metrics.hpp"
+#include "dji_retransmit_timer.hpp"
 #include "dji_thread_manager.hpp"
+#include "dji_tx_scheduler.hpp"
 #include "dji_type.hpp"
 /*! Platform includes:
  *  This set of macros figures out which files to include based on your
@@ -83,8 +88,87 @@ typedef struct RecvContainer
   DJI::OSDK::ACK::Entry     recvInfo;
   DJI::OSDK::ACK::TypeUnion recvData;
   DJI::OSDK::DispatchInfo   dispatchInfo;
+  //! Host time the last byte of the frame arrived, see Protocol::rxTime()
+  DJI::OSDK::time_us        recvTime;
 } RecvContainer;
 
+//----------------------------------------------------------------------
+// Link Health
+//----------------------------------------------------------------------
+
+//! Snapshot of the link counters, see Protocol::getLinkStats()
+typedef struct LinkStats
+{
+  uint64_t bytesIn;
+  uint64_t bytesOut;
+  uint32_t framesParsed;    //! frames that passed both CRCs
+  uint32_t framesSent;      //! including retransmissions and ACKs
+  uint32_t framesDropped;   //! not taken by the port
+  uint32_t headerCRCErrors;
+  uint32_t dataCRCErrors;
+  uint32_t resyncBytes;     //! bytes discarded while hunting for a header
+  uint32_t bufferOverflows; //! parser buffer wrapped without a frame
+  uint32_t retransmissions;
+  uint32_t sessionRetransmissions[SESSION_TABLE_NUM];
+  uint32_t sessionTimeouts; //! sessions freed after the last retry
+  uint32_t sessionAllocFailures;
+  uint32_t bursts;          //! sendBurst() writes
+  uint32_t burstGapMaxNs;   //! largest idle line time inside a burst
+  uint16_t mmuHighWater;
+  uint16_t mmuSize;
+  bool     serialStatsValid; //! false if the driver cannot report them
+  SerialErrorStats serial;
+  bool             serialTxStatsValid; //! false if send() is synchronous
+  SerialTxStats    serialTx;
+} LinkStats;
+
+//----------------------------------------------------------------------
+// Frame Templates
+//----------------------------------------------------------------------
+
+/*! @brief Skeleton of a session-0 frame with a fixed cmd and payload length
+ *
+ * @details Filled in by Protocol::prepare(). Everything in the header but
+ * the sequence number is constant, so the CRC16 and CRC32 states over
+ * those bytes are kept and each send only continues them. Setpoints sent
+ * at 50-100Hz use this instead of Protocol::send().
+ */
+typedef struct FrameTemplate
+{
+  uint8_t  header[sizeof(Header)]; //! sequence number and CRC16 left 0
+  uint8_t  cmd_set;
+  uint8_t  cmd_id;
+  uint8_t  encrypt;
+  uint16_t payloadLen;  //! without the cmd pair
+  uint16_t length;      //! whole frame, 0 until prepared
+  uint16_t crc16Prefix; //! CRC16 state after the constant header bytes
+  uint32_t crc32Prefix; //! CRC32 state after the same bytes
+} FrameTemplate;
+
+//----------------------------------------------------------------------
+// Command Bursts
+//----------------------------------------------------------------------
+
+//! Bytes of all the frames of one burst together
+#ifndef OSDK_BURST_BUFFER_SIZE
+#ifdef STM32
+#define OSDK_BURST_BUFFER_SIZE 256
+#else
+#define OSDK_BURST_BUFFER_SIZE 1024
+#endif
+#endif
+
+//! Outcome of a Protocol::sendBurst()
+typedef struct BurstResult
+{
+  uint8_t  frames;     //! frames written whole
+  uint16_t bytes;      //! accepted by the one send() call
+  time_us  encodeTime; //! from taking the lock to the write
+  time_us  writeTime;  //! spent in send()
+  uint32_t wireTimeNs; //! of all the bytes at the configured baud rate
+  uint32_t gapNs;      //! idle line time between two frames, at most
+} BurstResult;
+
 //----------------------------------------------------------------------
 // Codec Management
 //----------------------------------------------------------------------
@@ -220,6 +304,55 @@ public:
   /** @note Main interface*/
   void send(Command* parameter);
 
+  /*! @brief Build the frame skeleton of a fire-and-forget (session 0)
+   * command with a fixed payload length
+   * @return false if len does not fit in a frame
+   */
+  bool prepare(FrameTemplate* frame, bool is_enc, const uint8_t cmd[],
+               size_t len);
+  /*! @brief Send a prepared command, pdata holds frame->payloadLen bytes
+   * @details Only the sequence number and payload are written per call;
+   * goes through the TxScheduler like send().
+   * @return 0 on success, -1 if the frame could not be built
+   */
+  int sendPrepared(const FrameTemplate* frame, const void* pdata);
+  //! Send in txClass instead of the command's own class
+  int sendPrepared(const FrameTemplate* frame, const void* pdata,
+                   TxScheduler::TxClass txClass);
+  /*! @brief Prepare frame again if cmd, len or is_enc differ, then send it
+   * @param txClass TX_CLASS_COUNT for the command's own class
+   */
+  int sendPrepared(FrameTemplate* frame, bool is_enc, const uint8_t cmd[],
+                   const void* pdata, size_t len,
+                   TxScheduler::TxClass txClass = TxScheduler::TX_CLASS_COUNT);
+
+  /*! @brief Send commands back to back, in one write
+   *
+   * @details The sessions of all the commands are reserved and all the
+   * frames encoded into one buffer under a single memory lock, so no other
+   * thread's frame can come between them, then the buffer goes to the
+   * driver in one send() call. If a session cannot be reserved or a frame
+   * cannot be built nothing is sent. ACKed commands are retried one by one
+   * by sendPoll() as usual. There is a single session 1, so a burst takes
+   * at most one session 1 command.
+   *
+   * The burst is admitted through the TxScheduler once, in the most urgent
+   * class of its commands. For a driver that writes synchronously, gapNs
+   * in the result is the time send() took beyond the wire time of the
+   * bytes, shared over the gaps. A driver with a TX ring returns once the
+   * bytes are queued and drains them later, so gapNs is 0 there and the
+   * gaps are measured by the ring's writer instead; burstGapMaxNs in
+   * getLinkStats() takes the larger of the two.
+   *
+   * If the port takes only part of the buffer, result->frames counts the
+   * frames written whole. ACKed commands after them are retried by
+   * sendPoll(); session 0 ones are lost and counted in framesDropped.
+   *
+   * @param cmds buf holds the cmd pair then the payload, as for send()
+   * @return 0 if every frame was written, -1 otherwise
+   */
+  int sendBurst(const Command* cmds, int count, BurstResult* result = 0);
+
   //! SendPoll:
   void sendPoll();
 
@@ -241,6 +374,23 @@ public:
   /**********************************Fitlered******************************/
   void setKey(const char* key);
 
+  /********************************Link health******************************/
+  //! Lock-free snapshot of the link counters, callable from any thread
+  LinkStats getLinkStats() const;
+  //! Append the link counters to a Prometheus text-format writer
+  void writeMetrics(MetricsWriter& writer) const;
+  //! Publish the link counters as a Prometheus text file
+  bool exportMetrics(const char* path) const;
+
+  //! Send-to-ACK latency and retry histograms per (cmd_set, cmd_id)
+  CommandLatencyTable* getLatencyTable();
+
+  //! Traffic classes and link budget of the send pipeline
+  TxScheduler* getTxScheduler();
+
+  //! RTT based retransmission timeouts of session 1 and 2 commands
+  RetransmitTimer* getRetransmitTimer();
+
   /************************Useful frame-related constants*******************/
 public:
   static const int     BUFFER_SIZE = 1024;
@@ -251,6 +401,10 @@ public:
   static const int     CRCData     = sizeof(uint32_t);
   static const int     CRCHeadLen  = sizeof(Header) - CRCHead;
   static const int     PackageMin  = sizeof(Header) + CRCData;
+  //! Header bytes before the sequence number, constant for a template
+  static const int     SeqOffset   = CRCHeadLen - sizeof(uint16_t);
+  static const int     MAX_BURST_FRAMES  = 8;
+  static const int     BURST_BUFFER_SIZE = OSDK_BURST_BUFFER_SIZE;
   uint8_t              buf[BUFFER_SIZE];
 
 private:
@@ -308,8 +462,11 @@ private:
 
   /*******************************Send Pipeline*****************************/
 
+  //! Admits the frame through the TxScheduler, then sends it
   int sendInterface(Command* cmdContainer);
+  int sendFrame(Command* cmdContainer, time_us enqueued);
   void sendData(uint8_t* buf);
+  void traceSend(const uint8_t* buf);
 
   /****************************Multithreading support***********************/
   //! Thread sync for ACK
@@ -334,6 +491,8 @@ private:
                    uint16_t seq_num);
   void encodeData(SDKFilter* p_filter, Header* p_head,
                   ptr_aes256_codec codec_func);
+  uint16_t encodePrepared(uint8_t* pdest, const FrameTemplate* frame,
+                          const void* pdata, uint16_t seq_num);
 
   /*******************************Utility Functions************************/
   uint16_t calculateLength(uint16_t size, uint16_t encrypt_flag);
@@ -368,6 +527,7 @@ private:
   //! Encode buffers
   uint8_t encodeSendData[BUFFER_SIZE];
   uint8_t encodeACK[ACK_SIZE];
+  uint8_t encodeBurst[BURST_BUFFER_SIZE];
 
   //! Thread data
   bool            stopCond;
@@ -383,6 +543,45 @@ private:
   int buf_read_pos;
   int read_len;
   int readPollCount;
+
+  //! Receive time stamps: host time readall() returned, and whether buf is
+  //! being parsed (false when a driver feeds byteHandler() directly)
+  time_us  readTime;
+  time_us  prevReadTime;
+  bool     rxChunk;
+  uint32_t byteTimeNs; //! one byte (10 bits) at the configured baud rate
+
+  /*!
+   * @brief Arrival time of the byte being parsed
+   * @details Bytes of one readall() chunk arrived back to back, the last
+   * one just before readall() returned; earlier ones are placed one byte
+   * time apart. Outside readPoll() the byte is taken to have arrived now.
+   */
+  time_us rxTime() const;
+
+  //! Link health, written by the read/send paths without locking
+  typedef struct LinkCounters
+  {
+    Atomic<uint64_t> bytesIn;
+    Atomic<uint64_t> bytesOut;
+    Atomic<uint32_t> framesParsed;
+    Atomic<uint32_t> framesSent;
+    Atomic<uint32_t> framesDropped;
+    Atomic<uint32_t> headerCRCErrors;
+    Atomic<uint32_t> dataCRCErrors;
+    Atomic<uint32_t> resyncBytes;
+    Atomic<uint32_t> bufferOverflows;
+    Atomic<uint32_t> sessionRetransmissions[SESSION_TABLE_NUM];
+    Atomic<uint32_t> sessionTimeouts;
+    Atomic<uint32_t> sessionAllocFailures;
+    Atomic<uint32_t> bursts;
+    Atomic<uint32_t> burstGapMaxNs;
+  } LinkCounters;
+
+  LinkCounters        counters;
+  CommandLatencyTable latency;
+  TxScheduler         txScheduler;
+  RetransmitTimer     rto;
 };
 
 } // namespace OSDK
@@ -0,0 +1,117 @@
+/** @file dji_retransmit_timer.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Retransmission timeouts from measured round-trip times
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_RETRANSMIT_TIMER_H
+#define DJI_RETRANSMIT_TIMER_H
+
+#include "dji_atomic.hpp"
+#include "dji_metrics.hpp"
+#include "dji_type.hpp"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+//! Number of distinct (cmd_set, cmd_id) pairs with their own estimate
+#ifndef OSDK_RTO_TABLE_SIZE
+#ifdef STM32
+#define OSDK_RTO_TABLE_SIZE 4
+#else
+#define OSDK_RTO_TABLE_SIZE 32
+#endif
+#endif
+
+//! Snapshot of one command pair
+typedef struct RetransmitEstimate
+{
+  uint8_t  cmd_set;
+  uint8_t  cmd_id;
+  uint32_t samples; //! ACKs of commands sent only once
+  uint32_t srtt;    //! smoothed round-trip time, us
+  uint32_t rttvar;  //! round-trip time variation, us
+  uint16_t rto;     //! timeout of the next first transmission, ms
+  uint8_t  backoff; //! rto is doubled this many times
+} RetransmitEstimate;
+
+/*! @brief Per-command retransmission timeouts, TCP style (RFC 6298)
+ *
+ * @details Each ACK of a command that was written once updates the
+ * command's SRTT and RTTVAR; ACKs of retransmitted commands are ambiguous
+ * and are not sampled (Karn). The timeout is SRTT + max(G, 4 * RTTVAR),
+ * G being the sendPoll() period, kept within [floor, ceiling]. Until a
+ * command has a sample the caller's timeout is used, within the same
+ * bounds.
+ *
+ * Every retransmission doubles the session's timeout. A command that runs
+ * out of retries doubles the timeout of the next ones too, up to
+ * MAX_BACKOFF times, until one of them is ACKed without a retransmission.
+ *
+ * Called with the protocol's memory lock held; the getters can be used
+ * from any thread.
+ */
+class RetransmitTimer
+{
+public:
+  RetransmitTimer();
+
+  //! @param floorMs raised to GRANULARITY_MS if lower
+  void setBounds(uint16_t floorMs, uint16_t ceilingMs);
+  //! Disabled, the caller's timeout is used unchanged, as before
+  void setEnabled(bool enable);
+  bool isEnabled() const;
+
+  //! Timeout of the first transmission of a command, in ms
+  uint16_t initialTimeout(uint8_t cmd_set, uint8_t cmd_id,
+                          uint16_t requested);
+  //! Timeout after a retransmission
+  uint16_t backoff(uint16_t timeout) const;
+
+  //! @param retries retransmissions before the ACK, 0 for a clean sample
+  void recordAck(uint8_t cmd_set, uint8_t cmd_id, time_us rtt,
+                 uint32_t retries);
+  void recordTimeout(uint8_t cmd_set, uint8_t cmd_id);
+
+  bool get(uint8_t cmd_set, uint8_t cmd_id, RetransmitEstimate& out) const;
+  void writeMetrics(MetricsWriter& writer) const;
+
+public:
+  static const int      TABLE_SIZE         = OSDK_RTO_TABLE_SIZE;
+  static const uint16_t GRANULARITY_MS     = 20; //! POLL_TICK
+  static const uint16_t DEFAULT_FLOOR_MS   = 2 * GRANULARITY_MS;
+  static const uint16_t DEFAULT_CEILING_MS = 3000;
+  static const uint8_t  MAX_BACKOFF        = 4;
+
+private:
+  typedef struct Entry
+  {
+    Atomic<uint32_t> key; //! 0 = free, else 0x10000 | set << 8 | id
+    Atomic<uint32_t> samples;
+    Atomic<uint32_t> srtt;
+    Atomic<uint32_t> rttvar;
+    Atomic<uint8_t>  backoff;
+  } Entry;
+
+  Entry*       find(uint8_t cmd_set, uint8_t cmd_id, bool create);
+  const Entry* find(uint8_t cmd_set, uint8_t cmd_id) const;
+  uint16_t timeout(const Entry& entry, uint16_t requested) const;
+  uint16_t clamp(uint32_t timeoutMs) const;
+
+  Entry    entries[TABLE_SIZE];
+  bool     enabled;
+  uint16_t floorMs;
+  uint16_t ceilingMs;
+}; // class RetransmitTimer
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_RETRANSMIT_TIMER_H
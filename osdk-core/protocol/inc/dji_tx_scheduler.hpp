@@ -0,0 +1,125 @@
+/** @file dji_tx_scheduler.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Priority classes and link budgeting for outgoing frames
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_TX_SCHEDULER_H
+#define DJI_TX_SCHEDULER_H
+
+#include "dji_atomic.hpp"
+#include "dji_hard_driver.hpp"
+#include "dji_histogram.hpp"
+#include "dji_metrics.hpp"
+#include "dji_type.hpp"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+/*! @brief Admission control in front of the serial port
+ *
+ * @details Writes to the port only queue the bytes in the driver; once a
+ * bulk upload has queued a few kilobytes, a control frame written after it
+ * waits for all of them. A token bucket filled at the link rate (baud / 10
+ * bytes per second) and DEPTH bytes deep tracks how much is still queued.
+ *
+ * Real-time classes (emergency, control, ACK) are admitted at once and
+ * only charge the bucket. Bulk and mobile frames wait until no frame of a
+ * higher class is waiting and the bucket holds their length, so at most
+ * DEPTH bytes (one maximum size frame) of them are ever ahead of a control
+ * frame.
+ *
+ * Waiting needs threads: on STM32 admit() never blocks and only keeps the
+ * statistics.
+ */
+class TxScheduler
+{
+public:
+  typedef enum TxClass
+  {
+    TX_EMERGENCY, //! the emergency brake and stopping the motors
+    TX_CONTROL,   //! setpoints and the other flight actions
+    //! Only charged, on the repeat-ACK path in Protocol: a stored answer
+    //! sent again when the FC repeats its request. Nothing stores answers
+    //! (allocACK() has no callers), so it stays at zero for now
+    TX_ACK,
+    TX_BULK,      //! missions and every other command
+    TX_MOBILE,    //! data to the mobile SDK
+    TX_CLASS_COUNT
+  } TxClass;
+
+  //! One maximum size frame
+  static const uint32_t DEPTH = 1024;
+
+  typedef struct ClassStats
+  {
+    uint32_t frames;
+    uint64_t bytes;
+    uint64_t latencyP99; //! from send() to the write, in microseconds
+    uint64_t latencyMax;
+  } ClassStats;
+
+  TxScheduler();
+
+  //! @param bytesPerSecond 0 turns the budgeting off
+  void setLinkRate(uint32_t bytesPerSecond);
+
+  //! Flight action code of Control::FlightCommand::stopMotor
+  static const uint8_t TASK_STOP_MOTOR = 8;
+
+  /*!
+   * @brief Class of a command
+   * @param payload tells a stop-motor task from the other flight actions;
+   * without it a task is TX_CONTROL. The emergency brake is a
+   * Control::control frame, its sender passes TX_EMERGENCY itself.
+   */
+  static TxClass classify(uint8_t cmdSet, uint8_t cmdId,
+                          const uint8_t* payload = 0, size_t len = 0);
+  //! @param cmd buf holds cmd_set and cmd_id, then the payload
+  static TxClass classify(const Command& cmd);
+  static bool isRealTime(TxClass cls);
+
+  /*!
+   * @brief Wait until a frame of len bytes may be written, and charge it
+   * @note pair with release() once the frame is written or dropped
+   */
+  void admit(TxClass cls, uint32_t len, HardDriver* clock);
+  void release(TxClass cls, uint32_t len, time_us latency);
+  //! Charge and count a frame written without admission (retries,
+  //! repeated ACKs)
+  void charge(TxClass cls, uint32_t len, time_us now);
+
+  ClassStats getStats(TxClass cls) const;
+  void writeMetrics(MetricsWriter& writer) const;
+
+private:
+  TxScheduler(const TxScheduler&);
+  TxScheduler& operator=(const TxScheduler&);
+
+  //! @return microseconds until the bucket holds len bytes, 0 once charged
+  time_us tryTake(uint32_t len, time_us now, bool force);
+  void    lock();
+  void    unlock();
+
+  Atomic<uint32_t> bucketLock;
+  uint32_t         rate;   //! bytes per second
+  int64_t          tokens; //! bytes * 1e6, negative while in debt
+  time_us          refillTime;
+
+  Atomic<uint32_t> waiting[TX_CLASS_COUNT];
+  Atomic<uint32_t> frames[TX_CLASS_COUNT];
+  Atomic<uint64_t> bytes[TX_CLASS_COUNT];
+  Histogram        latency[TX_CLASS_COUNT];
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_TX_SCHEDULER_H
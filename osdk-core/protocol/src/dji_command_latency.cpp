@@ -0,0 +1,356 @@
+/** @file dji_command_latency.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Per-command round-trip latency statistics for the OPEN protocol
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_command_latency.hpp"
+#include "dji_log.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+const double CommandLatencyTable::BASELINE_WEIGHT = 0.2;
+
+CommandLatencyTable::CommandLatencyTable()
+  : reportPeriodMs(0)
+  , nextReport(0)
+  , driftRatio(0)
+  , alertCallback(0)
+  , alertUserData(0)
+{
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    entries[i].baselineP99 = 0;
+  }
+}
+
+CommandLatencyTable::Entry*
+CommandLatencyTable::find(uint8_t cmd_set, uint8_t cmd_id, bool create)
+{
+  uint32_t key   = 0x10000 | (cmd_set << 8) | cmd_id;
+  int      start = (cmd_set * 31 + cmd_id) % TABLE_SIZE;
+
+  for (int n = 0; n < TABLE_SIZE; n++)
+  {
+    Entry&   entry = entries[(start + n) % TABLE_SIZE];
+    uint32_t cur   = entry.key.load();
+    if (cur == key)
+    {
+      return &entry;
+    }
+    if (cur == 0)
+    {
+      if (!create)
+      {
+        return NULL;
+      }
+      uint32_t expected = 0;
+      if (entry.key.compareExchange(expected, key) || expected == key)
+      {
+        return &entry;
+      }
+    }
+  }
+  return NULL;
+}
+
+const CommandLatencyTable::Entry*
+CommandLatencyTable::find(uint8_t cmd_set, uint8_t cmd_id) const
+{
+  return const_cast<CommandLatencyTable*>(this)->find(cmd_set, cmd_id,
+                                                       false);
+}
+
+void
+CommandLatencyTable::recordQueueDelay(uint8_t cmd_set, uint8_t cmd_id,
+                                      time_us delay)
+{
+  Entry* entry = find(cmd_set, cmd_id, true);
+  if (entry)
+  {
+    entry->queue.record(delay);
+  }
+}
+
+void
+CommandLatencyTable::recordAck(uint8_t cmd_set, uint8_t cmd_id,
+                               time_us latency, uint32_t retries)
+{
+  Entry* entry = find(cmd_set, cmd_id, true);
+  if (entry)
+  {
+    entry->ack.record(latency);
+    entry->ackWindow.record(latency);
+    if (retries >= (uint32_t)CommandLatency::RETRY_BUCKETS)
+    {
+      retries = CommandLatency::RETRY_BUCKETS - 1;
+    }
+    entry->retries[retries].add(1);
+  }
+}
+
+void
+CommandLatencyTable::recordTimeout(uint8_t cmd_set, uint8_t cmd_id)
+{
+  Entry* entry = find(cmd_set, cmd_id, true);
+  if (entry)
+  {
+    entry->timeouts.add(1);
+  }
+}
+
+void
+CommandLatencyTable::fill(const Entry& entry, CommandLatency& out) const
+{
+  uint32_t key = entry.key.load();
+  out.cmd_set  = (key >> 8) & 0xFF;
+  out.cmd_id   = key & 0xFF;
+  out.acked    = entry.ack.getCount();
+  out.timeouts = entry.timeouts.loadRelaxed();
+  out.ackP50   = entry.ack.getPercentile(50);
+  out.ackP90   = entry.ack.getPercentile(90);
+  out.ackP99   = entry.ack.getPercentile(99);
+  out.ackMax   = entry.ack.getMax();
+  out.ackMean  = entry.ack.getMean();
+  out.queueP99 = entry.queue.getPercentile(99);
+  out.queueMax = entry.queue.getMax();
+  for (int i = 0; i < CommandLatency::RETRY_BUCKETS; i++)
+  {
+    out.retries[i] = entry.retries[i].loadRelaxed();
+  }
+}
+
+bool
+CommandLatencyTable::get(uint8_t cmd_set, uint8_t cmd_id,
+                         CommandLatency& out) const
+{
+  const Entry* entry = find(cmd_set, cmd_id);
+  if (entry == NULL)
+  {
+    return false;
+  }
+  fill(*entry, out);
+  return true;
+}
+
+int
+CommandLatencyTable::getAll(CommandLatency* out, int maxCount) const
+{
+  int n = 0;
+  for (int i = 0; i < TABLE_SIZE && n < maxCount; i++)
+  {
+    if (entries[i].key.load() != 0)
+    {
+      fill(entries[i], out[n++]);
+    }
+  }
+  return n;
+}
+
+void
+CommandLatencyTable::reset()
+{
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    entries[i].ack.reset();
+    entries[i].ackWindow.reset();
+    entries[i].queue.reset();
+    for (int j = 0; j < CommandLatency::RETRY_BUCKETS; j++)
+    {
+      entries[i].retries[j].storeRelaxed(0);
+    }
+    entries[i].timeouts.storeRelaxed(0);
+    entries[i].baselineP99 = 0;
+  }
+}
+
+void
+CommandLatencyTable::writeMetrics(MetricsWriter& writer) const
+{
+  static const double quantiles[] = { 0.5, 0.9, 0.99 };
+  char                labels[96];
+
+  writer.family("osdk_command_ack_latency_seconds", "summary",
+                "Time from the first write of a command to its ACK.");
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    const Entry& entry = entries[i];
+    uint32_t     key   = entry.key.load();
+    if (key == 0 || entry.ack.getCount() == 0)
+    {
+      continue;
+    }
+    for (int q = 0; q < 3; q++)
+    {
+      snprintf(labels, sizeof(labels),
+               "cmd_set=\"0x%02X\",cmd_id=\"0x%02X\",quantile=\"%g\"",
+               (key >> 8) & 0xFF, key & 0xFF, quantiles[q]);
+      writer.sample("osdk_command_ack_latency_seconds",
+                    entry.ack.getPercentile(quantiles[q] * 100) / 1e6,
+                    labels);
+    }
+    snprintf(labels, sizeof(labels), "cmd_set=\"0x%02X\",cmd_id=\"0x%02X\"",
+             (key >> 8) & 0xFF, key & 0xFF);
+    writer.sample("osdk_command_ack_latency_seconds_sum",
+                  entry.ack.getSum() / 1e6, labels);
+    writer.sample("osdk_command_ack_latency_seconds_count",
+                  (uint64_t)entry.ack.getCount(), labels);
+  }
+
+  writer.family("osdk_command_queue_delay_seconds", "summary",
+                "Time from send() to the first write of a command.");
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    const Entry& entry = entries[i];
+    uint32_t     key   = entry.key.load();
+    if (key == 0 || entry.queue.getCount() == 0)
+    {
+      continue;
+    }
+    snprintf(labels, sizeof(labels),
+             "cmd_set=\"0x%02X\",cmd_id=\"0x%02X\",quantile=\"0.99\"",
+             (key >> 8) & 0xFF, key & 0xFF);
+    writer.sample("osdk_command_queue_delay_seconds",
+                  entry.queue.getPercentile(99) / 1e6, labels);
+    snprintf(labels, sizeof(labels), "cmd_set=\"0x%02X\",cmd_id=\"0x%02X\"",
+             (key >> 8) & 0xFF, key & 0xFF);
+    writer.sample("osdk_command_queue_delay_seconds_sum",
+                  entry.queue.getSum() / 1e6, labels);
+    writer.sample("osdk_command_queue_delay_seconds_count",
+                  (uint64_t)entry.queue.getCount(), labels);
+  }
+
+  writer.family("osdk_command_retries_total", "counter",
+                "ACKed commands by number of retransmissions needed.");
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    const Entry& entry = entries[i];
+    uint32_t     key   = entry.key.load();
+    if (key == 0)
+    {
+      continue;
+    }
+    for (int j = 0; j < CommandLatency::RETRY_BUCKETS; j++)
+    {
+      uint32_t n = entry.retries[j].loadRelaxed();
+      if (n)
+      {
+        snprintf(labels, sizeof(labels),
+                 "cmd_set=\"0x%02X\",cmd_id=\"0x%02X\",retries=\"%d%s\"",
+                 (key >> 8) & 0xFF, key & 0xFF, j,
+                 j == CommandLatency::RETRY_BUCKETS - 1 ? "+" : "");
+        writer.sample("osdk_command_retries_total", (uint64_t)n, labels);
+      }
+    }
+  }
+
+  writer.family("osdk_command_timeouts_total", "counter",
+                "Commands that never got an ACK.");
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    const Entry& entry = entries[i];
+    uint32_t     key   = entry.key.load();
+    if (key == 0 || entry.timeouts.loadRelaxed() == 0)
+    {
+      continue;
+    }
+    snprintf(labels, sizeof(labels), "cmd_set=\"0x%02X\",cmd_id=\"0x%02X\"",
+             (key >> 8) & 0xFF, key & 0xFF);
+    writer.sample("osdk_command_timeouts_total",
+                  (uint64_t)entry.timeouts.loadRelaxed(), labels);
+  }
+}
+
+void
+CommandLatencyTable::setReportPeriod(uint32_t periodMs)
+{
+  reportPeriodMs = periodMs;
+  nextReport     = 0;
+}
+
+void
+CommandLatencyTable::setDriftAlert(double ratio, LatencyAlertCallback callback,
+                                   UserData userData)
+{
+  driftRatio    = ratio;
+  alertCallback = callback;
+  alertUserData = userData;
+}
+
+void
+CommandLatencyTable::poll(time_us now)
+{
+  if (reportPeriodMs == 0)
+  {
+    return;
+  }
+  if (nextReport == 0)
+  {
+    nextReport = now + (time_us)reportPeriodMs * 1000;
+    return;
+  }
+  if (now < nextReport)
+  {
+    return;
+  }
+  nextReport = now + (time_us)reportPeriodMs * 1000;
+  report();
+}
+
+void
+CommandLatencyTable::report()
+{
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    Entry&   entry = entries[i];
+    uint32_t key   = entry.key.load();
+    if (key == 0)
+    {
+      continue;
+    }
+
+    CommandLatency stats;
+    fill(entry, stats);
+    DSTATUS("cmd 0x%02X/0x%02X: %u acked, %u timeouts, ack p50 %llu p99 %llu "
+            "max %llu us, queue p99 %llu us\n",
+            stats.cmd_set, stats.cmd_id, stats.acked, stats.timeouts,
+            (unsigned long long)stats.ackP50, (unsigned long long)stats.ackP99,
+            (unsigned long long)stats.ackMax,
+            (unsigned long long)stats.queueP99);
+
+    if (entry.ackWindow.getCount() < (uint32_t)MIN_WINDOW_SAMPLES)
+    {
+      continue;
+    }
+    uint64_t p99 = entry.ackWindow.getPercentile(99);
+    entry.ackWindow.reset();
+
+    if (entry.baselineP99 == 0)
+    {
+      entry.baselineP99 = p99;
+      continue;
+    }
+    if (driftRatio > 0 && p99 > entry.baselineP99 * (1.0 + driftRatio))
+    {
+      DSTATUS("cmd 0x%02X/0x%02X: p99 drifted to %llu us, baseline %llu us\n",
+              stats.cmd_set, stats.cmd_id, (unsigned long long)p99,
+              (unsigned long long)entry.baselineP99);
+      if (alertCallback)
+      {
+        alertCallback(stats.cmd_set, stats.cmd_id, p99, entry.baselineP99,
+                      alertUserData);
+      }
+    }
+    entry.baselineP99 = (uint64_t)(entry.baselineP99 * (1 - BASELINE_WEIGHT) +
+                                   p99 * BASELINE_WEIGHT);
+  }
+}
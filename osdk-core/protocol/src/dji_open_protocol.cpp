@@ -9,10 +9,9 @@
  *
  */
 #include "dji_open_protocol.hpp"
+#include "dji_trace.hpp"
 
-#ifdef STM32
 #include <stdio.h>
-#endif
 
 using namespace DJI;
 using namespace DJI::OSDK;
@@ -49,6 +48,8 @@ Protocol::Protocol(const char* device, uint32_t baudrate)
   this->serialDevice->init();
 #endif
   this->threadHandle->init();
+  this->byteTimeNs = baudrate ? (uint32_t)(10000000000ULL / baudrate) : 0;
+  txScheduler.setLinkRate(baudrate / 10);
 
   //! Step 2: Initialize the ProtocolLayer
   init(this->serialDevice, this->serialDevice->getMmu());
@@ -87,6 +88,9 @@ Protocol::init(HardDriver* sDevice, MMU* mmuPtr, bool userCallbackThread)
   mmu          = mmuPtr;
   buf_read_pos = 0;
   read_len     = 0;
+  readTime     = 0;
+  prevReadTime = 0;
+  rxChunk      = false;
 
   setup();
 }
@@ -135,6 +139,7 @@ Protocol::allocSession(uint16_t session_id, uint16_t size)
     {
       /* session is busy */
       DERROR("session %d is busy\n", session_id);
+      counters.sessionAllocFailures.add(1);
       return NULL;
     }
   }
@@ -156,6 +161,7 @@ Protocol::allocSession(uint16_t session_id, uint16_t size)
       return &CMDSessionTab[i];
     }
   }
+  counters.sessionAllocFailures.add(1);
   return NULL;
 }
 
@@ -270,16 +276,354 @@ Protocol::send(Command* cmdContainer)
   sendInterface(cmdContainer);
 }
 
+bool
+Protocol::prepare(FrameTemplate* frame, bool is_enc, const uint8_t cmd[],
+                  size_t len)
+{
+  if (len + SET_CMD_SIZE > PRO_PURE_DATA_MAX_SIZE)
+  {
+    DERROR("ERROR,length=%lu is over-sized\n", len);
+    frame->length = 0;
+    return false;
+  }
+
+  uint16_t w_len  = static_cast<uint16_t>(len + SET_CMD_SIZE);
+  Header*  p_head = (Header*)frame->header;
+
+  memset(frame->header, 0, sizeof(frame->header));
+  p_head->sof       = Protocol::SOF;
+  p_head->length    = calculateLength(w_len, is_enc);
+  p_head->sessionID = CMD_SESSION_0;
+  p_head->padding   = is_enc ? (16 - w_len % 16) : 0;
+  p_head->enc       = is_enc ? 1 : 0;
+
+  frame->cmd_set     = cmd[0];
+  frame->cmd_id      = cmd[1];
+  frame->encrypt     = is_enc ? 1 : 0;
+  frame->payloadLen  = static_cast<uint16_t>(len);
+  frame->crc16Prefix = sdk_stream_crc16_calc(frame->header, SeqOffset);
+  frame->crc32Prefix = sdk_stream_crc32_calc(frame->header, SeqOffset);
+  frame->length      = p_head->length;
+  return true;
+}
+
+int
+Protocol::sendPrepared(const FrameTemplate* frame, const void* pdata)
+{
+  return sendPrepared(frame, pdata,
+                      TxScheduler::classify(frame->cmd_set, frame->cmd_id));
+}
+
+int
+Protocol::sendPrepared(const FrameTemplate* frame, const void* pdata,
+                       TxScheduler::TxClass txClass)
+{
+  time_us     enqueued = serialDevice->getTimeStampUs();
+  CMDSession* cmdSession;
+  time_us     written;
+  int         ret = 0;
+
+  if (frame->length == 0)
+  {
+    DERROR("frame template is not prepared\n");
+    return -1;
+  }
+
+  txScheduler.admit(txClass, frame->length, serialDevice);
+
+  threadHandle->lockMemory();
+  cmdSession = allocSession(CMD_SESSION_0, frame->length);
+  if (cmdSession == (CMDSession*)NULL)
+  {
+    DERROR("ERROR,there is not enough memory\n");
+    ret = -1;
+  }
+  else if (encodePrepared(cmdSession->mmu->pmem, frame, pdata, seq_num) == 0)
+  {
+    freeSession(cmdSession);
+    ret = -1;
+  }
+  else
+  {
+    written = serialDevice->getTimeStampUs();
+    latency.recordQueueDelay(frame->cmd_set, frame->cmd_id,
+                             written - enqueued);
+    sendData(cmdSession->mmu->pmem);
+    seq_num++;
+    freeSession(cmdSession);
+  }
+  threadHandle->freeMemory();
+
+  txScheduler.release(txClass, frame->length,
+                      serialDevice->getTimeStampUs() - enqueued);
+  return ret;
+}
+
+int
+Protocol::sendPrepared(FrameTemplate* frame, bool is_enc, const uint8_t cmd[],
+                       const void* pdata, size_t len,
+                       TxScheduler::TxClass txClass)
+{
+  if (frame->length == 0 || frame->cmd_set != cmd[0] ||
+      frame->cmd_id != cmd[1] || frame->payloadLen != len ||
+      frame->encrypt != (is_enc ? 1 : 0))
+  {
+    if (!prepare(frame, is_enc, cmd, len))
+    {
+      return -1;
+    }
+  }
+  if (txClass == TxScheduler::TX_CLASS_COUNT)
+  {
+    return sendPrepared(frame, pdata);
+  }
+  return sendPrepared(frame, pdata, txClass);
+}
+
+int
+Protocol::sendBurst(const Command* cmds, int count, BurstResult* result)
+{
+  time_us     enqueued = serialDevice->getTimeStampUs();
+  CMDSession* sessions[MAX_BURST_FRAMES];
+  uint32_t    total    = 0;
+  int         reserved = 0;
+  uint16_t    offset   = 0;
+  time_us     locked;
+  time_us     written;
+  time_us     done;
+  size_t      ans;
+  int         i;
+
+  if (result)
+  {
+    memset(result, 0, sizeof(BurstResult));
+  }
+  if (count <= 0 || count > MAX_BURST_FRAMES)
+  {
+    DERROR("ERROR,burst of %d commands, at most %d\n", count,
+           MAX_BURST_FRAMES);
+    return -1;
+  }
+
+  TxScheduler::TxClass txClass  = TxScheduler::TX_MOBILE;
+  int                  session1 = 0;
+  for (i = 0; i < count; i++)
+  {
+    if (cmds[i].length > PRO_PURE_DATA_MAX_SIZE || cmds[i].sessionMode > 2)
+    {
+      DERROR("ERROR,burst command %d is not valid\n", i);
+      return -1;
+    }
+    if (cmds[i].sessionMode == 1 && ++session1 > 1)
+    {
+      DERROR("ERROR,a burst takes at most one session 1 command\n");
+      return -1;
+    }
+    total += calculateLength(cmds[i].length, cmds[i].encrypt);
+    TxScheduler::TxClass cls = TxScheduler::classify(cmds[i]);
+    if (cls < txClass)
+    {
+      txClass = cls;
+    }
+  }
+  if (total > BURST_BUFFER_SIZE)
+  {
+    DERROR("ERROR,burst of %u bytes is over-sized\n", total);
+    return -1;
+  }
+
+  txScheduler.admit(txClass, total, serialDevice);
+
+  threadHandle->lockMemory();
+  locked = serialDevice->getTimeStampUs();
+
+  //! Reserve every session first, so the burst goes out whole or not at all
+  for (; reserved < count; reserved++)
+  {
+    const Command& cmd = cmds[reserved];
+    sessions[reserved] = (CMDSession*)NULL;
+    if (cmd.sessionMode != 0)
+    {
+      sessions[reserved] = allocSession(
+        cmd.sessionMode == 1 ? CMD_SESSION_1 : CMD_SESSION_AUTO,
+        calculateLength(cmd.length, cmd.encrypt));
+      if (sessions[reserved] == (CMDSession*)NULL)
+      {
+        DERROR("ERROR,no session for burst command %d\n", reserved);
+        break;
+      }
+    }
+  }
+
+  for (i = 0; reserved == count && i < count; i++)
+  {
+    const Command& cmd     = cmds[i];
+    CMDSession*    session = sessions[i];
+    uint8_t*       pdest   = encodeBurst + offset;
+
+    if (session && seq_num == session->preSeqNum)
+    {
+      seq_num++;
+    }
+    uint16_t len = encrypt(pdest, cmd.buf, cmd.length, 0, cmd.encrypt,
+                           session ? session->sessionID : CMD_SESSION_0,
+                           seq_num);
+    if (len == 0)
+    {
+      DERROR("encrypt ERROR\n");
+      break;
+    }
+    offset += len;
+
+    if (session)
+    {
+      //! sendPoll() retransmits from the session's own copy
+      memcpy(session->mmu->pmem, pdest, len);
+      session->preSeqNum  = seq_num;
+      session->cmd_set    = cmd.cmd_set;
+      session->cmd_id     = cmd.cmd_id;
+      session->txClass    = TxScheduler::classify(cmd);
+      session->buf        = cmd.buf;
+      session->isCallback = cmd.isCallback;
+      session->callbackID = cmd.callbackID;
+      session->timeout =
+        rto.initialTimeout(cmd.cmd_set, cmd.cmd_id, cmd.timeout);
+      if (session->timeout < POLL_TICK)
+        session->timeout = POLL_TICK;
+      session->sent  = 1;
+      session->retry = cmd.sessionMode == 1 ? 1 : cmd.retry;
+    }
+    seq_num++;
+  }
+
+  if (i < count)
+  {
+    for (int j = 0; j < reserved; j++)
+    {
+      if (sessions[j])
+      {
+        freeSession(sessions[j]);
+      }
+    }
+    threadHandle->freeMemory();
+    txScheduler.release(txClass, total,
+                        serialDevice->getTimeStampUs() - enqueued);
+    return -1;
+  }
+
+  written = serialDevice->getTimeStampUs();
+  for (i = 0, offset = 0; i < count; i++)
+  {
+    if (sessions[i])
+    {
+      sessions[i]->preTimestamp  = serialDevice->getTimeStamp();
+      sessions[i]->sendTimestamp = written;
+    }
+    latency.recordQueueDelay(cmds[i].cmd_set, cmds[i].cmd_id,
+                             written - enqueued);
+    traceSend(encodeBurst + offset);
+    offset += ((Header*)(encodeBurst + offset))->length;
+  }
+
+  ans  = serialDevice->send(encodeBurst, offset);
+  done = serialDevice->getTimeStampUs();
+  if (ans == (size_t)-1)
+  {
+    DERROR("Port closed");
+    ans = 0;
+  }
+  else if (ans == 0)
+  {
+    DSTATUS("Port did not take the burst");
+  }
+  else if (ans < offset)
+  {
+    //! ACKed commands are still retried by sendPoll()
+    DSTATUS("Port sent %lu of %u burst bytes", ans, offset);
+  }
+
+  //! Frames that made it out whole
+  int      sent = 0;
+  uint16_t end  = 0;
+  while (sent < count)
+  {
+    uint16_t len = ((Header*)(encodeBurst + end))->length;
+    if (end + len > ans)
+    {
+      break;
+    }
+    end += len;
+    sent++;
+  }
+  counters.bytesOut.add(ans);
+  counters.framesSent.add(sent);
+  for (i = sent; i < count; i++)
+  {
+    if (sessions[i] == (CMDSession*)NULL)
+    {
+      counters.framesDropped.add(1);
+    }
+  }
+  threadHandle->freeMemory();
+
+  //! A driver with a TX ring returned before the line; its writer measures
+  uint64_t      wireNs = (uint64_t)offset * byteTimeNs;
+  uint64_t      gapNs  = 0;
+  SerialTxStats txStats;
+  if (sent == count && count > 1 && (done - written) * 1000 > wireNs &&
+      !serialDevice->getSerialTxStats(txStats))
+  {
+    gapNs = ((done - written) * 1000 - wireNs) / (count - 1);
+  }
+  if (gapNs > 0xFFFFFFFF)
+  {
+    gapNs = 0xFFFFFFFF;
+  }
+  counters.bursts.add(1);
+  counters.burstGapMaxNs.max((uint32_t)gapNs);
+
+  if (result)
+  {
+    result->frames     = sent;
+    result->bytes      = (uint16_t)ans;
+    result->encodeTime = written - locked;
+    result->writeTime  = done - written;
+    result->wireTimeNs = wireNs > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)wireNs;
+    result->gapNs      = (uint32_t)gapNs;
+  }
+
+  txScheduler.release(txClass, total,
+                      serialDevice->getTimeStampUs() - enqueued);
+  return sent == count ? 0 : -1;
+}
+
 int
 Protocol::sendInterface(Command* cmdContainer)
 {
-  uint16_t    ret        = 0;
-  CMDSession* cmdSession = (CMDSession*)NULL;
+  time_us enqueued = serialDevice->getTimeStampUs();
   if (cmdContainer->length > PRO_PURE_DATA_MAX_SIZE)
   {
     DERROR("ERROR,length=%lu is over-sized\n", cmdContainer->length);
     return -1;
   }
+
+  TxScheduler::TxClass txClass = TxScheduler::classify(*cmdContainer);
+  uint16_t frameLen =
+    calculateLength(cmdContainer->length, cmdContainer->encrypt);
+
+  txScheduler.admit(txClass, frameLen, serialDevice);
+  int ret = sendFrame(cmdContainer, enqueued);
+  txScheduler.release(txClass, frameLen,
+                      serialDevice->getTimeStampUs() - enqueued);
+  return ret;
+}
+
+int
+Protocol::sendFrame(Command* cmdContainer, time_us enqueued)
+{
+  uint16_t    ret        = 0;
+  CMDSession* cmdSession = (CMDSession*)NULL;
+  time_us     written;
   /*! Switch on session to decide whether the command is requesting an ACK and
    * whether it is requesting
    *  guarantees on transmission
@@ -315,6 +659,9 @@ Protocol::sendInterface(Command* cmdContainer)
       DDEBUG("send data in session mode 0\n");
 
       //! Actually send the data
+      written = serialDevice->getTimeStampUs();
+      latency.recordQueueDelay(cmdContainer->cmd_set, cmdContainer->cmd_id,
+                               written - enqueued);
       sendData(cmdSession->mmu->pmem);
       seq_num++;
       freeSession(cmdSession);
@@ -348,16 +695,25 @@ Protocol::sendInterface(Command* cmdContainer)
         return -1;
       }
       cmdSession->preSeqNum = seq_num++;
+      cmdSession->cmd_set   = cmdContainer->cmd_set;
+      cmdSession->cmd_id    = cmdContainer->cmd_id;
+      cmdSession->txClass   = TxScheduler::classify(*cmdContainer);
 
       //@todo replace with a bool
       cmdSession->isCallback = cmdContainer->isCallback;
       cmdSession->callbackID = cmdContainer->callbackID;
-      cmdSession->timeout =
-        (cmdContainer->timeout > POLL_TICK) ? cmdContainer->timeout : POLL_TICK;
+      cmdSession->timeout = rto.initialTimeout(
+        cmdContainer->cmd_set, cmdContainer->cmd_id, cmdContainer->timeout);
+      if (cmdSession->timeout < POLL_TICK)
+        cmdSession->timeout = POLL_TICK;
       cmdSession->preTimestamp = serialDevice->getTimeStamp();
       cmdSession->sent         = 1;
       cmdSession->retry        = 1;
       DDEBUG("sending session %d\n", cmdSession->sessionID);
+      written                   = serialDevice->getTimeStampUs();
+      cmdSession->sendTimestamp = written;
+      latency.recordQueueDelay(cmdContainer->cmd_set, cmdContainer->cmd_id,
+                               written - enqueued);
       sendData(cmdSession->mmu->pmem);
       threadHandle->freeMemory();
       break;
@@ -393,6 +749,7 @@ Protocol::sendInterface(Command* cmdContainer)
       // To use in ErrorCode manager
       cmdSession->cmd_set = cmdContainer->cmd_set;
       cmdSession->cmd_id  = cmdContainer->cmd_id;
+      cmdSession->txClass = TxScheduler::classify(*cmdContainer);
       // Will carry information: obtain/release control
       cmdSession->buf = cmdContainer->buf;
 
@@ -400,12 +757,18 @@ Protocol::sendInterface(Command* cmdContainer)
       //@todo replace with a bool
       cmdSession->isCallback = cmdContainer->isCallback;
       cmdSession->callbackID = cmdContainer->callbackID;
-      cmdSession->timeout =
-        (cmdContainer->timeout > POLL_TICK) ? cmdContainer->timeout : POLL_TICK;
+      cmdSession->timeout = rto.initialTimeout(
+        cmdContainer->cmd_set, cmdContainer->cmd_id, cmdContainer->timeout);
+      if (cmdSession->timeout < POLL_TICK)
+        cmdSession->timeout = POLL_TICK;
       cmdSession->preTimestamp = serialDevice->getTimeStamp();
       cmdSession->sent         = 1;
       cmdSession->retry        = cmdContainer->retry;
       DDEBUG("Sending session %d\n", cmdSession->sessionID);
+      written                   = serialDevice->getTimeStampUs();
+      cmdSession->sendTimestamp = written;
+      latency.recordQueueDelay(cmdContainer->cmd_set, cmdContainer->cmd_id,
+                               written - enqueued);
       sendData(cmdSession->mmu->pmem);
       threadHandle->freeMemory();
       break;
@@ -416,22 +779,53 @@ Protocol::sendInterface(Command* cmdContainer)
   return 0;
 }
 
+void
+Protocol::traceSend(const uint8_t* buf)
+{
+  const Header* pHeader = (const Header*)buf;
+
+#ifdef API_TRACE_DATA
+  printFrame(serialDevice, (Header*)pHeader, true);
+#endif
+
+  //! The cmd pair is only readable in clear, unencrypted command frames
+  if (pHeader->isAck == 0 && pHeader->enc == 0)
+  {
+    OSDK_TRACE(frame_send, buf[sizeof(Header)], buf[sizeof(Header) + 1],
+               pHeader->sessionID, pHeader->sequenceNumber, pHeader->length);
+  }
+  else
+  {
+    OSDK_TRACE(frame_send, -1, -1, pHeader->sessionID,
+               pHeader->sequenceNumber, pHeader->length);
+  }
+}
+
 void
 Protocol::sendData(uint8_t* buf)
 {
   size_t  ans;
   Header* pHeader = (Header*)buf;
 
-#ifdef API_TRACE_DATA
-  printFrame(serialDevice, pHeader, true);
-#endif
+  traceSend(buf);
 
   //! Serial Device call: last link in the send pipeline
   ans = serialDevice->send(buf, pHeader->length);
   if (ans == 0)
+  {
     DSTATUS("Port did not send");
-  if (ans == (size_t)-1)
+    counters.framesDropped.add(1);
+  }
+  else if (ans == (size_t)-1)
+  {
     DERROR("Port closed");
+    counters.framesDropped.add(1);
+  }
+  else
+  {
+    counters.bytesOut.add(ans);
+    counters.framesSent.add(1);
+  }
 }
 
 //! Session management for the send pipeline: Poll
@@ -457,18 +851,32 @@ Protocol::sendPoll()
             DSTATUS("Sending timeout, Free session %d\n",
                     CMDSessionTab[i].sessionID);
             freeSession(&CMDSessionTab[i]);
+            counters.sessionTimeouts.add(1);
+            latency.recordTimeout(CMDSessionTab[i].cmd_set,
+                                  CMDSessionTab[i].cmd_id);
+            rto.recordTimeout(CMDSessionTab[i].cmd_set,
+                              CMDSessionTab[i].cmd_id);
           }
           else
           {
             DDEBUG("Retry session %d\n", CMDSessionTab[i].sessionID);
+            txScheduler.charge(
+              (TxScheduler::TxClass)CMDSessionTab[i].txClass,
+              ((Header*)CMDSessionTab[i].mmu->pmem)->length,
+              serialDevice->getTimeStampUs());
             sendData(CMDSessionTab[i].mmu->pmem);
             CMDSessionTab[i].preTimestamp = curTimestamp;
+            CMDSessionTab[i].timeout = rto.backoff(CMDSessionTab[i].timeout);
             CMDSessionTab[i].sent++;
+            counters.sessionRetransmissions[i].add(1);
           }
         }
         else
         {
           DDEBUG("Send once %d\n", i);
+          txScheduler.charge((TxScheduler::TxClass)CMDSessionTab[i].txClass,
+                             ((Header*)CMDSessionTab[i].mmu->pmem)->length,
+                             serialDevice->getTimeStampUs());
           sendData(CMDSessionTab[i].mmu->pmem);
           CMDSessionTab[i].preTimestamp = curTimestamp;
         }
@@ -494,10 +902,13 @@ Protocol::receive()
   //! the stack
   RecvContainer receiveFrame;
   receiveFrame.recvInfo.cmd_id = 0xFF;
+  receiveFrame.recvTime        = 0;
 
   //! Run the readPoll until you get a true
   // @todo might need to modify to include thread stopCond
   while (!readPoll(&receiveFrame));
+
+  latency.poll(serialDevice->getTimeStampUs());
   //! When we receive a true, return a copy of container to the caller: this is
   //! the 'receive' interface
 
@@ -517,6 +928,8 @@ Protocol::readPoll(RecvContainer* allocatedFramePtr)
 
     this->buf_read_pos = 0;
     this->read_len     = serialDevice->readall(this->buf, BUFFER_SIZE);
+    this->prevReadTime = this->readTime;
+    this->readTime     = serialDevice->getTimeStampUs();
   }
 
 #ifdef API_BUFFER_DATA
@@ -527,15 +940,18 @@ Protocol::readPoll(RecvContainer* allocatedFramePtr)
   //! Step 2: Go through the buffer and return when you see a full frame.
   //! buf_read_pos will maintain state about how much buffer data we have
   //! already read
+  rxChunk = true;
   for (this->buf_read_pos; this->buf_read_pos < this->read_len;
        this->buf_read_pos++)
   {
     isFrame = byteHandler(buf[this->buf_read_pos], allocatedFramePtr);
     if (isFrame)
     {
+      rxChunk = false;
       return isFrame;
     }
   }
+  rxChunk = false;
 
   //! Step 3: If we don't find a full frame by this time, return false.
   //! The receive function calls readPoll in a loop, so if it returns false
@@ -543,12 +959,26 @@ Protocol::readPoll(RecvContainer* allocatedFramePtr)
   return isFrame;
 }
 
+time_us
+Protocol::rxTime() const
+{
+  if (!rxChunk)
+  {
+    return serialDevice->getTimeStampUs();
+  }
+  //! Never before the previous chunk was read, the bytes were still queued
+  time_us behind = (time_us)(read_len - 1 - buf_read_pos) * byteTimeNs / 1000;
+  time_us start  = readTime > behind ? readTime - behind : 0;
+  return start > prevReadTime ? start : prevReadTime;
+}
+
 //! Step 2
 bool
 Protocol::byteHandler(const uint8_t in_data, RecvContainer* allocatedFramePtr)
 {
   filter.reuseCount = 0;
   filter.reuseIndex = Protocol::maxRecv;
+  counters.bytesIn.add(1);
 
   RecvContainer* recvDataPtr;
   //! Bool to check if the protocol parser has finished a full frame
@@ -618,6 +1048,7 @@ Protocol::storeData(SDKFilter* p_filter, uint8_t in_data)
   else
   {
     DERROR("buffer overflow");
+    counters.bufferOverflows.add(1);
     memset(p_filter->recvBuf, 0, p_filter->recvIndex);
     p_filter->recvIndex = 0;
   }
@@ -668,6 +1099,12 @@ Protocol::verifyHead(SDKFilter* p_filter, RecvContainer* allocatedRecvObject)
   }
   else
   {
+    if (p_head->sof == Protocol::SOF &&
+        _SDK_CALC_CRC_HEAD(p_head, sizeof(Header)) != 0)
+    {
+      counters.headerCRCErrors.add(1);
+    }
+    counters.resyncBytes.add(1);
     sdk_stream_shift_data_lambda(p_filter);
   }
   return isFrame;
@@ -689,6 +1126,8 @@ Protocol::verifyData(SDKFilter* p_filter, RecvContainer* allocatedRecvObject)
   else
   {
     //! @note data crc fail, re-use the data part
+    counters.dataCRCErrors.add(1);
+    counters.resyncBytes.add(1);
     sdk_stream_update_reuse_part_lambda(p_filter);
   }
   return isFrame;
@@ -701,8 +1140,13 @@ Protocol::callApp(SDKFilter* p_filter, RecvContainer* allocatedRecvObject)
   // pass current data to handler
   Header* p_head = (Header*)p_filter->recvBuf;
 
+  counters.framesParsed.add(1);
   encodeData(p_filter, p_head, aes256_decrypt_ecb);
   bool isFrame = appHandler((Header*)p_filter->recvBuf, allocatedRecvObject);
+  if (isFrame)
+  {
+    allocatedRecvObject->recvTime = rxTime();
+  }
   sdk_stream_prepare_lambda(p_filter);
 
   return isFrame;
@@ -738,6 +1182,13 @@ Protocol::appHandler(Header* protocolHeader, RecvContainer* allocatedRecvObject)
         {
           DDEBUG("Recv Session %d ACK\n", p2protocolHeader->sessionID);
 
+          CMDSession* session = &CMDSessionTab[protocolHeader->sessionID];
+          time_us     rtt     = rxTime() - session->sendTimestamp;
+          latency.recordAck(session->cmd_set, session->cmd_id, rtt,
+                            session->sent - 1);
+          rto.recordAck(session->cmd_set, session->cmd_id, rtt,
+                        session->sent - 1);
+
           //! Create receive container for error code management
           allocatedRecvObject->dispatchInfo.isAck = true;
           allocatedRecvObject->recvInfo.cmd_set =
@@ -754,6 +1205,8 @@ Protocol::appHandler(Header* protocolHeader, RecvContainer* allocatedRecvObject)
           allocatedRecvObject->recvInfo.seqNumber =
             protocolHeader->sequenceNumber;
           allocatedRecvObject->recvInfo.len = protocolHeader->length;
+          allocatedRecvObject->dispatchInfo.sessionID =
+            protocolHeader->sessionID;
           //! Set bool
           isFrame = true;
 
@@ -817,6 +1270,8 @@ Protocol::appHandler(Header* protocolHeader, RecvContainer* allocatedRecvObject)
             DDEBUG("Repeat ACK to remote,session "
                    "id=%d,seq_num=%d\n",
                    protocolHeader->sessionID, protocolHeader->sequenceNumber);
+            txScheduler.charge(TxScheduler::TX_ACK, p2protocolHeader->length,
+                               serialDevice->getTimeStampUs());
             sendData(ACKSessionTab[protocolHeader->sessionID - 1].mmu->pmem);
             threadHandle->freeMemory();
           }
@@ -835,6 +1290,11 @@ Protocol::appHandler(Header* protocolHeader, RecvContainer* allocatedRecvObject)
         break;
     }
   }
+
+  if (isFrame)
+  {
+    OSDK_TRACE_RECV(frame_recv, *allocatedRecvObject);
+  }
   return isFrame;
 }
 
@@ -896,6 +1356,9 @@ Protocol::recvReqData(Header*        protocolHeader,
   allocatedRecvObject->recvInfo.cmd_set = getCmdSet(protocolHeader);
   allocatedRecvObject->recvInfo.cmd_id  = getCmdCode(protocolHeader);
   allocatedRecvObject->recvInfo.len     = protocolHeader->length;
+  allocatedRecvObject->recvInfo.seqNumber =
+    (uint8_t)protocolHeader->sequenceNumber;
+  allocatedRecvObject->dispatchInfo.sessionID = protocolHeader->sessionID;
   //@todo: Please monitor to make sure the length is correct
   memcpy(allocatedRecvObject->recvData.raw_ack_array, payload,
          ((protocolHeader->length) - (Protocol::PackageMin + 2)));
@@ -1172,6 +1635,54 @@ Protocol::encrypt(uint8_t* pdest, const uint8_t* psrc, uint16_t w_len,
   return data_len;
 }
 
+uint16_t
+Protocol::encodePrepared(uint8_t* pdest, const FrameTemplate* frame,
+                         const void* pdata, uint16_t seq_num)
+{
+  Header*  p_head = (Header*)pdest;
+  uint8_t* p_body = pdest + sizeof(Header);
+  uint16_t w_len  = frame->payloadLen + SET_CMD_SIZE;
+  uint16_t crc16  = frame->crc16Prefix;
+  uint32_t crc32  = frame->crc32Prefix;
+  uint32_t index_of_crc32;
+  uint32_t i;
+
+  if (filter.encode == 0 && frame->encrypt)
+  {
+    DERROR("Can not send encode data, Please activate your device to get an "
+           "available key.\n");
+    return 0;
+  }
+
+  memcpy(pdest, frame->header, sizeof(Header));
+  p_head->sequenceNumber = seq_num;
+
+  p_body[0] = frame->cmd_set;
+  p_body[1] = frame->cmd_id;
+  memcpy(p_body + SET_CMD_SIZE, pdata, frame->payloadLen);
+  if (frame->encrypt)
+  {
+    memset(p_body + w_len, 0, p_head->padding);
+    encodeData(&filter, p_head, aes256_encrypt_ecb);
+  }
+
+  //! Continue both CRCs from the end of the constant header bytes
+  for (i = SeqOffset; i < (uint32_t)Protocol::CRCHeadLen; i++)
+  {
+    crc16 = crc16_update(crc16, pdest[i]);
+  }
+  p_head->crc = crc16;
+
+  index_of_crc32 = frame->length - Protocol::CRCData;
+  for (i = SeqOffset; i < index_of_crc32; i++)
+  {
+    crc32 = crc32_update(crc32, pdest[i]);
+  }
+  _SDK_U32_SET(pdest + index_of_crc32, crc32);
+
+  return frame->length;
+}
+
 /*********************************Getters/Setters***********************************/
 
 HardDriver*
@@ -1205,3 +1716,197 @@ Protocol::setKey(const char* key)
   transformTwoByte(key, filter.sdkKey);
   filter.encode = 1;
 }
+
+/*********************************Link health***********************************/
+
+LinkStats
+Protocol::getLinkStats() const
+{
+  LinkStats stats;
+
+  stats.bytesIn         = counters.bytesIn.loadRelaxed();
+  stats.bytesOut        = counters.bytesOut.loadRelaxed();
+  stats.framesParsed    = counters.framesParsed.loadRelaxed();
+  stats.framesSent      = counters.framesSent.loadRelaxed();
+  stats.framesDropped   = counters.framesDropped.loadRelaxed();
+  stats.headerCRCErrors = counters.headerCRCErrors.loadRelaxed();
+  stats.dataCRCErrors   = counters.dataCRCErrors.loadRelaxed();
+  stats.resyncBytes     = counters.resyncBytes.loadRelaxed();
+  stats.bufferOverflows = counters.bufferOverflows.loadRelaxed();
+
+  stats.retransmissions = 0;
+  for (size_t i = 0; i < SESSION_TABLE_NUM; i++)
+  {
+    stats.sessionRetransmissions[i] =
+      counters.sessionRetransmissions[i].loadRelaxed();
+    stats.retransmissions += stats.sessionRetransmissions[i];
+  }
+  stats.sessionTimeouts      = counters.sessionTimeouts.loadRelaxed();
+  stats.sessionAllocFailures = counters.sessionAllocFailures.loadRelaxed();
+  stats.bursts               = counters.bursts.loadRelaxed();
+  stats.burstGapMaxNs        = counters.burstGapMaxNs.loadRelaxed();
+
+  stats.mmuHighWater = mmu->getHighWaterMark();
+  stats.mmuSize      = MMU::MEMORY_SIZE;
+
+  memset(&stats.serial, 0, sizeof(stats.serial));
+  stats.serialStatsValid = serialDevice->getSerialErrorStats(stats.serial);
+  memset(&stats.serialTx, 0, sizeof(stats.serialTx));
+  stats.serialTxStatsValid = serialDevice->getSerialTxStats(stats.serialTx);
+  if (stats.serialTxStatsValid &&
+      stats.serialTx.gapMaxNs > stats.burstGapMaxNs)
+  {
+    //! Bursts drain through the ring, whose writer sees the real gaps
+    stats.burstGapMaxNs = stats.serialTx.gapMaxNs;
+  }
+
+  return stats;
+}
+
+void
+Protocol::writeMetrics(MetricsWriter& writer) const
+{
+  LinkStats stats = getLinkStats();
+  char      labels[32];
+
+  writer.family("osdk_link_bytes_received_total", "counter",
+                "Bytes fed into the frame parser.");
+  writer.sample("osdk_link_bytes_received_total", stats.bytesIn);
+  writer.family("osdk_link_bytes_sent_total", "counter",
+                "Bytes accepted by the serial driver.");
+  writer.sample("osdk_link_bytes_sent_total", stats.bytesOut);
+  writer.family("osdk_link_frames_parsed_total", "counter",
+                "Frames that passed header and data CRC.");
+  writer.sample("osdk_link_frames_parsed_total", (uint64_t)stats.framesParsed);
+  writer.family("osdk_link_frames_sent_total", "counter",
+                "Frames written, including retransmissions and ACKs.");
+  writer.sample("osdk_link_frames_sent_total", (uint64_t)stats.framesSent);
+  writer.family("osdk_link_frames_dropped_total", "counter",
+                "Frames the port did not take: TX queue full or port closed.");
+  writer.sample("osdk_link_frames_dropped_total",
+                (uint64_t)stats.framesDropped);
+  writer.family("osdk_link_crc_errors_total", "counter",
+                "Frames rejected by CRC check.");
+  writer.sample("osdk_link_crc_errors_total", (uint64_t)stats.headerCRCErrors,
+                "part=\"header\"");
+  writer.sample("osdk_link_crc_errors_total", (uint64_t)stats.dataCRCErrors,
+                "part=\"data\"");
+  writer.family("osdk_link_resync_bytes_total", "counter",
+                "Bytes discarded while resynchronizing on a frame header.");
+  writer.sample("osdk_link_resync_bytes_total", (uint64_t)stats.resyncBytes);
+  writer.family("osdk_link_parser_overflows_total", "counter",
+                "Parser buffer overflows.");
+  writer.sample("osdk_link_parser_overflows_total",
+                (uint64_t)stats.bufferOverflows);
+
+  writer.family("osdk_link_retransmissions_total", "counter",
+                "Command retransmissions per session.");
+  for (size_t i = 1; i < SESSION_TABLE_NUM; i++)
+  {
+    if (stats.sessionRetransmissions[i])
+    {
+      snprintf(labels, sizeof(labels), "session=\"%d\"", (int)i);
+      writer.sample("osdk_link_retransmissions_total",
+                    (uint64_t)stats.sessionRetransmissions[i], labels);
+    }
+  }
+  writer.family("osdk_link_session_timeouts_total", "counter",
+                "Sessions freed without an ACK after the last retry.");
+  writer.sample("osdk_link_session_timeouts_total",
+                (uint64_t)stats.sessionTimeouts);
+  writer.family("osdk_link_session_alloc_failures_total", "counter",
+                "Commands dropped because no session or memory was free.");
+  writer.sample("osdk_link_session_alloc_failures_total",
+                (uint64_t)stats.sessionAllocFailures);
+  writer.family("osdk_link_bursts_total", "counter",
+                "Command bursts written in one send() call.");
+  writer.sample("osdk_link_bursts_total", (uint64_t)stats.bursts);
+  writer.family("osdk_link_burst_gap_max_seconds", "gauge",
+                "Largest idle line time between two frames of a burst.");
+  writer.sample("osdk_link_burst_gap_max_seconds",
+                stats.burstGapMaxNs / 1e9);
+
+  writer.family("osdk_mmu_high_water_bytes", "gauge",
+                "Peak protocol MMU usage.");
+  writer.sample("osdk_mmu_high_water_bytes", (uint64_t)stats.mmuHighWater);
+  writer.family("osdk_mmu_size_bytes", "gauge", "Protocol MMU capacity.");
+  writer.sample("osdk_mmu_size_bytes", (uint64_t)stats.mmuSize);
+
+  if (stats.serialStatsValid)
+  {
+    writer.family("osdk_serial_errors_total", "counter",
+                  "UART line errors reported by the driver.");
+    writer.sample("osdk_serial_errors_total", (uint64_t)stats.serial.overrun,
+                  "type=\"overrun\"");
+    writer.sample("osdk_serial_errors_total",
+                  (uint64_t)stats.serial.bufferOverrun,
+                  "type=\"buffer_overrun\"");
+    writer.sample("osdk_serial_errors_total", (uint64_t)stats.serial.frame,
+                  "type=\"frame\"");
+    writer.sample("osdk_serial_errors_total", (uint64_t)stats.serial.parity,
+                  "type=\"parity\"");
+    writer.sample("osdk_serial_errors_total", (uint64_t)stats.serial.brk,
+                  "type=\"break\"");
+  }
+
+  if (stats.serialTxStatsValid)
+  {
+    writer.family("osdk_serial_tx_queue_bytes", "gauge",
+                  "Bytes waiting in the driver's transmit queue.");
+    writer.sample("osdk_serial_tx_queue_bytes",
+                  (uint64_t)stats.serialTx.queued);
+    writer.family("osdk_serial_tx_queue_high_water_bytes", "gauge",
+                  "Most bytes ever waiting in the transmit queue.");
+    writer.sample("osdk_serial_tx_queue_high_water_bytes",
+                  (uint64_t)stats.serialTx.highWater);
+    writer.family("osdk_serial_tx_writes_total", "counter",
+                  "write()/writev() calls, several frames may share one.");
+    writer.sample("osdk_serial_tx_writes_total",
+                  (uint64_t)stats.serialTx.writes);
+    writer.family("osdk_serial_tx_would_block_total", "counter",
+                  "Writes that found the kernel buffer full.");
+    writer.sample("osdk_serial_tx_would_block_total",
+                  (uint64_t)stats.serialTx.wouldBlock);
+    writer.family("osdk_serial_tx_gaps_total", "counter",
+                  "Writes that found the line idle with bytes waiting.");
+    writer.sample("osdk_serial_tx_gaps_total", (uint64_t)stats.serialTx.gaps);
+    writer.family("osdk_serial_tx_dropped_total", "counter",
+                  "Frames refused because the transmit queue was full.");
+    writer.sample("osdk_serial_tx_dropped_total",
+                  (uint64_t)stats.serialTx.dropped);
+  }
+
+  latency.writeMetrics(writer);
+  rto.writeMetrics(writer);
+  txScheduler.writeMetrics(writer);
+}
+
+bool
+Protocol::exportMetrics(const char* path) const
+{
+  MetricsWriter writer;
+  if (!writer.open(path))
+  {
+    return false;
+  }
+  writeMetrics(writer);
+  return writer.commit();
+}
+
+CommandLatencyTable*
+Protocol::getLatencyTable()
+{
+  return &latency;
+}
+
+TxScheduler*
+Protocol::getTxScheduler()
+{
+  return &txScheduler;
+}
+
+RetransmitTimer*
+Protocol::getRetransmitTimer()
+{
+  return &rto;
+}
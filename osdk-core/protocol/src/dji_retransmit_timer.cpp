@@ -0,0 +1,242 @@
+/** @file dji_retransmit_timer.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Retransmission timeouts from measured round-trip times
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_retransmit_timer.hpp"
+
+#include <stdio.h>
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+RetransmitTimer::RetransmitTimer()
+  : enabled(true)
+  , floorMs(DEFAULT_FLOOR_MS)
+  , ceilingMs(DEFAULT_CEILING_MS)
+{
+}
+
+void
+RetransmitTimer::setBounds(uint16_t floorMs, uint16_t ceilingMs)
+{
+  this->floorMs   = floorMs < GRANULARITY_MS ? GRANULARITY_MS : floorMs;
+  this->ceilingMs = ceilingMs < this->floorMs ? this->floorMs : ceilingMs;
+}
+
+void
+RetransmitTimer::setEnabled(bool enable)
+{
+  enabled = enable;
+}
+
+bool
+RetransmitTimer::isEnabled() const
+{
+  return enabled;
+}
+
+RetransmitTimer::Entry*
+RetransmitTimer::find(uint8_t cmd_set, uint8_t cmd_id, bool create)
+{
+  uint32_t key   = 0x10000 | (cmd_set << 8) | cmd_id;
+  int      start = (cmd_set * 31 + cmd_id) % TABLE_SIZE;
+
+  for (int n = 0; n < TABLE_SIZE; n++)
+  {
+    Entry&   entry = entries[(start + n) % TABLE_SIZE];
+    uint32_t cur   = entry.key.load();
+    if (cur == key)
+    {
+      return &entry;
+    }
+    if (cur == 0)
+    {
+      if (!create)
+      {
+        return NULL;
+      }
+      uint32_t expected = 0;
+      if (entry.key.compareExchange(expected, key) || expected == key)
+      {
+        return &entry;
+      }
+    }
+  }
+  return NULL;
+}
+
+const RetransmitTimer::Entry*
+RetransmitTimer::find(uint8_t cmd_set, uint8_t cmd_id) const
+{
+  return const_cast<RetransmitTimer*>(this)->find(cmd_set, cmd_id, false);
+}
+
+uint16_t
+RetransmitTimer::clamp(uint32_t timeoutMs) const
+{
+  if (timeoutMs < floorMs)
+  {
+    return floorMs;
+  }
+  if (timeoutMs > ceilingMs)
+  {
+    return ceilingMs;
+  }
+  return (uint16_t)timeoutMs;
+}
+
+uint16_t
+RetransmitTimer::timeout(const Entry& entry, uint16_t requested) const
+{
+  uint32_t base;
+  if (entry.samples.loadRelaxed() == 0)
+  {
+    base = requested;
+  }
+  else
+  {
+    uint32_t var  = 4 * entry.rttvar.loadRelaxed();
+    uint32_t gran = GRANULARITY_MS * 1000;
+    //! Round up to whole ms
+    base = (entry.srtt.loadRelaxed() + (var > gran ? var : gran) + 999) / 1000;
+  }
+  return clamp(clamp(base) << entry.backoff.loadRelaxed());
+}
+
+uint16_t
+RetransmitTimer::initialTimeout(uint8_t cmd_set, uint8_t cmd_id,
+                                uint16_t requested)
+{
+  if (!enabled)
+  {
+    return requested;
+  }
+  const Entry* entry = find(cmd_set, cmd_id, true);
+  if (entry == NULL)
+  {
+    return clamp(requested);
+  }
+  return timeout(*entry, requested);
+}
+
+uint16_t
+RetransmitTimer::backoff(uint16_t timeout) const
+{
+  if (!enabled)
+  {
+    return timeout;
+  }
+  return clamp((uint32_t)timeout * 2);
+}
+
+void
+RetransmitTimer::recordAck(uint8_t cmd_set, uint8_t cmd_id, time_us rtt,
+                           uint32_t retries)
+{
+  //! Karn: which transmission got the ACK is unknown
+  if (retries != 0)
+  {
+    return;
+  }
+  Entry* entry = find(cmd_set, cmd_id, true);
+  if (entry == NULL)
+  {
+    return;
+  }
+
+  uint32_t r = rtt > 0xFFFFFFFFULL ? 0xFFFFFFFF : (uint32_t)rtt;
+  if (entry->samples.loadRelaxed() == 0)
+  {
+    entry->srtt.storeRelaxed(r);
+    entry->rttvar.storeRelaxed(r / 2);
+  }
+  else
+  {
+    uint32_t srtt = entry->srtt.loadRelaxed();
+    uint32_t err  = r > srtt ? r - srtt : srtt - r;
+    //! RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R
+    entry->rttvar.storeRelaxed(
+      (uint32_t)(((uint64_t)entry->rttvar.loadRelaxed() * 3 + err) / 4));
+    entry->srtt.storeRelaxed((uint32_t)(((uint64_t)srtt * 7 + r) / 8));
+  }
+  entry->samples.add(1);
+  entry->backoff.storeRelaxed(0);
+}
+
+void
+RetransmitTimer::recordTimeout(uint8_t cmd_set, uint8_t cmd_id)
+{
+  if (!enabled)
+  {
+    return;
+  }
+  Entry* entry = find(cmd_set, cmd_id, true);
+  if (entry && entry->backoff.loadRelaxed() < MAX_BACKOFF)
+  {
+    entry->backoff.add(1);
+  }
+}
+
+bool
+RetransmitTimer::get(uint8_t cmd_set, uint8_t cmd_id,
+                     RetransmitEstimate& out) const
+{
+  const Entry* entry = find(cmd_set, cmd_id);
+  if (entry == NULL)
+  {
+    return false;
+  }
+  out.cmd_set = cmd_set;
+  out.cmd_id  = cmd_id;
+  out.samples = entry->samples.loadRelaxed();
+  out.srtt    = entry->srtt.loadRelaxed();
+  out.rttvar  = entry->rttvar.loadRelaxed();
+  out.backoff = entry->backoff.loadRelaxed();
+  out.rto     = timeout(*entry, floorMs);
+  return true;
+}
+
+void
+RetransmitTimer::writeMetrics(MetricsWriter& writer) const
+{
+  char labels[64];
+
+  writer.family("osdk_command_srtt_seconds", "gauge",
+                "Smoothed ACK round-trip time of commands sent once.");
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    const Entry& entry = entries[i];
+    uint32_t     key   = entry.key.load();
+    if (key == 0 || entry.samples.loadRelaxed() == 0)
+    {
+      continue;
+    }
+    snprintf(labels, sizeof(labels), "cmd_set=\"0x%02X\",cmd_id=\"0x%02X\"",
+             (key >> 8) & 0xFF, key & 0xFF);
+    writer.sample("osdk_command_srtt_seconds",
+                  entry.srtt.loadRelaxed() / 1e6, labels);
+  }
+
+  writer.family("osdk_command_rto_seconds", "gauge",
+                "Retransmission timeout of the next command.");
+  for (int i = 0; i < TABLE_SIZE; i++)
+  {
+    const Entry& entry = entries[i];
+    uint32_t     key   = entry.key.load();
+    if (key == 0 || entry.samples.loadRelaxed() == 0)
+    {
+      continue;
+    }
+    snprintf(labels, sizeof(labels), "cmd_set=\"0x%02X\",cmd_id=\"0x%02X\"",
+             (key >> 8) & 0xFF, key & 0xFF);
+    writer.sample("osdk_command_rto_seconds", timeout(entry, floorMs) / 1e3,
+                  labels);
+  }
+}
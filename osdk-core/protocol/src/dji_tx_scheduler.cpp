@@ -0,0 +1,248 @@
+/** @file dji_tx_scheduler.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Priority classes and link budgeting for outgoing frames
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_tx_scheduler.hpp"
+#include "dji_command.hpp"
+#include "dji_open_protocol.hpp"
+
+#include <stdio.h>
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+//! Longest single sleep, so a waiting frame notices a new higher class one
+static const time_us MAX_SLEEP = 1000;
+//! Sleep while a higher class frame is being written
+static const time_us YIELD_SLEEP = 50;
+
+static const char* const classNames[TxScheduler::TX_CLASS_COUNT] = {
+  "emergency", "control", "ack", "bulk", "mobile"
+};
+
+static bool
+isCmd(uint8_t cmdSet, uint8_t cmdId, const uint8_t cmd[])
+{
+  return cmdSet == cmd[0] && cmdId == cmd[1];
+}
+
+TxScheduler::TxScheduler()
+  : bucketLock(0)
+  , rate(0)
+  , tokens(0)
+  , refillTime(0)
+{
+  for (int i = 0; i < TX_CLASS_COUNT; ++i)
+  {
+    waiting[i].storeRelaxed(0);
+    frames[i].storeRelaxed(0);
+    bytes[i].storeRelaxed(0);
+  }
+}
+
+void
+TxScheduler::setLinkRate(uint32_t bytesPerSecond)
+{
+  lock();
+  rate       = bytesPerSecond;
+  tokens     = (int64_t)DEPTH * 1000000;
+  refillTime = 0;
+  unlock();
+}
+
+TxScheduler::TxClass
+TxScheduler::classify(uint8_t cmdSet, uint8_t cmdId, const uint8_t* payload,
+                      size_t len)
+{
+  if (isCmd(cmdSet, cmdId, OpenProtocol::CMDSet::Control::task))
+  {
+    //! A one byte payload is the action code; the M100 format has two
+    //! bytes and no stop-motor action
+    return payload && len == 1 && payload[0] == TASK_STOP_MOTOR
+             ? TX_EMERGENCY
+             : TX_CONTROL;
+  }
+  if (isCmd(cmdSet, cmdId, OpenProtocol::CMDSet::Control::control) ||
+      isCmd(cmdSet, cmdId, OpenProtocol::CMDSet::Control::gimbalAngle) ||
+      isCmd(cmdSet, cmdId, OpenProtocol::CMDSet::Control::gimbalSpeed) ||
+      isCmd(cmdSet, cmdId, OpenProtocol::CMDSet::VirtualRC::data))
+  {
+    return TX_CONTROL;
+  }
+  if (isCmd(cmdSet, cmdId, OpenProtocol::CMDSet::Activation::toMobile))
+  {
+    return TX_MOBILE;
+  }
+  return TX_BULK;
+}
+
+TxScheduler::TxClass
+TxScheduler::classify(const Command& cmd)
+{
+  if (cmd.buf == 0 || cmd.length < SET_CMD_SIZE)
+  {
+    return classify(cmd.cmd_set, cmd.cmd_id);
+  }
+  return classify(cmd.cmd_set, cmd.cmd_id, cmd.buf + SET_CMD_SIZE,
+                  cmd.length - SET_CMD_SIZE);
+}
+
+bool
+TxScheduler::isRealTime(TxClass cls)
+{
+  return cls <= TX_ACK;
+}
+
+void
+TxScheduler::lock()
+{
+  uint32_t expected = 0;
+  while (!bucketLock.compareExchange(expected, 1))
+  {
+    expected = 0;
+  }
+}
+
+void
+TxScheduler::unlock()
+{
+  bucketLock.store(0);
+}
+
+time_us
+TxScheduler::tryTake(uint32_t len, time_us now, bool force)
+{
+  lock();
+  if (rate == 0)
+  {
+    unlock();
+    return 0;
+  }
+
+  if (refillTime != 0 && now > refillTime)
+  {
+    tokens += (int64_t)(now - refillTime) * rate;
+    if (tokens > (int64_t)DEPTH * 1000000)
+    {
+      tokens = (int64_t)DEPTH * 1000000;
+    }
+  }
+  refillTime = now;
+
+  int64_t need = (int64_t)len * 1000000;
+  if (!force && tokens < need)
+  {
+    time_us wait = (time_us)((need - tokens + rate - 1) / rate);
+    unlock();
+    return wait ? wait : 1;
+  }
+  tokens -= need;
+  unlock();
+  return 0;
+}
+
+void
+TxScheduler::admit(TxClass cls, uint32_t len, HardDriver* clock)
+{
+  waiting[cls].add(1);
+
+#if defined(__linux__)
+  for (;;)
+  {
+    bool yield = false;
+    for (int higher = 0; higher < cls && !yield; ++higher)
+    {
+      yield = waiting[higher].load() != 0;
+    }
+
+    time_us wait = YIELD_SLEEP;
+    if (!yield)
+    {
+      wait = tryTake(len, clock->getTimeStampUs(), isRealTime(cls));
+      if (wait == 0)
+      {
+        return;
+      }
+    }
+    usleep(wait < MAX_SLEEP ? wait : MAX_SLEEP);
+  }
+#else
+  tryTake(len, clock->getTimeStampUs(), true);
+#endif
+}
+
+void
+TxScheduler::release(TxClass cls, uint32_t len, time_us latency)
+{
+  frames[cls].add(1);
+  bytes[cls].add(len);
+  this->latency[cls].record(latency);
+  waiting[cls].add((uint32_t)-1);
+}
+
+void
+TxScheduler::charge(TxClass cls, uint32_t len, time_us now)
+{
+  tryTake(len, now, true);
+  frames[cls].add(1);
+  bytes[cls].add(len);
+}
+
+TxScheduler::ClassStats
+TxScheduler::getStats(TxClass cls) const
+{
+  ClassStats stats;
+  stats.frames     = frames[cls].loadRelaxed();
+  stats.bytes      = bytes[cls].loadRelaxed();
+  stats.latencyP99 = latency[cls].getPercentile(99);
+  stats.latencyMax = latency[cls].getMax();
+  return stats;
+}
+
+void
+TxScheduler::writeMetrics(MetricsWriter& writer) const
+{
+  static const double quantiles[] = { 0.5, 0.99, 1 };
+  char                labels[64];
+
+  writer.family("osdk_tx_latency_seconds", "summary",
+                "Time from send() to the serial write, per traffic class.");
+  for (int i = 0; i < TX_CLASS_COUNT; i++)
+  {
+    if (latency[i].getCount() == 0)
+    {
+      continue;
+    }
+    for (int q = 0; q < 3; q++)
+    {
+      snprintf(labels, sizeof(labels), "class=\"%s\",quantile=\"%g\"",
+               classNames[i], quantiles[q]);
+      writer.sample("osdk_tx_latency_seconds",
+                    latency[i].getPercentile(quantiles[q] * 100) / 1e6,
+                    labels);
+    }
+    snprintf(labels, sizeof(labels), "class=\"%s\"", classNames[i]);
+    writer.sample("osdk_tx_latency_seconds_sum", latency[i].getSum() / 1e6,
+                  labels);
+    writer.sample("osdk_tx_latency_seconds_count",
+                  (uint64_t)latency[i].getCount(), labels);
+  }
+
+  writer.family("osdk_tx_bytes_total", "counter",
+                "Bytes admitted to the serial port, per traffic class.");
+  for (int i = 0; i < TX_CLASS_COUNT; i++)
+  {
+    snprintf(labels, sizeof(labels), "class=\"%s\"", classNames[i]);
+    writer.sample("osdk_tx_bytes_total", bytes[i].loadRelaxed(), labels);
+  }
+}
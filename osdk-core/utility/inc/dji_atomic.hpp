@@ -0,0 +1,151 @@
+/** @file dji_atomic.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief Minimal atomic wrapper for the DJI OSDK
+ *
+ *  @details std::atomic on hosted platforms; plain volatile accesses on
+ *  single-core bare-metal targets (STM32) whose toolchain has no <atomic>.
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_ATOMIC_H
+#define DJI_ATOMIC_H
+
+#ifndef STM32
+#include <atomic>
+#endif
+
+namespace DJI
+{
+namespace OSDK
+{
+
+/*! @brief Atomic variable with the orderings the OSDK actually needs
+ *
+ * @details load()/store() are acquire/release, the *Relaxed variants and
+ * add() carry no ordering and are meant for statistics counters.
+ */
+template <typename T>
+class Atomic
+{
+public:
+  Atomic(T init = T())
+    : value(init)
+  {
+  }
+
+#ifndef STM32
+  T load() const
+  {
+    return value.load(std::memory_order_acquire);
+  }
+  T loadRelaxed() const
+  {
+    return value.load(std::memory_order_relaxed);
+  }
+  void store(T v)
+  {
+    value.store(v, std::memory_order_release);
+  }
+  void storeRelaxed(T v)
+  {
+    value.store(v, std::memory_order_relaxed);
+  }
+  T add(T delta)
+  {
+    return value.fetch_add(delta, std::memory_order_relaxed);
+  }
+  T exchange(T v)
+  {
+    return value.exchange(v, std::memory_order_acq_rel);
+  }
+  bool compareExchange(T& expected, T desired)
+  {
+    return value.compare_exchange_strong(expected, desired,
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_acquire);
+  }
+  //! Raise the stored value to v if it is larger
+  void max(T v)
+  {
+    T cur = value.load(std::memory_order_relaxed);
+    while (v > cur &&
+           !value.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+    {
+    }
+  }
+#else
+  T load() const
+  {
+    return value;
+  }
+  T loadRelaxed() const
+  {
+    return value;
+  }
+  void store(T v)
+  {
+    value = v;
+  }
+  void storeRelaxed(T v)
+  {
+    value = v;
+  }
+  T add(T delta)
+  {
+    T old = value;
+    value = old + delta;
+    return old;
+  }
+  T exchange(T v)
+  {
+    T old = value;
+    value = v;
+    return old;
+  }
+  bool compareExchange(T& expected, T desired)
+  {
+    if (value == expected)
+    {
+      value = desired;
+      return true;
+    }
+    expected = value;
+    return false;
+  }
+  void max(T v)
+  {
+    if (v > value)
+    {
+      value = v;
+    }
+  }
+#endif
+
+private:
+  Atomic(const Atomic&);
+  Atomic& operator=(const Atomic&);
+
+#ifndef STM32
+  std::atomic<T> value;
+#else
+  volatile T value;
+#endif
+};
+
+//! Full ordering point, e.g. between the data and the counter of a seqlock
+inline void
+atomicFence()
+{
+#ifndef STM32
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+}
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_ATOMIC_H
@@ -29,8 +29,10 @@ namespace OSDK
 class CircularBuffer
 {
 public:
+  //! @return 1 if the buffer was full and its oldest entry was discarded,
+  //! which is then copied to discarded if given
   int cbPush(CircularBuffer* CBuffer, VehicleCallBackHandler data,
-             RecvContainer data2);
+             RecvContainer data2, VehicleCallBackHandler* discarded = 0);
   int cbPop(CircularBuffer* CBuffer, VehicleCallBackHandler* data,
             RecvContainer* data2);
   CircularBuffer();
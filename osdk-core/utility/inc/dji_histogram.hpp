@@ -0,0 +1,64 @@
+/** @file dji_histogram.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief Fixed-memory log-linear histogram for the DJI OSDK
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_HISTOGRAM_H
+#define DJI_HISTOGRAM_H
+
+#include "dji_atomic.hpp"
+#include <stdint.h>
+
+namespace DJI
+{
+namespace OSDK
+{
+
+/*! @brief HDR-style histogram with a fixed footprint
+ *
+ * @details Buckets are exact below 2^SUB_BUCKET_BITS and then split every
+ * power of two into SUB_BUCKETS linear steps, i.e. about 6% relative
+ * precision over [0, 2^MAX_EXPONENT). Larger values land in the last
+ * bucket. Recording is lock-free and may race with readers, which then see
+ * a slightly stale but consistent-enough view.
+ */
+class Histogram
+{
+public:
+  static const int SUB_BUCKET_BITS = 4;
+  static const int SUB_BUCKETS     = 1 << SUB_BUCKET_BITS;
+  static const int MAX_EXPONENT    = 25; //! ~33 s when recording in us
+  static const int BUCKET_COUNT =
+    (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  Histogram();
+
+  void record(uint64_t value);
+  void reset();
+
+  uint32_t getCount() const;
+  uint64_t getMax() const;
+  uint64_t getSum() const;
+  double   getMean() const;
+  //! @param percentile in [0, 100]; highest value equivalent to the bucket
+  uint64_t getPercentile(double percentile) const;
+
+  static int      bucketIndex(uint64_t value);
+  static uint64_t bucketUpperBound(int index);
+
+private:
+  Atomic<uint32_t> buckets[BUCKET_COUNT];
+  Atomic<uint32_t> count;
+  Atomic<uint64_t> sum;
+  Atomic<uint64_t> max;
+}; // class Histogram
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_HISTOGRAM_H
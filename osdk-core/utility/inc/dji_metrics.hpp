@@ -0,0 +1,60 @@
+/** @file dji_metrics.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief Prometheus text-format writer for the DJI OSDK metrics
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_METRICS_H
+#define DJI_METRICS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+namespace DJI
+{
+namespace OSDK
+{
+
+/*! @brief Writes metrics in the Prometheus text exposition format
+ *
+ * @details Either attach to an open stream (e.g. stdout for a periodic
+ * dump) or open a file path; a file is written to "<path>.tmp" and renamed
+ * over the target on commit() so that a textfile collector never scrapes a
+ * partial file.
+ */
+class MetricsWriter
+{
+public:
+  static const int MAX_PATH_LEN = 256;
+
+  MetricsWriter();
+  ~MetricsWriter();
+
+  bool open(const char* path);
+  void attach(FILE* stream);
+  //! @note closes the file and publishes it; no-op for attached streams
+  bool commit();
+
+  //! Emit the # HELP / # TYPE preamble of a metric family
+  void family(const char* name, const char* type, const char* help);
+  //! @param labels e.g. "session=\"3\"", or NULL
+  void sample(const char* name, uint64_t value, const char* labels = 0);
+  void sample(const char* name, double value, const char* labels = 0);
+
+  bool isOpen() const;
+
+private:
+  FILE* file;
+  bool  ownFile;
+  char  path[MAX_PATH_LEN];
+  char  tmpPath[MAX_PATH_LEN + 4];
+}; // class MetricsWriter
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_METRICS_H
@@ -0,0 +1,114 @@
+/** @file dji_rate_monitor.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief Arrival rate and jitter estimator for periodic telemetry
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_RATE_MONITOR_H
+#define DJI_RATE_MONITOR_H
+
+#include "dji_atomic.hpp"
+#include "dji_metrics.hpp"
+#include "dji_type.hpp"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+//! Snapshot of a RateMonitor, intervals in microseconds
+typedef struct RateStats
+{
+  uint32_t count;            //! arrivals since the last reset
+  float    expectedHz;       //! requested rate, 0 if unknown
+  float    rateHz;           //! delivered rate over the last full window
+  double   meanInterval;     //! inter-arrival mean since the last reset
+  double   stdDevInterval;   //! inter-arrival standard deviation
+  time_us  maxGap;           //! longest inter-arrival interval
+  time_us  lastArrival;      //! host time of the latest arrival
+  uint32_t underRateWindows; //! windows delivered below the requested rate
+  bool     underRate;        //! the last window was below the requested rate
+} RateStats;
+
+/*! @brief Constant-memory inter-arrival statistics for one data stream
+ *
+ * @details Mean and variance are accumulated with Welford's online update,
+ * the delivered rate is measured over windows of at least WINDOW_US (and at
+ * least MIN_WINDOW_SAMPLES expected arrivals). A warning is logged when a
+ * window falls below UNDER_RATE_RATIO of the expected rate and again when
+ * the stream recovers.
+ *
+ * Updates come from a single thread (the one decoding the data); getStats()
+ * may be called from any thread and sees each field atomically, though not
+ * necessarily all from the same update.
+ */
+class RateMonitor
+{
+public:
+  static const time_us WINDOW_US          = 1000000;
+  static const int     MIN_WINDOW_SAMPLES = 10;
+  static const float   UNDER_RATE_RATIO;
+
+  RateMonitor();
+
+  //! @param name printed in warnings, must outlive the monitor
+  void setName(const char* name, int index = -1);
+  //! @param hz 0 disables the under-rate check
+  void setExpectedRate(float hz);
+  float getExpectedRate() const;
+
+  //! Record one arrival at host time now
+  void update(time_us now);
+  //! Close the current window if due; catches streams that stopped entirely
+  void poll(time_us now);
+  void reset();
+
+  void getStats(RateStats& out) const;
+
+  /*! @brief Write one metric family per statistic over a set of streams
+   *
+   * @param prefix e.g. "osdk_subscription"
+   * @param label name of the label carrying ids[i], e.g. "package"
+   */
+  static void writeMetrics(MetricsWriter& writer, const char* prefix,
+                           const char* label, const RateStats* stats,
+                           const int* ids, int count);
+
+private:
+  RateMonitor(const RateMonitor&);
+  RateMonitor& operator=(const RateMonitor&);
+
+  time_us windowLength() const;
+  void closeWindow(time_us now);
+
+private:
+  const char* name;
+  int         index;
+
+  //! Writer-side state
+  time_us  last;
+  double   mean;
+  double   m2;
+  time_us  windowStart;
+  uint32_t windowCount;
+
+  //! Published state
+  Atomic<uint32_t> count;
+  Atomic<float>    expectedHz;
+  Atomic<float>    rateHz;
+  Atomic<double>   meanInterval;
+  Atomic<double>   variance;
+  Atomic<time_us>  maxGap;
+  Atomic<time_us>  lastArrival;
+  Atomic<uint32_t> underRateWindows;
+  Atomic<bool>     underRate;
+}; // class RateMonitor
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_RATE_MONITOR_H
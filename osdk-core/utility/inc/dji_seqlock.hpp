@@ -0,0 +1,177 @@
+/** @file dji_seqlock.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief Sequence lock and double-buffered snapshot for the DJI OSDK
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_SEQLOCK_H
+#define DJI_SEQLOCK_H
+
+#include "dji_atomic.hpp"
+#include <stdint.h>
+#include <string.h>
+
+namespace DJI
+{
+namespace OSDK
+{
+
+/*! @brief Single-writer sequence lock
+ *
+ * @details The writer never waits. Readers copy the protected data
+ * optimistically and retry if a write overlapped:
+ *
+ *   uint32_t token;
+ *   do { token = lock.readBegin(); copy(); } while (lock.readRetry(token));
+ */
+class SeqLock
+{
+public:
+  SeqLock()
+    : sequence(0)
+  {
+  }
+
+  void writeBegin()
+  {
+    sequence.storeRelaxed(sequence.loadRelaxed() + 1);
+    atomicFence();
+  }
+  void writeEnd()
+  {
+    sequence.store(sequence.loadRelaxed() + 1);
+  }
+
+  //! @return token for readRetry(), odd while a write is in progress
+  uint32_t readBegin() const
+  {
+    return sequence.load();
+  }
+  //! @return true if the data copied since readBegin() may be torn
+  bool readRetry(uint32_t token) const
+  {
+    atomicFence();
+    return (token & 1) || sequence.loadRelaxed() != token;
+  }
+
+private:
+  SeqLock(const SeqLock&);
+  SeqLock& operator=(const SeqLock&);
+
+  Atomic<uint32_t> sequence;
+};
+
+/*! @brief Latest-value buffer with a single writer and wait-free readers
+ *
+ * @details Two slots, each behind its own SeqLock: the writer always fills
+ * the slot readers are not directed to, so a reader only retries when the
+ * writer completes two whole updates during a single copy.
+ *
+ * Every write carries a 64-bit stamp (e.g. the arrival time). To capture
+ * several buffers at one instant, call readBegin() on all of them, copy
+ * with slotData(), then readValidate() each one and start over on failure.
+ */
+template <int CAPACITY>
+class SeqBuffer
+{
+public:
+  SeqBuffer()
+    : writes(0)
+  {
+    version[0]   = 0;
+    version[1]   = 0;
+    slotStamp[0] = 0;
+    slotStamp[1] = 0;
+  }
+
+  //! @note single writer; len must not exceed CAPACITY
+  void write(const void* src, int len, uint64_t stamp = 0)
+  {
+    uint32_t next = writes.loadRelaxed() + 1;
+    int      slot = next & 1;
+
+    locks[slot].writeBegin();
+    memcpy(data[slot], src, len);
+    version[slot]   = next;
+    slotStamp[slot] = stamp;
+    locks[slot].writeEnd();
+    writes.store(next);
+  }
+
+  /*! @brief Copy len bytes at offset from the latest complete write
+   *  @return the write count of the copied data, 0 if nothing was written
+   */
+  uint32_t read(void* dst, int offset, int len, uint64_t* stamp = 0) const
+  {
+    for (;;)
+    {
+      uint32_t latest = writes.load();
+      if (latest == 0)
+      {
+        return 0;
+      }
+      int      slot   = latest & 1;
+      uint32_t token  = locks[slot].readBegin();
+      memcpy(dst, data[slot] + offset, len);
+      uint32_t copied = version[slot];
+      uint64_t when   = slotStamp[slot];
+      if (!locks[slot].readRetry(token))
+      {
+        if (stamp)
+        {
+          *stamp = when;
+        }
+        return copied;
+      }
+    }
+  }
+
+  //! @return the write count to copy, 0 if nothing was written yet
+  uint32_t readBegin(uint32_t& token) const
+  {
+    uint32_t latest = writes.load();
+    token           = locks[latest & 1].readBegin();
+    return latest;
+  }
+  const uint8_t* slotData(uint32_t latest) const
+  {
+    return data[latest & 1];
+  }
+  uint64_t getSlotStamp(uint32_t latest) const
+  {
+    return slotStamp[latest & 1];
+  }
+  //! @return true if the copy is intact and still the latest write
+  bool readValidate(uint32_t latest, uint32_t token) const
+  {
+    return !locks[latest & 1].readRetry(token) &&
+           writes.loadRelaxed() == latest;
+  }
+
+  uint32_t getWriteCount() const
+  {
+    return writes.load();
+  }
+
+  //! @note only while no write can be in progress
+  void clear()
+  {
+    writes.store(0);
+  }
+
+private:
+  SeqLock           locks[2];
+  Atomic<uint32_t>  writes;
+  uint32_t          version[2];
+  uint64_t          slotStamp[2];
+  uint8_t           data[2][CAPACITY];
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // DJI_SEQLOCK_H
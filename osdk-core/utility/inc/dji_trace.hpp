@@ -0,0 +1,52 @@
+/** @file dji_trace.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief Static tracepoints for the DJI OSDK send, receive and dispatch paths
+ *
+ *  @details When built with OSDK_USDT on Linux every OSDK_TRACE site becomes
+ *  a USDT probe in the "osdk" provider: a single nop in the code path plus an
+ *  ELF note that bpftrace/perf/systemtap can attach to at run time, e.g.
+ *
+ *    bpftrace -e 'usdt:./app:osdk:frame_recv { @[arg0, arg1] = count(); }'
+ *
+ *  Otherwise the macros expand to nothing.
+ *
+ *  Every probe carries (cmd_set, cmd_id, session, sequence, length).
+ *  Where a field is not known at the probe site it is reported as -1.
+ *
+ *  Probes:
+ *  - frame_send       Protocol::sendData, right before the driver write
+ *  - frame_recv       Protocol::appHandler, a complete frame was accepted
+ *  - dispatch         Vehicle::processReceivedData entry
+ *  - cb_push, cb_pop  CircularBuffer hand-off to the callback thread
+ *  - callback_entry,
+ *    callback_return  around every user callback invocation
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_TRACE_H
+#define DJI_TRACE_H
+
+#if defined(OSDK_USDT) && defined(__linux__)
+#include <sys/sdt.h>
+
+#define OSDK_TRACE(_name_, _set_, _id_, _session_, _seq_, _len_)               \
+  DTRACE_PROBE5(osdk, _name_, (int)(_set_), (int)(_id_), (int)(_session_),     \
+                (int)(_seq_), (int)(_len_))
+#else
+#define OSDK_TRACE(_name_, _set_, _id_, _session_, _seq_, _len_)               \
+  do                                                                           \
+  {                                                                            \
+  } while (0)
+#endif
+
+//! Trace a RecvContainer, e.g. at dispatch or callback sites
+#define OSDK_TRACE_RECV(_name_, _recv_)                                        \
+  OSDK_TRACE(_name_, (_recv_).recvInfo.cmd_set, (_recv_).recvInfo.cmd_id,      \
+             (_recv_).dispatchInfo.sessionID, (_recv_).recvInfo.seqNumber,     \
+             (_recv_).recvInfo.len)
+
+#endif // DJI_TRACE_H
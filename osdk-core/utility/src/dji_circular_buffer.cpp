@@ -9,6 +9,7 @@
  */
 
 #include "dji_circular_buffer.hpp"
+#include "dji_trace.hpp"
 
 using namespace DJI;
 using namespace DJI::OSDK;
@@ -26,8 +27,10 @@ CircularBuffer::CircularBuffer()
 int
 CircularBuffer::cbPush(CircularBuffer*                   CBuffer,
                        DJI::OSDK::VehicleCallBackHandler cbData,
-                       RecvContainer                     recvData)
+                       RecvContainer                     recvData,
+                       DJI::OSDK::VehicleCallBackHandler* discarded)
 {
+  int full = 0;
   int next = head + 1;
   if (next >= maxLen)
   {
@@ -36,13 +39,21 @@ CircularBuffer::cbPush(CircularBuffer*                   CBuffer,
   //! Circular buffer is full, pop the old value and discard.
   if (next == tail)
   {
-    CBuffer->cbPop(CBuffer, &cbData, &recvData);
+    VehicleCallBackHandler oldData;
+    RecvContainer          oldFrame;
+    CBuffer->cbPop(CBuffer, &oldData, &oldFrame);
     DSTATUS("Warning: Circular Buffer Full. Discarded Callback from Tail \n");
+    if (discarded)
+    {
+      *discarded = oldData;
+    }
+    full = 1;
   }
   buffer2[head] = recvData;
   buffer[head]  = cbData;
   head          = next;
-  return 0;
+  OSDK_TRACE_RECV(cb_push, recvData);
+  return full;
 }
 
 int
@@ -57,6 +68,7 @@ CircularBuffer::cbPop(CircularBuffer*                    CBuffer,
   }
   *cbData   = buffer[tail];
   *recvData = buffer2[tail];
+  OSDK_TRACE_RECV(cb_pop, *recvData);
 
   //! Clear data
   memset(&buffer[tail], 0, sizeof(VehicleCallBackHandler));
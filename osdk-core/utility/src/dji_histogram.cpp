@@ -0,0 +1,136 @@
+/** @file dji_histogram.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief Fixed-memory log-linear histogram for the DJI OSDK
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_histogram.hpp"
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+Histogram::Histogram()
+{
+}
+
+int
+Histogram::bucketIndex(uint64_t value)
+{
+  if (value < (uint64_t)SUB_BUCKETS)
+  {
+    return (int)value;
+  }
+
+  int exponent = SUB_BUCKET_BITS;
+  while (exponent < MAX_EXPONENT - 1 && (value >> (exponent + 1)) != 0)
+  {
+    exponent++;
+  }
+  if ((value >> (exponent + 1)) != 0)
+  {
+    return BUCKET_COUNT - 1;
+  }
+
+  int shift = exponent - SUB_BUCKET_BITS;
+  return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS +
+         (int)((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t
+Histogram::bucketUpperBound(int index)
+{
+  if (index < SUB_BUCKETS)
+  {
+    return index;
+  }
+  int      shift = index / SUB_BUCKETS - 1;
+  uint64_t lower = (uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+  return lower + ((uint64_t)1 << shift) - 1;
+}
+
+void
+Histogram::record(uint64_t value)
+{
+  buckets[bucketIndex(value)].add(1);
+  count.add(1);
+  sum.add(value);
+  max.max(value);
+}
+
+void
+Histogram::reset()
+{
+  for (int i = 0; i < BUCKET_COUNT; i++)
+  {
+    buckets[i].storeRelaxed(0);
+  }
+  count.storeRelaxed(0);
+  sum.storeRelaxed(0);
+  max.storeRelaxed(0);
+}
+
+uint32_t
+Histogram::getCount() const
+{
+  return count.loadRelaxed();
+}
+
+uint64_t
+Histogram::getMax() const
+{
+  return max.loadRelaxed();
+}
+
+uint64_t
+Histogram::getSum() const
+{
+  return sum.loadRelaxed();
+}
+
+double
+Histogram::getMean() const
+{
+  uint32_t n = getCount();
+  return n ? (double)getSum() / n : 0.0;
+}
+
+uint64_t
+Histogram::getPercentile(double percentile) const
+{
+  uint32_t total = 0;
+  for (int i = 0; i < BUCKET_COUNT; i++)
+  {
+    total += buckets[i].loadRelaxed();
+  }
+  if (total == 0)
+  {
+    return 0;
+  }
+
+  if (percentile > 100.0)
+  {
+    percentile = 100.0;
+  }
+  uint32_t rank = (uint32_t)(percentile / 100.0 * total + 0.5);
+  if (rank == 0)
+  {
+    rank = 1;
+  }
+
+  uint32_t seen = 0;
+  for (int i = 0; i < BUCKET_COUNT; i++)
+  {
+    seen += buckets[i].loadRelaxed();
+    if (seen >= rank)
+    {
+      uint64_t value = bucketUpperBound(i);
+      uint64_t top   = getMax();
+      return (top && value > top) ? top : value;
+    }
+  }
+  return getMax();
+}
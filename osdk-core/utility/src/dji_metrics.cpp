@@ -0,0 +1,138 @@
+/** @file dji_metrics.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief Prometheus text-format writer for the DJI OSDK metrics
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_metrics.hpp"
+#include "dji_log.hpp"
+
+#include <string.h>
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+MetricsWriter::MetricsWriter()
+  : file(NULL)
+  , ownFile(false)
+{
+  path[0]    = '\0';
+  tmpPath[0] = '\0';
+}
+
+MetricsWriter::~MetricsWriter()
+{
+  if (ownFile && file)
+  {
+    //! never committed: drop the partial file
+    fclose(file);
+    remove(tmpPath);
+  }
+}
+
+bool
+MetricsWriter::open(const char* target)
+{
+  if (target == NULL || strlen(target) >= MAX_PATH_LEN)
+  {
+    DERROR("invalid metrics path\n");
+    return false;
+  }
+  strcpy(path, target);
+  strcpy(tmpPath, target);
+  strcat(tmpPath, ".tmp");
+
+  file = fopen(tmpPath, "w");
+  if (file == NULL)
+  {
+    DERROR("cannot open %s\n", tmpPath);
+    return false;
+  }
+  ownFile = true;
+  return true;
+}
+
+void
+MetricsWriter::attach(FILE* stream)
+{
+  file    = stream;
+  ownFile = false;
+}
+
+bool
+MetricsWriter::commit()
+{
+  if (file == NULL)
+  {
+    return false;
+  }
+  if (!ownFile)
+  {
+    fflush(file);
+    return true;
+  }
+
+  bool ok = (fclose(file) == 0);
+  file    = NULL;
+  ownFile = false;
+  if (!ok || rename(tmpPath, path) != 0)
+  {
+    DERROR("cannot publish metrics to %s\n", path);
+    remove(tmpPath);
+    return false;
+  }
+  return true;
+}
+
+void
+MetricsWriter::family(const char* name, const char* type, const char* help)
+{
+  if (file)
+  {
+    fprintf(file, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+  }
+}
+
+void
+MetricsWriter::sample(const char* name, uint64_t value, const char* labels)
+{
+  if (file == NULL)
+  {
+    return;
+  }
+  if (labels)
+  {
+    fprintf(file, "%s{%s} %llu\n", name, labels, (unsigned long long)value);
+  }
+  else
+  {
+    fprintf(file, "%s %llu\n", name, (unsigned long long)value);
+  }
+}
+
+void
+MetricsWriter::sample(const char* name, double value, const char* labels)
+{
+  if (file == NULL)
+  {
+    return;
+  }
+  if (labels)
+  {
+    fprintf(file, "%s{%s} %.9g\n", name, labels, value);
+  }
+  else
+  {
+    fprintf(file, "%s %.9g\n", name, value);
+  }
+}
+
+bool
+MetricsWriter::isOpen() const
+{
+  return file != NULL;
+}
@@ -0,0 +1,234 @@
+/** @file dji_rate_monitor.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief Arrival rate and jitter estimator for periodic telemetry
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#include "dji_rate_monitor.hpp"
+#include "dji_log.hpp"
+
+#include <math.h>
+#include <stdio.h>
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+const float RateMonitor::UNDER_RATE_RATIO = 0.8f;
+
+RateMonitor::RateMonitor()
+  : name("stream")
+  , index(-1)
+{
+  reset();
+}
+
+void
+RateMonitor::setName(const char* name, int index)
+{
+  this->name  = name;
+  this->index = index;
+}
+
+void
+RateMonitor::setExpectedRate(float hz)
+{
+  expectedHz.storeRelaxed(hz > 0 ? hz : 0);
+}
+
+float
+RateMonitor::getExpectedRate() const
+{
+  return expectedHz.loadRelaxed();
+}
+
+void
+RateMonitor::reset()
+{
+  last        = 0;
+  mean        = 0;
+  m2          = 0;
+  windowStart = 0;
+  windowCount = 0;
+
+  count.storeRelaxed(0);
+  rateHz.storeRelaxed(0);
+  meanInterval.storeRelaxed(0);
+  variance.storeRelaxed(0);
+  maxGap.storeRelaxed(0);
+  lastArrival.storeRelaxed(0);
+  underRateWindows.storeRelaxed(0);
+  underRate.storeRelaxed(false);
+}
+
+void
+RateMonitor::update(time_us now)
+{
+  uint32_t n = count.loadRelaxed();
+
+  if (n == 0 || now < last)
+  {
+    //! First arrival (or the clock went backwards): nothing to measure yet
+    windowStart = now;
+    windowCount = 0;
+  }
+  else
+  {
+    //! Welford's update over the n intervals seen so far
+    time_us gap      = now - last;
+    double  interval = (double)gap;
+    double  delta    = interval - mean;
+    mean += delta / n;
+    m2 += delta * (interval - mean);
+
+    meanInterval.storeRelaxed(mean);
+    if (n > 1)
+    {
+      variance.storeRelaxed(m2 / (n - 1));
+    }
+    maxGap.max(gap);
+    windowCount++;
+  }
+
+  last = now;
+  lastArrival.storeRelaxed(now);
+  count.storeRelaxed(n + 1);
+
+  poll(now);
+}
+
+void
+RateMonitor::poll(time_us now)
+{
+  if (windowStart == 0 || now < windowStart)
+  {
+    return;
+  }
+  if (now - windowStart >= windowLength())
+  {
+    closeWindow(now);
+  }
+}
+
+time_us
+RateMonitor::windowLength() const
+{
+  float expected = expectedHz.loadRelaxed();
+  if (expected > 0)
+  {
+    time_us forSamples = (time_us)(MIN_WINDOW_SAMPLES * 1000000.0f / expected);
+    if (forSamples > WINDOW_US)
+    {
+      return forSamples;
+    }
+  }
+  return WINDOW_US;
+}
+
+void
+RateMonitor::closeWindow(time_us now)
+{
+  float hz       = (float)(windowCount * 1000000.0 / (double)(now - windowStart));
+  float expected = expectedHz.loadRelaxed();
+  bool  under    = expected > 0 && hz < expected * UNDER_RATE_RATIO;
+
+  rateHz.storeRelaxed(hz);
+  if (under)
+  {
+    underRateWindows.add(1);
+  }
+  if (under != underRate.loadRelaxed())
+  {
+    if (under)
+    {
+      DSTATUS("Warning: %s %d delivered at %.1fHz, requested %.1fHz", name,
+              index, hz, expected);
+    }
+    else
+    {
+      DSTATUS("%s %d back to %.1fHz, requested %.1fHz", name, index, hz,
+              expected);
+    }
+    underRate.storeRelaxed(under);
+  }
+
+  windowStart = now;
+  windowCount = 0;
+}
+
+void
+RateMonitor::getStats(RateStats& out) const
+{
+  out.count            = count.loadRelaxed();
+  out.expectedHz       = expectedHz.loadRelaxed();
+  out.rateHz           = rateHz.loadRelaxed();
+  out.meanInterval     = meanInterval.loadRelaxed();
+  out.stdDevInterval   = sqrt(variance.loadRelaxed());
+  out.maxGap           = maxGap.loadRelaxed();
+  out.lastArrival      = lastArrival.loadRelaxed();
+  out.underRateWindows = underRateWindows.loadRelaxed();
+  out.underRate        = underRate.loadRelaxed();
+}
+
+void
+RateMonitor::writeMetrics(MetricsWriter& writer, const char* prefix,
+                          const char* label, const RateStats* stats,
+                          const int* ids, int count)
+{
+  static const char* const names[] = {
+    "received_total",   "requested_hz",     "delivered_hz",
+    "interval_mean_us", "interval_stddev_us", "max_gap_us",
+    "under_rate_windows_total"
+  };
+  static const char* const types[] = { "counter", "gauge", "gauge", "gauge",
+                                       "gauge",   "gauge", "counter" };
+  static const char* const help[] = {
+    "Arrivals since the stream was (re)configured.",
+    "Requested rate, 0 if unknown.",
+    "Arrival rate over the last measurement window.",
+    "Mean inter-arrival interval.",
+    "Standard deviation of the inter-arrival interval.",
+    "Longest inter-arrival interval.",
+    "Measurement windows delivered below the requested rate."
+  };
+  char name[96];
+  char labels[48];
+
+  for (int m = 0; m < (int)(sizeof(names) / sizeof(names[0])); m++)
+  {
+    snprintf(name, sizeof(name), "%s_%s", prefix, names[m]);
+    writer.family(name, types[m], help[m]);
+    for (int i = 0; i < count; i++)
+    {
+      const RateStats& s = stats[i];
+      snprintf(labels, sizeof(labels), "%s=\"%d\"", label, ids[i]);
+      switch (m)
+      {
+        case 0:
+          writer.sample(name, (uint64_t)s.count, labels);
+          break;
+        case 1:
+          writer.sample(name, (double)s.expectedHz, labels);
+          break;
+        case 2:
+          writer.sample(name, (double)s.rateHz, labels);
+          break;
+        case 3:
+          writer.sample(name, s.meanInterval, labels);
+          break;
+        case 4:
+          writer.sample(name, s.stdDevInterval, labels);
+          break;
+        case 5:
+          writer.sample(name, (uint64_t)s.maxGap, labels);
+          break;
+        default:
+          writer.sample(name, (uint64_t)s.underRateWindows, labels);
+          break;
+      }
+    }
+  }
+}
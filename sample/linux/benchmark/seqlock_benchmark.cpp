@@ -0,0 +1,216 @@
+/*! @file seqlock_benchmark.cpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Throughput of the SeqBuffer that backs DataSubscription::getValue(),
+ *  against the mutex it replaced. Needs no vehicle.
+ *
+ *  One writer publishes a PACKAGE_SIZE package in a loop, as the read
+ *  thread does when a subscription package arrives; N readers copy a
+ *  TOPIC_SIZE topic out of it, as getValue() does. Every write fills the
+ *  package with one byte value, so a reader that sees two values in its
+ *  topic caught a torn copy.
+ *
+ *  Usage: djiosdk-seqlock-benchmark [seconds per run]
+ *
+ *  @copyright
+ *  2017 DJI. All rights reserved.
+ * */
+
+#include "seqlock_benchmark.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using namespace DJI::OSDK;
+
+//! The package storage before the SeqBuffer: a copy under a mutex
+class MutexStore
+{
+public:
+  MutexStore()
+  {
+    pthread_mutex_init(&lock, NULL);
+    memset(data, 0, sizeof(data));
+  }
+  ~MutexStore()
+  {
+    pthread_mutex_destroy(&lock);
+  }
+  void write(const uint8_t* src)
+  {
+    pthread_mutex_lock(&lock);
+    memcpy(data, src, PACKAGE_SIZE);
+    pthread_mutex_unlock(&lock);
+  }
+  void read(uint8_t* dst, int offset)
+  {
+    pthread_mutex_lock(&lock);
+    memcpy(dst, data + offset, TOPIC_SIZE);
+    pthread_mutex_unlock(&lock);
+  }
+
+private:
+  pthread_mutex_t lock;
+  uint8_t         data[PACKAGE_SIZE];
+};
+
+class SeqLockStore
+{
+public:
+  void write(const uint8_t* src)
+  {
+    buffer.write(src, PACKAGE_SIZE);
+  }
+  void read(uint8_t* dst, int offset)
+  {
+    buffer.read(dst, offset, TOPIC_SIZE);
+  }
+
+private:
+  SeqBuffer<PACKAGE_SIZE> buffer;
+};
+
+template <class Store>
+struct Shared
+{
+  Store              store;
+  std::atomic<bool>  stop;
+  unsigned long      writes;
+  unsigned long      reads[MAX_READERS];
+  unsigned long      torn[MAX_READERS];
+};
+
+template <class Store>
+struct ReaderArg
+{
+  Shared<Store>* shared;
+  int            index;
+};
+
+template <class Store>
+static void*
+writerThread(void* param)
+{
+  Shared<Store>* shared = static_cast<Shared<Store>*>(param);
+  uint8_t        package[PACKAGE_SIZE];
+  unsigned long  n = 0;
+
+  while (!shared->stop.load(std::memory_order_relaxed))
+  {
+    memset(package, (uint8_t)++n, sizeof(package));
+    shared->store.write(package);
+  }
+  shared->writes = n;
+  return NULL;
+}
+
+template <class Store>
+static void*
+readerThread(void* param)
+{
+  ReaderArg<Store>* arg    = static_cast<ReaderArg<Store>*>(param);
+  Shared<Store>*    shared = arg->shared;
+  uint8_t           topic[TOPIC_SIZE];
+  unsigned long     n    = 0;
+  unsigned long     torn = 0;
+
+  while (!shared->stop.load(std::memory_order_relaxed))
+  {
+    shared->store.read(topic, PACKAGE_SIZE - TOPIC_SIZE);
+    for (int i = 1; i < TOPIC_SIZE; ++i)
+    {
+      if (topic[i] != topic[0])
+      {
+        torn++;
+        break;
+      }
+    }
+    n++;
+  }
+  shared->reads[arg->index] = n;
+  shared->torn[arg->index]  = torn;
+  return NULL;
+}
+
+template <class Store>
+static BenchmarkResult
+runBenchmark(int readers, double seconds)
+{
+  Shared<Store>*   shared = new Shared<Store>();
+  ReaderArg<Store> args[MAX_READERS];
+  pthread_t        writer;
+  pthread_t        threads[MAX_READERS];
+  BenchmarkResult  result = { 0, 0, 0 };
+
+  shared->stop.store(false);
+  pthread_create(&writer, NULL, writerThread<Store>, shared);
+  for (int i = 0; i < readers; ++i)
+  {
+    args[i].shared = shared;
+    args[i].index  = i;
+    pthread_create(&threads[i], NULL, readerThread<Store>, &args[i]);
+  }
+
+  struct timespec delay;
+  delay.tv_sec  = (time_t)seconds;
+  delay.tv_nsec = (long)((seconds - delay.tv_sec) * 1e9);
+  nanosleep(&delay, NULL);
+  shared->stop.store(true);
+
+  pthread_join(writer, NULL);
+  unsigned long reads = 0;
+  for (int i = 0; i < readers; ++i)
+  {
+    pthread_join(threads[i], NULL);
+    reads += shared->reads[i];
+    result.torn += shared->torn[i];
+  }
+  result.writesPerSecond = shared->writes / seconds;
+  result.readsPerSecond  = reads / seconds;
+  delete shared;
+  return result;
+}
+
+BenchmarkResult
+runMutexBenchmark(int readers, double seconds)
+{
+  return runBenchmark<MutexStore>(readers, seconds);
+}
+
+BenchmarkResult
+runSeqLockBenchmark(int readers, double seconds)
+{
+  return runBenchmark<SeqLockStore>(readers, seconds);
+}
+
+int
+main(int argc, char** argv)
+{
+  double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+  if (seconds <= 0)
+  {
+    printf("Usage: %s [seconds per run]\n", argv[0]);
+    return -1;
+  }
+
+  static const int readerCounts[] = { 1, 2, 4 };
+  unsigned long    torn           = 0;
+
+  printf("%-8s %14s %14s | %16s %14s\n", "readers", "mutex writes/s",
+         "reads/s", "seqlock writes/s", "reads/s");
+  for (size_t i = 0; i < sizeof(readerCounts) / sizeof(readerCounts[0]); ++i)
+  {
+    BenchmarkResult mutex   = runMutexBenchmark(readerCounts[i], seconds);
+    BenchmarkResult seqlock = runSeqLockBenchmark(readerCounts[i], seconds);
+    printf("%-8d %13.1fM %13.1fM | %15.1fM %13.1fM\n", readerCounts[i],
+           mutex.writesPerSecond / 1e6, mutex.readsPerSecond / 1e6,
+           seqlock.writesPerSecond / 1e6, seqlock.readsPerSecond / 1e6);
+    torn += mutex.torn + seqlock.torn;
+  }
+  printf("Torn reads: %lu\n", torn);
+  return torn == 0 ? 0 : 1;
+}
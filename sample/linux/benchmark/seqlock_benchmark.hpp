@@ -0,0 +1,39 @@
+/*! @file seqlock_benchmark.hpp
+ *  @version 3.3
+ *  @date Oct 2017
+ *
+ *  @brief
+ *  Throughput of the SeqBuffer that backs DataSubscription::getValue(),
+ *  against the mutex it replaced. Needs no vehicle.
+ *
+ *  @copyright
+ *  2017 DJI. All rights reserved.
+ * */
+
+#ifndef DJIOSDK_SEQLOCKBENCHMARK_HPP
+#define DJIOSDK_SEQLOCKBENCHMARK_HPP
+
+// DJI OSDK includes
+#include <dji_seqlock.hpp>
+
+// System includes
+#include <atomic>
+#include <pthread.h>
+
+//! Size of a typical subscription package and of the topic read from it
+const int PACKAGE_SIZE = 120;
+const int TOPIC_SIZE   = 16;
+const int MAX_READERS  = 16;
+
+typedef struct BenchmarkResult
+{
+  double writesPerSecond;
+  double readsPerSecond;
+  //! Reads that saw bytes of two different writes, must be 0
+  unsigned long torn;
+} BenchmarkResult;
+
+BenchmarkResult runMutexBenchmark(int readers, double seconds);
+BenchmarkResult runSeqLockBenchmark(int readers, double seconds);
+
+#endif // DJIOSDK_SEQLOCKBENCHMARK_HPP
@@ -3,6 +3,7 @@
 //
 
 #include <dji_linux_helpers.hpp>
+#include <posix_async_log.hpp>
 
 using namespace DJI::OSDK;
 
@@ -12,6 +13,10 @@ setupOSDK(int argc, char** argv)
 
   int functionTimeout = 1;
 
+  // Format and print the logs on a background thread, so the read and
+  // callback threads never wait on the terminal
+  PosixAsyncLog::install();
+
   // Config file loading
   std::string config_file_path;
   if (argc > 1)